@@ -42,6 +42,7 @@ target_compile_options(
 		-nostdlib
 		-fdata-sections
 		-ffunction-sections
+		-freorder-functions
 		-fsigned-char
 		-fno-strict-overflow
 		-march=r3000
@@ -0,0 +1,113 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "include/timer.h"
+
+#include "bench.h"
+
+#define CYCLES_PER_TICK  8 // The timer runs at sysclk/8
+#define CALIBRATE_BATCH  1024
+
+static BenchCase *_firstBench = 0, *_lastBench = 0;
+
+// Cost of an empty call through the run() pointer, in cycles times 256.
+static uint32_t _callOverhead = 0;
+
+void registerBench(BenchCase *bench){
+   bench->next = 0;
+
+   if(_lastBench){
+      _lastBench->next = bench;
+   } else {
+      _firstBench = bench;
+   }
+   _lastBench = bench;
+}
+
+static void _emptyRun(void){
+   __asm__ volatile("");
+}
+
+static uint32_t _timeBatch(void (*run)(void), int batch){
+   uint32_t start = getTicks();
+
+   for(int i = 0; i < batch; i++){
+      run();
+   }
+
+   return getTicks() - start;
+}
+
+static void _calibrate(void){
+   _timeBatch(&_emptyRun, CALIBRATE_BATCH);
+
+   _callOverhead = _timeBatch(&_emptyRun, CALIBRATE_BATCH) * CYCLES_PER_TICK * 256 / CALIBRATE_BATCH;
+}
+
+void runBench(const BenchCase *bench, BenchResult *result){
+   uint32_t samples[BENCH_RUNS];
+
+   for(int i = 0; i < BENCH_WARMUP_RUNS; i++){
+      if(bench->setup) bench->setup();
+      _timeBatch(bench->run, bench->batch);
+   }
+
+   for(int i = 0; i < BENCH_RUNS; i++){
+      if(bench->setup) bench->setup();
+
+      uint32_t cycles   = _timeBatch(bench->run, bench->batch) * CYCLES_PER_TICK;
+      uint32_t overhead = (_callOverhead * bench->batch) / 256;
+
+      uint32_t divisor  = bench->batch * bench->items;
+
+      cycles = (cycles > overhead) ? (cycles - overhead) : 0;
+      cycles = (cycles + divisor / 2) / divisor;
+
+      // Insertion sort, so the median is simply the middle sample.
+      int j = i;
+      for(; (j > 0) && (samples[j - 1] > cycles); j--){
+         samples[j] = samples[j - 1];
+      }
+      samples[j] = cycles;
+   }
+
+   result->median = samples[BENCH_RUNS / 2];
+   result->min    = samples[0];
+   result->max    = samples[BENCH_RUNS - 1];
+}
+
+void runAllBenches(void){
+   _calibrate();
+
+   printf("#bench begin\n");
+   printf("name,runs,batch,median,min,max\n");
+
+   for(const BenchCase *bench = _firstBench; bench; bench = bench->next){
+      BenchResult result;
+
+      runBench(bench, &result);
+      printf("%s,%d,%d,%d,%d,%d\n",
+         bench->name, BENCH_RUNS, bench->batch, (int)result.median, (int)result.min, (int)result.max
+      );
+   }
+
+   printf("#bench end\n");
+}
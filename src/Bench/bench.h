@@ -0,0 +1,81 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include "include/gpu.h"
+
+#define BENCH_WARMUP_RUNS 2  // Untimed runs, to fill the instruction cache
+#define BENCH_RUNS        15 // Timed runs, the median of which is reported
+
+typedef struct BenchCase BenchCase;
+
+struct BenchCase{
+   const char *name;
+   void (*setup)(void); // Called before every run without being timed, can be null
+   void (*run)(void);   // Performs the operation being measured once
+   int batch;           // How many times run() is called per timed run
+   int items;           // How many items (e.g. faces) each call to run() processes
+   BenchCase *next;
+};
+
+// Cycles taken by a single call to run(), or per item if the case processes
+// more than one, with the loop and timer overhead subtracted.
+typedef struct{
+   uint32_t median, min, max;
+}BenchResult;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void registerBench(BenchCase *bench);
+void runBench(const BenchCase *bench, BenchResult *result);
+
+// Runs every registered case in the order they were registered, printing the
+// results over serial as CSV between "#bench begin" and "#bench end" lines.
+// tools/benchDiff.py can compare two of these logs.
+void runAllBenches(void);
+
+// The chain cases that build packets allocate from (see cases.c).
+// resetBenchChain() empties it and is meant to be used as a case's setup.
+DMAChain *getBenchChain(void);
+void resetBenchChain(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// Defines a benchmark case and registers it before main() runs, e.g.
+//
+//    BENCH_CASE(isin, 0, 256){
+//       result += isin(angle++);
+//    }
+//
+// BENCH_CASE_PER_ITEM() defines a case whose results are divided by the number
+// of items each call to run() goes through, such as the faces of a model.
+#define BENCH_CASE_PER_ITEM(name, setupFunc, batchSize, itemCount) \
+   static void _bench_##name(void); \
+   static BenchCase _benchCase_##name = { #name, setupFunc, &_bench_##name, batchSize, itemCount, 0 }; \
+   __attribute__((constructor)) static void _registerBench_##name(void){ \
+      registerBench(&_benchCase_##name); \
+   } \
+   static void _bench_##name(void)
+
+#define BENCH_CASE(name, setupFunc, batchSize) \
+   BENCH_CASE_PER_ITEM(name, setupFunc, batchSize, 1)
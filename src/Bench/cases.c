@@ -0,0 +1,194 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * The benchmark cases. Each one measures a single call to something the game
+ * does every frame, so regressions show up before they're lost in the noise of
+ * a whole frame.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/font.h"
+#include "include/gpu.h"
+#include "include/gte.h"
+#include "include/render.h"
+#include "include/trig.h"
+#include "ps1/cop0gte.h"
+
+#include "FirstPersonCamera/RoomModel.h"
+
+#include "bench.h"
+#include "reference.h"
+
+#define COPY_SIZE 1024
+
+// A compile time constant, unlike roomModel.faceCount.
+#define ROOM_FACE_COUNT (sizeof(roomModel.faces) / sizeof(roomModel.faces[0]))
+
+// The same grid FirstPersonCamera's streaming builds split the room with.
+#define ROOM_CLUSTER_GRID 6
+
+// Only the TextureInfo's position is used when building packets, so the font
+// doesn't actually need to be in VRAM.
+static const TextureInfo font = {
+   .u = 0, .v = 0, .w = 96, .h = 56, .page = 0, .clut = 0
+};
+static const TextureInfo texture = {
+   .u = 0, .v = 0, .w = 64, .h = 64, .page = 0, .clut = 0
+};
+
+static Model room;
+static GTEVector16 roomNormals[ROOM_FACE_COUNT];
+static ModelCluster roomClusters[RENDER_MAX_CLUSTERS];
+static Tri_Textured clusterFaces[ROOM_FACE_COUNT];
+static GTEVector16 clusterNormals[ROOM_FACE_COUNT];
+static int roomClusterCount;
+static DMAChain *chain = 0;
+static uint32_t copySource[COPY_SIZE / 4], copyDest[COPY_SIZE / 4];
+static volatile int sink;
+static int angle;
+
+void resetBenchChain(void){
+   if(!chain){
+      ChainConfig config = {
+         .packetWords    = CHAIN_BUFFER_SIZE,
+         .arenaSize      = FRAME_ARENA_SIZE,
+         .reserveWords   = CHAIN_BUFFER_SIZE / 8,
+         .overflowPolicy = CHAIN_OVERFLOW_DROP_FAR
+      };
+
+      chain = malloc(sizeof(DMAChain));
+      void *memory = malloc(getChainMemorySize(&config));
+      assert(chain && memory);
+
+      initChain(chain, &config, memory);
+   }
+
+   resetChain(chain);
+}
+
+DMAChain *getBenchChain(void){
+   return chain;
+}
+
+// Looks at the room from the same place the game starts at.
+static void setupRoomView(void){
+   resetBenchChain();
+
+   if(!room.faceCount){
+      room.faceCount = roomModel.faceCount;
+      room.verts     = roomModel.verts;
+      room.faces     = roomModel.faces;
+      room.normals   = roomNormals;
+
+      computeFaceNormals(&room, roomNormals);
+      roomClusterCount = buildModelClusters(&room, ROOM_CLUSTER_GRID, roomClusters, clusterFaces, clusterNormals);
+   }
+
+   gte_setRotationMatrix(
+      ONE,   0,   0,
+      0, ONE,   0,
+      0,   0, ONE
+   );
+   rotateCurrentMatrix(0, 0, 0);
+   updateTranslationMatrix(0, 1000, 0);
+}
+
+BENCH_CASE(isin, 0, 256){
+   sink = isin(angle);
+   angle += 37;
+}
+
+BENCH_CASE(rotateCurrentMatrix, 0, 64){
+   gte_setRotationMatrix(
+      ONE,   0,   0,
+      0, ONE,   0,
+      0,   0, ONE
+   );
+   rotateCurrentMatrix(angle, angle * 3, angle * 5);
+   angle += 37;
+}
+
+BENCH_CASE(allocatePacket, &resetBenchChain, 256){
+   uint32_t *ptr = allocatePacket(chain, angle % ORDERING_TABLE_SIZE, 4);
+
+   ptr[0] = 0;
+   angle += 37;
+}
+
+BENCH_CASE(printString, &resetBenchChain, 4){
+   printString(chain, &font, 0, 0, "X:-1234\nY:5678\nZ:90\n\np: 1024\npkt: 1234/32768");
+}
+
+BENCH_CASE(memcpy, 0, 16){
+   memcpy(copyDest, copySource, COPY_SIZE);
+}
+
+BENCH_CASE(malloc, 0, 64){
+   void *ptr = malloc(64);
+   free(ptr);
+}
+
+BENCH_CASE(renderModelFlat, &setupRoomView, 1){
+   sink = renderModel(chain, &room, 0);
+}
+
+BENCH_CASE(renderModelTextured, &setupRoomView, 1){
+   sink = renderModel(chain, &room, &texture);
+}
+
+// The same as the two above, but in cycles per face and against the face loop
+// renderModel() had before it was software pipelined.
+BENCH_CASE_PER_ITEM(faceLoopFlat, &setupRoomView, 1, ROOM_FACE_COUNT){
+   sink = renderModel(chain, &room, 0);
+}
+
+BENCH_CASE_PER_ITEM(faceLoopFlatReference, &setupRoomView, 1, ROOM_FACE_COUNT){
+   sink = renderModelReference(chain, &room, 0);
+}
+
+BENCH_CASE_PER_ITEM(faceLoopTextured, &setupRoomView, 1, ROOM_FACE_COUNT){
+   sink = renderModel(chain, &room, &texture);
+}
+
+BENCH_CASE_PER_ITEM(faceLoopTexturedReference, &setupRoomView, 1, ROOM_FACE_COUNT){
+   sink = renderModelReference(chain, &room, &texture);
+}
+
+// The other render modes, which don't have a reference to compare against.
+BENCH_CASE_PER_ITEM(faceLoopGouraud, &setupRoomView, 1, ROOM_FACE_COUNT){
+   sink = getRenderKernel(RENDER_GOURAUD)(chain, &room, 0);
+}
+
+BENCH_CASE_PER_ITEM(faceLoopLit, &setupRoomView, 1, ROOM_FACE_COUNT){
+   sink = getRenderKernel(RENDER_LIT)(chain, &room, 0);
+}
+
+BENCH_CASE_PER_ITEM(faceLoopFogged, &setupRoomView, 1, ROOM_FACE_COUNT){
+   sink = getRenderKernel(RENDER_FOGGED)(chain, &room, 0);
+}
+
+// The same faces drawn a cluster at a time, far to near, as streaming builds do.
+// The benchmark chain isn't split into bands, so this only measures the cost of
+// sorting the clusters and going through the face loop once per cluster.
+BENCH_CASE_PER_ITEM(faceLoopClustered, &setupRoomView, 1, ROOM_FACE_COUNT){
+   sink = renderClusters(chain, getRenderKernel(RENDER_FLAT), roomClusters, roomClusterCount, 0);
+}
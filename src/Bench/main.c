@@ -0,0 +1,49 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Microbenchmark runner. Times every case registered with BENCH_CASE() (see
+ * cases.c) and prints the results over serial, so they can be saved and
+ * compared against another build with tools/benchDiff.py.
+ */
+
+#include <stdio.h>
+
+#include "include/gte.h"
+#include "include/irq.h"
+#include "include/render.h"
+#include "include/timer.h"
+
+#include "bench.h"
+
+int main(){
+   installExceptionHandler();
+   initTimer();
+   enableInterrupts();
+   initSerialIO(115200);
+
+   // The GTE has to be enabled for the matrix and model cases.
+   setupGTE(320, 240);
+   setupRenderLighting();
+
+   runAllBenches();
+
+   for(;;){
+      __asm__ volatile("");
+   }
+   return 0;
+}
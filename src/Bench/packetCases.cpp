@@ -0,0 +1,113 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Packets built with the builders in include/packet.hpp, each next to the same
+ * packet filled in by hand. The two cases of each pair should take the same
+ * number of cycles; if the builder one is slower, it's no longer compiling down
+ * to the same code.
+ */
+
+#include <stdint.h>
+
+#include "include/gpu.h"
+#include "include/packet.hpp"
+#include "ps1/gpucmd.h"
+
+#include "bench.h"
+
+static DMAChain *_chain = 0;
+static int _counter;
+
+static void _setupChain(void){
+   resetBenchChain();
+   _chain = getBenchChain();
+}
+
+static inline int _nextZ(void){
+   return (_counter++) % ORDERING_TABLE_SIZE;
+}
+
+/* Textured triangle */
+
+BENCH_CASE(packetTexturedTriangleManual, &_setupChain, 256){
+   int      x   = _counter;
+   uint32_t *ptr = allocatePacket(_chain, _nextZ(), 7);
+
+   ptr[0] = gp0_rgb(128, 128, 128) | gp0_shadedTriangle(false, true, false);
+   ptr[1] = gp0_xy(x, 0);
+   ptr[2] = gp0_uv(0, 0, gp0_clut(0, 480));
+   ptr[3] = gp0_xy(x + 32, 0);
+   ptr[4] = gp0_uv(32, 0, gp0_page(320 / 64, 0, GP0_BLEND_SEMITRANS, GP0_COLOR_4BPP));
+   ptr[5] = gp0_xy(x, 32);
+   ptr[6] = gp0_uv(0, 32, 0);
+}
+
+BENCH_CASE(packetTexturedTriangleEmplace, &_setupChain, 256){
+   int  x   = _counter;
+   auto *tri = packet::emplace<packet::TexturedTriangle<>>(_chain, _nextZ());
+
+   tri->setColor(gp0_rgb(128, 128, 128));
+   tri->xy0 = gp0_xy(x, 0);
+   tri->uv0 = gp0_uv(0, 0, gp0_clut(0, 480));
+   tri->xy1 = gp0_xy(x + 32, 0);
+   tri->uv1 = gp0_uv(32, 0, gp0_page(320 / 64, 0, GP0_BLEND_SEMITRANS, GP0_COLOR_4BPP));
+   tri->xy2 = gp0_xy(x, 32);
+   tri->uv2 = gp0_uv(0, 32, 0);
+}
+
+/* Sprite */
+
+BENCH_CASE(packetSpriteManual, &_setupChain, 256){
+   int      x   = _counter;
+   uint32_t *ptr = allocatePacket(_chain, _nextZ(), 4);
+
+   ptr[0] = gp0_rgb(128, 128, 128) | gp0_rectangle(true, true, true);
+   ptr[1] = gp0_xy(x, 16);
+   ptr[2] = gp0_uv(8, 8, gp0_clut(0, 480));
+   ptr[3] = gp0_xy(6, 9);
+}
+
+BENCH_CASE(packetSpriteEmplace, &_setupChain, 256){
+   int  x      = _counter;
+   auto *sprite = packet::emplace<packet::Sprite<true, true>>(_chain, _nextZ());
+
+   sprite->setColor(gp0_rgb(128, 128, 128));
+   sprite->xy = gp0_xy(x, 16);
+   sprite->uv = gp0_uv(8, 8, gp0_clut(0, 480));
+   sprite->wh = gp0_xy(6, 9);
+}
+
+/* Fill */
+
+BENCH_CASE(packetFillManual, &_setupChain, 256){
+   int      x   = _counter;
+   uint32_t *ptr = allocatePacket(_chain, _nextZ(), 3);
+
+   ptr[0] = gp0_rgb(64, 64, 64) | gp0_vramFill();
+   ptr[1] = gp0_xy(x & 0x3f0, 0);
+   ptr[2] = gp0_xy(320, 240);
+}
+
+BENCH_CASE(packetFillEmplace, &_setupChain, 256){
+   int  x    = _counter;
+   auto *fill = packet::emplace<packet::Fill>(_chain, _nextZ());
+
+   fill->setColor(gp0_rgb(64, 64, 64));
+   fill->xy = gp0_xy(x & 0x3f0, 0);
+   fill->wh = gp0_xy(320, 240);
+}
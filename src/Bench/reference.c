@@ -0,0 +1,110 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdint.h>
+
+#include "include/gpu.h"
+#include "include/model.h"
+#include "ps1/cop0gte.h"
+#include "ps1/gpucmd.h"
+
+#include "reference.h"
+
+// 6 select colours for rendering polys in "coloured" mode
+static const uint32_t colors[6] = {
+    0x0000FF,
+    0x00FF00,
+    0xFF0000,
+    0x00FFFF,
+    0xFF00FF,
+    0xFFFF00
+};
+
+int renderModelReference(DMAChain *chain, const Model *model, const TextureInfo *texture){
+    // Keep track of how many polygons are being drawn.
+    int polyCount = 0;
+
+    // The pointer to the DMA packet.
+    // We allocate space for each packet before we use it.
+    uint32_t *ptr;
+
+    // Iterate over every face in the model
+    for(uint16_t i = 0; i<model->faceCount; i++){
+
+        const Tri_Textured *tri = &model->faces[i];
+
+        // Load the 3 verts into their respective V register.
+        gte_loadV0(&model->verts[tri->vertices[0]]);
+        gte_loadV1(&model->verts[tri->vertices[1]]);
+        gte_loadV2(&model->verts[tri->vertices[2]]);
+        // Perform a perspective transformation on the 3 verts, then perform "Normal Clipping."
+        gte_command(GTE_CMD_RTPT | GTE_SF);
+        gte_command(GTE_CMD_NCLIP);
+        // If the face is facing away from us, don't bother rendering it.
+        if(gte_getMAC0() <= 0){
+            continue;
+        }
+
+        // Calculate the average Z value of all 3 verts.
+        gte_command(GTE_CMD_AVSZ3 | GTE_SF);
+        int zIndex = gte_getOTZ();
+
+        // If it is too far from the camera, clip it.
+        if((zIndex >= ORDERING_TABLE_SIZE)){
+            continue;
+        }
+
+        // If the average value is behind the camera,
+        // Check if any of the corners are in view of the camera.
+        // If not, skip it.
+        if((zIndex <= 0)){
+            if(gte_getSZ0() + gte_getSZ1() + gte_getSZ2() == 0){
+                continue;
+            }
+        }
+
+
+        if(texture){
+            // Calculate the texture UV coords for the verts in this face.
+            uint32_t uv0 = gp0_uv(texture->u + tri->UVs[0].u, texture->v + tri->UVs[0].v, texture->clut);
+            uint32_t uv1 = gp0_uv(texture->u + tri->UVs[1].u, texture->v + tri->UVs[1].v, texture->page);
+            uint32_t uv2 = gp0_uv(texture->u + tri->UVs[2].u, texture->v + tri->UVs[2].v, 0);
+
+            // Render a triangle at the XY coords calculated via the GTE with the texture UVs calculated above
+            ptr = allocatePacket(chain, zIndex, 7);
+            ptr[0] = 0x808080 | gp0_shadedTriangle(false, true, false);
+            ptr[1] = gte_getSXY0();
+            ptr[2] = uv0;
+            ptr[3] = gte_getSXY1();
+            ptr[4] = uv1;
+            ptr[5] = gte_getSXY2();
+            ptr[6] = uv2;
+        } else {
+            // Render a triangle at the XY coords calculated via the GTE with a flat colour selected using the poly's index.
+            ptr = allocatePacket(chain, zIndex, 4);
+            ptr[0] = colors[i%6] | gp0_shadedTriangle(false, false, false);
+            ptr[1] = gte_getSXY0();
+            ptr[2] = gte_getSXY1();
+            ptr[3] = gte_getSXY2();
+        }
+        // Increment the polygon counter as we rendered another polygon
+        polyCount++;
+
+    }
+
+    return polyCount;
+}
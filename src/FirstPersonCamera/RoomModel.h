@@ -19,18 +19,10 @@
 #include <stddef.h>
 
 #include "ps1/cop0gte.h"
+#include "include/model.h"
 
 // Its a really big struct that contains all the polygons for the room we render.
 
-typedef struct{
-    uint16_t u, v;
-}UV;
-
-typedef struct{
-    uint16_t vertices[3];
-    UV UVs[3];
-} Tri_Textured;
-
 typedef struct {
     size_t faceCount;
     GTEVector16 verts[930];
@@ -0,0 +1,266 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "include/camera.h"
+#include "include/gpu.h"
+#include "include/present.h"
+#include "include/timer.h"
+#include "include/trig.h"
+
+#include "flythrough.h"
+
+#define SPLINE_SHIFT 12
+#define ANGLE_MASK   ((ISIN_PI * 2) - 1)
+
+// A loop around the room at varying heights, facing along the path and looking
+// up and down at the corners. Y is negative above the floor.
+static const FlythroughKeyframe _keyframes[] = {
+   { .x = -5500, .y = -1000, .z =     0, .yaw =    0, .pitch =    0 },
+   { .x = -5000, .y = -1400, .z =  5000, .yaw = 3584, .pitch = -200 },
+   { .x =     0, .y = -1800, .z =  5500, .yaw = 3072, .pitch =  200 },
+   { .x =  5000, .y = -2400, .z =  5000, .yaw = 2560, .pitch =  400 },
+   { .x =  5500, .y = -1600, .z =     0, .yaw = 2048, .pitch =    0 },
+   { .x =  5000, .y =  -800, .z = -5000, .yaw = 1536, .pitch = -300 },
+   { .x =     0, .y = -1000, .z = -5500, .yaw = 1024, .pitch =    0 },
+   { .x = -5000, .y = -1200, .z = -5000, .yaw =  512, .pitch =  100 }
+};
+
+#define KEYFRAME_COUNT (sizeof(_keyframes) / sizeof(_keyframes[0]))
+
+static const char *const _passNames[FLYTHROUGH_PASS_COUNT] = {
+   "coloured",
+   "textured"
+};
+
+// What formatFlythroughResults() prints for the HUD. Each pass can take up the
+// format's own length, plus the longest pass name and 11 characters for each of
+// its 9 figures (counting the specifiers as well only errs on the safe side).
+#define RESULTS_TITLE    "\t\tFlythrough\n======================\n"
+#define RESULTS_FORMAT   "%s:\nmin %d avg %d p99 %dus\nfaces %d culled %d drawn %d\npkt %d (drop %d) held %d%%\n"
+#define PASS_NAME_LENGTH 8
+#define RESULTS_FIGURES  9
+
+_Static_assert(
+   ((sizeof(RESULTS_TITLE) - 1) + (FLYTHROUGH_PASS_COUNT *
+      ((sizeof(RESULTS_FORMAT) - 1) + PASS_NAME_LENGTH + (RESULTS_FIGURES * 11))
+   )) <= FLYTHROUGH_RESULTS_LENGTH,
+   "FLYTHROUGH_RESULTS_LENGTH is too short for the HUD results"
+);
+
+// Frame times of the current pass, kept around to find the 99th percentile.
+static uint32_t _frameTicks[FLYTHROUGH_FRAMES];
+
+// Catmull-Rom spline through p1 and p2, with t going from 0 to
+// (1 << SPLINE_SHIFT). Horner's method keeps every product within 32 bits for
+// values the size of the room.
+static int32_t _spline(int32_t p0, int32_t p1, int32_t p2, int32_t p3, int t){
+   int32_t a = -p0 + 3 * p1 - 3 * p2 + p3;
+   int32_t b = 2 * p0 - 5 * p1 + 4 * p2 - p3;
+   int32_t c = -p0 + p2;
+
+   int32_t value = (a * t) >> SPLINE_SHIFT;
+   value = ((value + b) * t) >> SPLINE_SHIFT;
+   value = ((value + c) * t) >> SPLINE_SHIFT;
+
+   return p1 + (value >> 1);
+}
+
+// Angles are splined relative to p1, taking the shortest way around to each of
+// the others, so the path can cross from 4095 back to 0.
+static int _angleDelta(int from, int to){
+   return ((to - from + ISIN_PI) & ANGLE_MASK) - ISIN_PI;
+}
+
+static int16_t _splineAngle(int p0, int p1, int p2, int p3, int t){
+   int d0 = _angleDelta(p1, p0);
+   int d2 = _angleDelta(p1, p2);
+   int d3 = d2 + _angleDelta(p2, p3);
+
+   return (p1 + _spline(d0, 0, d2, d3, t)) & ANGLE_MASK;
+}
+
+static void _getPathCamera(int frame, Camera *camera){
+   uint32_t position = ((uint32_t) frame * KEYFRAME_COUNT << SPLINE_SHIFT) / FLYTHROUGH_FRAMES;
+   int segment = position >> SPLINE_SHIFT;
+   int t       = position & ((1 << SPLINE_SHIFT) - 1);
+
+   const FlythroughKeyframe *k0 = &_keyframes[(segment + KEYFRAME_COUNT - 1) % KEYFRAME_COUNT];
+   const FlythroughKeyframe *k1 = &_keyframes[segment];
+   const FlythroughKeyframe *k2 = &_keyframes[(segment + 1) % KEYFRAME_COUNT];
+   const FlythroughKeyframe *k3 = &_keyframes[(segment + 2) % KEYFRAME_COUNT];
+
+   camera->x     = _spline(k0->x, k1->x, k2->x, k3->x, t);
+   camera->y     = _spline(k0->y, k1->y, k2->y, k3->y, t);
+   camera->z     = _spline(k0->z, k1->z, k2->z, k3->z, t);
+   camera->yaw   = _splineAngle(k0->yaw, k1->yaw, k2->yaw, k3->yaw, t);
+   camera->pitch = _spline(k0->pitch, k1->pitch, k2->pitch, k3->pitch, t);
+   camera->roll  = 0;
+}
+
+static void _resetPass(Flythrough *flythrough){
+   flythrough->frame               = 0;
+   flythrough->totalFacesProcessed = 0;
+   flythrough->totalFacesDrawn     = 0;
+   flythrough->peakWords           = 0;
+   flythrough->droppedPackets      = 0;
+
+   getPresentStats(&flythrough->passStart);
+}
+
+static void _finishPass(Flythrough *flythrough){
+   FlythroughResult *result = &flythrough->results[flythrough->pass];
+   PresentStats passEnd;
+   uint32_t total = 0;
+
+   getPresentStats(&passEnd);
+
+   // Insertion sort, so the percentiles can simply be read off.
+   for(int i = 1; i < FLYTHROUGH_FRAMES; i++){
+      uint32_t value = _frameTicks[i];
+      int j = i;
+
+      for(; (j > 0) && (_frameTicks[j - 1] > value); j--){
+         _frameTicks[j] = _frameTicks[j - 1];
+      }
+      _frameTicks[j] = value;
+   }
+   for(int i = 0; i < FLYTHROUGH_FRAMES; i++){
+      total += _frameTicks[i];
+   }
+
+   result->minTicks = _frameTicks[0];
+   result->avgTicks = total / FLYTHROUGH_FRAMES;
+   result->p99Ticks = _frameTicks[(FLYTHROUGH_FRAMES * 99 + 99) / 100 - 1];
+   result->maxTicks = _frameTicks[FLYTHROUGH_FRAMES - 1];
+
+   result->facesProcessed = flythrough->totalFacesProcessed / FLYTHROUGH_FRAMES;
+   result->facesDrawn     = flythrough->totalFacesDrawn / FLYTHROUGH_FRAMES;
+   result->facesCulled    = result->facesProcessed - result->facesDrawn;
+   result->peakWords      = flythrough->peakWords;
+   result->droppedPackets = flythrough->droppedPackets;
+   result->fields         = passEnd.vblanks - flythrough->passStart.vblanks;
+   result->heldFields     = passEnd.heldFields - flythrough->passStart.heldFields;
+
+   uint32_t drawnFrames = passEnd.drawnFrames - flythrough->passStart.drawnFrames;
+
+   result->gpuTicks = drawnFrames
+      ? ((passEnd.drawTicks - flythrough->passStart.drawTicks) / drawnFrames)
+      : 0;
+}
+
+void startFlythrough(Flythrough *flythrough){
+   flythrough->active   = true;
+   flythrough->finished = false;
+   flythrough->pass     = 0;
+
+   _resetPass(flythrough);
+}
+
+bool beginFlythroughFrame(Flythrough *flythrough, Camera *camera, bool *textured){
+   if(!flythrough->active){
+      return false;
+   }
+
+   _getPathCamera(flythrough->frame, camera);
+   *textured = (flythrough->pass == FLYTHROUGH_PASS_TEXTURED);
+
+   flythrough->frameStart = getTicks();
+   return true;
+}
+
+bool endFlythroughFrame(
+   Flythrough *flythrough, int facesProcessed, int facesDrawn, const DMAChain *chain
+){
+   if(!flythrough->active){
+      return false;
+   }
+
+   _frameTicks[flythrough->frame] = getTicks() - flythrough->frameStart;
+
+   uint32_t words = getChainWords(chain);
+
+   flythrough->totalFacesProcessed += facesProcessed;
+   flythrough->totalFacesDrawn     += facesDrawn;
+   flythrough->droppedPackets      += chain->droppedPackets;
+   if(words > flythrough->peakWords){
+      flythrough->peakWords = words;
+   }
+
+   if(++flythrough->frame < FLYTHROUGH_FRAMES){
+      return false;
+   }
+
+   _finishPass(flythrough);
+   _resetPass(flythrough);
+
+   if(++flythrough->pass < FLYTHROUGH_PASS_COUNT){
+      return false;
+   }
+
+   flythrough->active   = false;
+   flythrough->finished = true;
+   return true;
+}
+
+void printFlythroughResults(const Flythrough *flythrough){
+   printf("#flythrough begin\n");
+   printf("mode,frames,min_us,avg_us,p99_us,max_us,faces,culled,drawn,peak_words,dropped,fields,held,gpu_us\n");
+
+   for(int i = 0; i < FLYTHROUGH_PASS_COUNT; i++){
+      const FlythroughResult *result = &flythrough->results[i];
+
+      printf("%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n",
+         _passNames[i], FLYTHROUGH_FRAMES,
+         (int)ticksToMicroseconds(result->minTicks), (int)ticksToMicroseconds(result->avgTicks),
+         (int)ticksToMicroseconds(result->p99Ticks), (int)ticksToMicroseconds(result->maxTicks),
+         (int)result->facesProcessed, (int)result->facesCulled, (int)result->facesDrawn,
+         (int)result->peakWords, (int)result->droppedPackets,
+         (int)result->fields, (int)result->heldFields,
+         (int)ticksToMicroseconds(result->gpuTicks)
+      );
+   }
+
+   printf("#flythrough end\n");
+}
+
+void formatFlythroughResults(const Flythrough *flythrough, char *output, size_t length){
+   int written = snprintf(output, length, RESULTS_TITLE);
+
+   for(int i = 0; (i < FLYTHROUGH_PASS_COUNT) && (written < (int) length); i++){
+      const FlythroughResult *result = &flythrough->results[i];
+
+      // The share of fields held is how much of the pass fell back to half rate.
+      int held = result->fields ? (int)((result->heldFields * 100) / result->fields) : 0;
+
+      written += snprintf(&output[written], length - written, RESULTS_FORMAT,
+         _passNames[i],
+         (int)ticksToMicroseconds(result->minTicks), (int)ticksToMicroseconds(result->avgTicks),
+         (int)ticksToMicroseconds(result->p99Ticks),
+         (int)result->facesProcessed, (int)result->facesCulled, (int)result->facesDrawn,
+         (int)result->peakWords, (int)result->droppedPackets, held
+      );
+   }
+
+   // The results can only be cut short if the output is smaller than asked for.
+   assert(written < (int) length);
+}
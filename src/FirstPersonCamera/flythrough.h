@@ -0,0 +1,112 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "include/camera.h"
+#include "include/gpu.h"
+#include "include/present.h"
+
+// The path is flown once per render mode, taking this many frames each time.
+// The camera is placed by frame number rather than by time, so every run
+// draws exactly the same frames regardless of how fast the build is.
+#define FLYTHROUGH_FRAMES 600
+
+// Sending this over serial starts the benchmark.
+#define FLYTHROUGH_SERIAL_COMMAND 'B'
+
+// Longest text formatFlythroughResults() can produce, not counting the null
+// terminator, with every figure at its widest ("-2147483648").
+#define FLYTHROUGH_RESULTS_LENGTH 414
+
+typedef enum {
+   FLYTHROUGH_PASS_COLOURED = 0,
+   FLYTHROUGH_PASS_TEXTURED = 1,
+   FLYTHROUGH_PASS_COUNT
+} FlythroughPass;
+
+// Camera position and angles at one point of the path, which goes through each
+// keyframe in turn and loops back to the first one.
+typedef struct{
+   int32_t x, y, z;
+   int16_t yaw, pitch;
+}FlythroughKeyframe;
+
+// Frame times are measured from the start of the frame to the point where the
+// GPU has finished drawing the previous one, i.e. without waiting for VBlank.
+// Builds using the present queue stop the clock once the frame is queued
+// instead, and start it once beginPresentFrame() has returned, as waiting for a
+// free chain there is paced by VBlank. Face counts are averages over all frames
+// of the pass.
+//
+// The GPU's own draw time is reported separately by builds using the present
+// queue, averaged over the frames it finished during the pass. It runs from
+// sending a chain to the GP0(1Fh) IRQ at its end (see PresentStats).
+//
+// Fields are the VBlanks that happened during the pass and held fields the ones
+// that had no new frame to show (see PresentStats). They're only counted by
+// builds using the present queue.
+typedef struct{
+   uint32_t minTicks, avgTicks, p99Ticks, maxTicks;
+   uint32_t facesProcessed, facesCulled, facesDrawn;
+   uint32_t peakWords, droppedPackets;
+   uint32_t fields, heldFields;
+   uint32_t gpuTicks;
+}FlythroughResult;
+
+typedef struct{
+   bool active, finished;
+   FlythroughPass pass;
+   int frame;
+   uint32_t frameStart;
+
+   // Running totals for the current pass.
+   uint32_t totalFacesProcessed, totalFacesDrawn;
+   uint32_t peakWords, droppedPackets;
+   PresentStats passStart;
+
+   FlythroughResult results[FLYTHROUGH_PASS_COUNT];
+}Flythrough;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void startFlythrough(Flythrough *flythrough);
+
+// Called at the start of every frame. While the benchmark is running, this
+// sets the camera and render mode to use and returns true.
+bool beginFlythroughFrame(Flythrough *flythrough, Camera *camera, bool *textured);
+
+// Called once the frame has been built and the GPU is idle (or the frame has
+// been queued). Returns true on the frame the last pass is completed.
+bool endFlythroughFrame(
+   Flythrough *flythrough, int facesProcessed, int facesDrawn, const DMAChain *chain
+);
+
+// Prints the results over serial as CSV between "#flythrough begin" and
+// "#flythrough end" lines, or formats them for the HUD. The output should have
+// room for FLYTHROUGH_RESULTS_LENGTH characters plus a null terminator.
+void printFlythroughResults(const Flythrough *flythrough);
+void formatFlythroughResults(const Flythrough *flythrough, char *output, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
@@ -24,39 +24,139 @@
  * The PSX.Dev Discord server can be found at: https://discord.com/invite/psx-dev-642647820683444236
  */
 
+#include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 
+#include "include/arena.h"
 #include "include/camera.h"
+#include "include/capture.h"
 #include "include/controller.h"
 #include "include/font.h"
 #include "include/gpu.h"
 #include "include/gte.h"
-#include "include/trig.h"
+#include "include/irq.h"
+#include "include/log.h"
+#include "include/memmap.h"
+#include "include/present.h"
+#include "include/profiler.h"
+#include "include/render.h"
+#include "include/replay.h"
+#include "include/sampler.h"
+#include "include/text.h"
+#include "include/timer.h"
+#include "include/vram.h"
 #include "ps1/cop0gte.h"
 #include "ps1/gpucmd.h"
 #include "ps1/registers.h"
 
 #include "RoomModel.h"
+#include "flythrough.h"
 
 #define SCREEN_WIDTH     320
 #define SCREEN_HEIGHT    256
 #define FONT_WIDTH       96
 #define FONT_HEIGHT      56
 
-// 6 select colours for rendering polys in "coloured" mode
-uint32_t colors[6] = {
-   0x0000FF,
-   0x00FF00,
-   0xFF0000,
-   0x00FFFF,
-   0xFF00FF,
-   0xFFFF00
+// The HUD is made up of the help text (or the flythrough's results) followed by one
+// field per line of stats.
+#define HUD_TITLE_LENGTH FLYTHROUGH_RESULTS_LENGTH
+#define HUD_LINE_LENGTH  40
+#define HUD_FIELDS       (1 + HUD_LINE_COUNT)
+#define HUD_GLYPHS       (HUD_TITLE_LENGTH + (HUD_LINE_COUNT * HUD_LINE_LENGTH))
+
+// Streaming builds split the room into a grid of clusters this many cells across and
+// send the chain to the GPU in this many depth bands.
+#define ROOM_CLUSTER_GRID  6
+#define STREAMING_BANDS    8
+
+// Triple buffered builds keep a third frame in flight, so a frame that misses VBlank
+// doesn't hold up the CPU until the next one. Streaming builds present frames
+// themselves and are always double buffered.
+#ifdef TRIPLE_BUFFERING
+#ifdef STREAMING_CHAIN
+#error "Streaming builds can't be triple buffered"
+#endif
+#define FRAME_BUFFERS 3
+#else
+#define FRAME_BUFFERS 2
+#endif
+
+// Up to a minute of input can be recorded.
+#define INPUT_RECORDING_TICKS (SIM_RATE * 60)
+
+// Settings saved along with input recordings, so replays start out the same.
+#define INPUT_FLAG_SHOWING_HELP     (1 << 0)
+#define INPUT_FLAG_RENDER_TEXTURED  (1 << 1)
+#define INPUT_FLAG_TRIANGLE_PRESSED (1 << 2)
+#define INPUT_FLAG_SQUARE_PRESSED   (1 << 3)
+
+// The render mode is saved in these bits. Textured mode also sets
+// INPUT_FLAG_RENDER_TEXTURED, so older recordings still replay the same.
+#define INPUT_FLAG_RENDER_MODE_SHIFT 4
+#define INPUT_FLAG_RENDER_MODE_MASK  (7 << INPUT_FLAG_RENDER_MODE_SHIFT)
+
+enum{
+   HUD_LINE_X,
+   HUD_LINE_Y,
+   HUD_LINE_Z,
+   HUD_LINE_POLYS,
+   HUD_LINE_PACKETS,
+   HUD_LINE_LATENCY,
+   HUD_LINE_LOG,
+   HUD_LINE_COUNT
 };
 
+static const char helpText[] = "\t\tControls\n======================\nL: \t \tMove\nR: \t \tLook\nL2/R2: \tDown/Up\nTriangle:\tToggle this menu\nSquare:\tChange render mode\n";
+
+// Moves the stats to one blank line below the title, with another blank line after the
+// camera's position.
+static void moveHudLines(TextLayer *hud, const int *lines, const char *title){
+   int y = FONT_LINE_HEIGHT;
+
+   for(; *title; title++){
+      if(*title == '\n'){
+         y += FONT_LINE_HEIGHT;
+      }
+   }
+
+   for(int i = 0; i < HUD_LINE_COUNT; i++){
+      if(i == HUD_LINE_POLYS){
+         y += FONT_LINE_HEIGHT;
+      }
+
+      moveTextField(hud, lines[i], 0, y);
+      y += FONT_LINE_HEIGHT;
+   }
+}
+
+// Everything is placed in VRAM once at startup and is known to fit, so running out of
+// room is a bug.
+static void placeInVRAM(VRAMAllocator *vram, int w, int h, int alignX, int *x, int *y){
+   bool placed = allocateVRAM(vram, w, h, alignX, x, y);
+
+   assert(placed);
+   (void) placed;
+}
+
 int main(){
+   // Take over the exception vector so we can use interrupts, then start
+   // polling the controllers in the background.
+   installExceptionHandler();
+   initMemoryMap();
+
+#ifdef RECLAIM_KERNEL_RAM
+   // Nothing calls into the BIOS once our exception handler is in, so the RAM it
+   // kept for itself can hold buffers that live for the whole run instead.
+   Arena kernelArena;
+   reclaimKernelRam(&kernelArena);
+#endif
+   initTimer();
    initControllerBus();
+   initControllerPolling();
+   enableInterrupts();
 
    // Read the GPU's status register to check if it was left in PAL or NTSC mode by the BIOS
    if ((GPU_GP1 & GP1_STAT_MODE_BITMASK) == GP1_STAT_MODE_PAL){
@@ -64,8 +164,10 @@ int main(){
    } else {
       setupGPU(GP1_MODE_NTSC, SCREEN_WIDTH, SCREEN_HEIGHT);
    }
-   // Set up the Geometry Transformation Engine with the width and height of our screen
+   // Set up the Geometry Transformation Engine with the width and height of our screen,
+   // then the lights and fog used by some of the render modes.
    setupGTE(SCREEN_WIDTH, SCREEN_HEIGHT);
+   setupRenderLighting();
 
    // Enable the GPU's DMA channel
    DMA_DPCR |= DMA_DPCR_ENABLE << (DMA_GPU * 4);
@@ -74,8 +176,82 @@ int main(){
    GPU_GP1 = gp1_dmaRequestMode(GP1_DREQ_GP0_WRITE); // Fetch GP0 commands from DMA when possible
    GPU_GP1 = gp1_dispBlank(false); // Disable display blanking
 
-   DMAChain dmaChains[2];
-   bool usingSecondFrame = false;
+   // The packet buffers are sized here rather than at compile time, so they can be budgeted
+   // to fit the scene. If a frame needs more than this, the farthest polygons are dropped
+   // first instead of running off the end of the buffer.
+   ChainConfig chainConfig = {
+      .packetWords    = CHAIN_BUFFER_SIZE,
+      .arenaSize      = 0, // Nothing here allocates per-frame memory
+      .reserveWords   = CHAIN_BUFFER_SIZE / 8,
+      .overflowPolicy = CHAIN_OVERFLOW_DROP_FAR,
+#ifdef STREAMING_CHAIN
+      .bandCount      = STREAMING_BANDS
+#endif
+   };
+
+   // Each chain's ordering table and packets are allocated in one go.
+   // This is the only time we touch the heap, everything allocated during a frame
+   // comes out of these.
+   //
+   // Each chain draws into its own framebuffer. The framebuffers are placed in VRAM
+   // first, then the textures go in the space left next to and below them.
+   DMAChain dmaChains[FRAME_BUFFERS];
+   PresentBuffer frameBuffers[FRAME_BUFFERS];
+   VRAMAllocator vram;
+
+   initVRAMAllocator(&vram);
+
+   for(int i = 0; i < FRAME_BUFFERS; i++){
+      void *chainMemory = malloc(getChainMemorySize(&chainConfig));
+      assert(chainMemory);
+
+      initChain(&dmaChains[i], &chainConfig, chainMemory);
+
+      frameBuffers[i].chain = &dmaChains[i];
+      placeInVRAM(&vram, SCREEN_WIDTH, SCREEN_HEIGHT, 1, &frameBuffers[i].x, &frameBuffers[i].y);
+   }
+
+   // Input recordings are kept in RAM until they are sent over serial. A minute of
+   // input fits in reclaimed kernel RAM, which saves the heap ~50 KB.
+   InputRecorder inputRecorder;
+#ifdef RECLAIM_KERNEL_RAM
+   InputTick *inputBuffer = arenaAlloc(&kernelArena, INPUT_RECORDING_TICKS * sizeof(InputTick));
+#else
+   InputTick *inputBuffer = malloc(INPUT_RECORDING_TICKS * sizeof(InputTick));
+#endif
+   assert(inputBuffer);
+
+   initInputRecorder(&inputRecorder, inputBuffer, INPUT_RECORDING_TICKS);
+
+   // The room has no normals of its own, so they're worked out for lit mode here.
+   GTEVector16 *roomNormals = malloc(roomModel.faceCount * sizeof(GTEVector16));
+   assert(roomNormals);
+
+#ifdef SAMPLING_PROFILER
+   // Sample where the CPU is spending its time from now on. The results are sent when
+   // asked for over serial.
+   if(initSampler(SAMPLER_DEFAULT_RATE)){
+      startSampler();
+   }
+#endif
+
+   // The HUD's glyph packets are built once and only patched when the text changes.
+   void *hudMemory = malloc(getTextLayerMemorySize(HUD_FIELDS, HUD_GLYPHS, FRAME_BUFFERS));
+   assert(hudMemory);
+
+   // From here on printf() only queues text for the serial port, so it can be left in
+   // without holding up the frame. If too much is queued, the newest text is dropped.
+   initSerialIO(115200);
+   initLogBuffer(LOG_DROP_NEWEST);
+
+   // Everything big has been allocated by now, so report how close to full RAM is.
+#ifdef RECLAIM_KERNEL_RAM
+   LOG_INFO(
+      "reclaimed %d bytes of kernel RAM, %d used\n",
+      (int) kernelArena.capacity, (int) kernelArena.peak
+   );
+#endif
+   printMemoryMap();
 
    
    // Include texture data files
@@ -84,21 +260,42 @@ int main(){
    extern const uint8_t reference_64Data[];
    extern const uint8_t reference_64Palette[];
 
-   // Load the font and wall textures into VRAM
+   // Load the font and wall textures into VRAM. Each texture starts on a texture page
+   // of its own, and 4bpp textures only take up a quarter of their width in VRAM.
+   int textureX, textureY, paletteX, paletteY;
+
    TextureInfo font;
-   uploadIndexedTexture(&font, fontData, SCREEN_WIDTH+16, 0, FONT_WIDTH, FONT_HEIGHT, 
-      fontPalette, SCREEN_WIDTH+16, FONT_HEIGHT, GP0_COLOR_4BPP
+   placeInVRAM(&vram, FONT_WIDTH / 4, FONT_HEIGHT, VRAM_TEXTURE_ALIGN, &textureX, &textureY);
+   placeInVRAM(&vram, 16, 1, VRAM_PALETTE_ALIGN, &paletteX, &paletteY);
+   uploadIndexedTexture(&font, fontData, textureX, textureY, FONT_WIDTH, FONT_HEIGHT, 
+      fontPalette, paletteX, paletteY, GP0_COLOR_4BPP
    );
    TextureInfo reference_64;
-   uploadIndexedTexture(&reference_64, reference_64Data, SCREEN_WIDTH, 0, 64, 64,
-   reference_64Palette,SCREEN_WIDTH, 64, GP0_COLOR_4BPP);
+   placeInVRAM(&vram, 64 / 4, 64, VRAM_TEXTURE_ALIGN, &textureX, &textureY);
+   placeInVRAM(&vram, 16, 1, VRAM_PALETTE_ALIGN, &paletteX, &paletteY);
+   uploadIndexedTexture(&reference_64, reference_64Data, textureX, textureY, 64, 64,
+   reference_64Palette, paletteX, paletteY, GP0_COLOR_4BPP);
+
+   // The stats go one blank line below the title, so they have to move whenever the
+   // title changes.
+   TextLayer hud;
+   initTextLayer(&hud, &font, HUD_FIELDS, HUD_GLYPHS, FRAME_BUFFERS, hudMemory);
+
+   int hudTitle = addTextField(&hud, 0, 0, HUD_TITLE_LENGTH);
+   int hudLines[HUD_LINE_COUNT];
+   setTextField(&hud, hudTitle, helpText);
+
+   for(int i = 0; i < HUD_LINE_COUNT; i++){
+      hudLines[i] = addTextField(&hud, 0, 0, HUD_LINE_LENGTH);
+   }
+   moveHudLines(&hud, hudLines, helpText);
 
    // Used to see if the button is being held down still.
    bool trianglePressed = false;
    bool squarePressed = false;
    // We only want to update these values once per press, not per frame.
    bool showingHelp = true;
-   bool renderTextured = false;
+   RenderMode renderMode = RENDER_FLAT;
    
    // Create and initialise the camera.
    Camera camera;
@@ -110,185 +307,202 @@ int main(){
    camera.pitch = 0;
 
    // controllerInfo will contain which buttons are pressed, etc.
-   ControllerInfo controllerInfo;
-   
-   // Somewhere to store the Sine and Cosine of the camera's yaw value.
-   // This saves us from recalculating it multiple times per frame.
-   int16_t yawSin;
-   int16_t yawCos;
-   
-   // Will hold the z value of each point on a triangle.
-   // It's used later to see if any part of the triangle is visible.
-   int z0, z1, z2;
+   // The snapshot also tells us when the controller was sampled.
+   // controllerInfo starts out cleared, as it's recorded even before a pad is connected.
+   ControllerSnapshot controllerSnapshot;
+   ControllerInfo controllerInfo = { 0 };
+
+   // The camera is updated at a fixed rate, and we keep its previous state around
+   // so the rendered camera can be interpolated between the two.
+   FixedTimestep simTimestep;
+   Camera previousCamera = camera;
+   Camera renderCamera   = camera;
 
    // Keep track of how many polygons are being drawn.
    int polyCount;
-   
-   // the X and Y of the buffer we are currently using.
-   int bufferX = 0;
-   int bufferY = 0;
 
-   // The pointer to the DMA packet.
-   // We allocate space for each packet before we use it.
-   uint32_t *ptr;
+   // Number of frames drawn so far, to tell captures apart.
+   uint32_t frameCount = 0;
+
+   // The renderer only needs to know where the room's arrays are.
+   const Model room = {
+      .faceCount = roomModel.faceCount,
+      .verts     = roomModel.verts,
+      .faces     = roomModel.faces,
+      .normals   = roomNormals
+   };
+   computeFaceNormals(&room, roomNormals);
+
+#ifdef STREAMING_CHAIN
+   // Streaming builds draw the room a cluster at a time, from the farthest to the nearest,
+   // so the GPU can start on the far end of the room while the rest is still being built.
+   ModelCluster roomClusters[RENDER_MAX_CLUSTERS];
+   Tri_Textured *clusterFaces   = malloc(room.faceCount * sizeof(Tri_Textured));
+   GTEVector16  *clusterNormals = malloc(room.faceCount * sizeof(GTEVector16));
+   assert(clusterFaces && clusterNormals);
+
+   int roomClusterCount = buildModelClusters(&room, ROOM_CLUSTER_GRID, roomClusters, clusterFaces, clusterNormals);
+#endif
+   
+#ifdef STREAMING_CHAIN
+   // Streaming builds swap between the two framebuffers themselves.
+   bool usingSecondFrame = false;
+#endif
+
+   // Recording to start replaying on the next frame. Null means the last one made.
+   bool replayRequested = false;
+   const void *replaySource = 0;
+
+   // The flythrough benchmark takes over the camera while it runs. Its results replace
+   // the help text once it's done.
+   Flythrough flythrough = { 0 };
+   Camera flythroughCamera;
+   bool flythroughTextured = false;
+   char flythroughText[HUD_TITLE_LENGTH + 1] = "";
+
+#ifdef FLYTHROUGH_BENCHMARK
+   // Benchmark builds start flying straight away, so they can run unattended.
+   startFlythrough(&flythrough);
+#endif
+
+#ifdef EMBEDDED_INPUT_RECORDING
+   // Builds made for benchmarking start replaying their recording straight away.
+   extern const uint8_t inputRecording[];
+   replayRequested = true;
+   replaySource    = inputRecording;
+#endif
+
+#ifndef STREAMING_CHAIN
+   // From here on the present queue sends each chain to the GPU once it's free, and
+   // switches to its framebuffer at the VBlank after it has been drawn.
+   initPresentQueue(frameBuffers, FRAME_BUFFERS);
+#endif
+
+   resetProfiler();
+   profilerBegin(PROF_FRAME);
+   initFixedTimestep(&simTimestep, SIM_RATE);
 
    for(;;){
+      profilerEnd(PROF_FRAME);
+      profilerBegin(PROF_FRAME);
+
+#ifdef STREAMING_CHAIN
       // Point to the relevant DMA chain for this frame, then swap the active frame.
-      DMAChain *chain = &dmaChains[usingSecondFrame];
+      const PresentBuffer *frameBuffer = &frameBuffers[usingSecondFrame];
       usingSecondFrame = !usingSecondFrame;
 
       // Reset the ordering table to a blank state.
-      clearOrderingTable((chain->orderingTable), ORDERING_TABLE_SIZE);
-      chain->nextPacket = chain->data;
+      resetChain(frameBuffer->chain);
+#else
+      // Wait for the next chain to be free, which also resets it. Double buffered
+      // builds wait for the previous frame to be drawn here, triple buffered ones only
+      // once the CPU is two frames ahead of the GPU.
+      profilerBegin(PROF_GPU_WAIT);
+      const PresentBuffer *frameBuffer = beginPresentFrame();
+      profilerEnd(PROF_GPU_WAIT);
+#endif
+
+      DMAChain *chain = frameBuffer->chain;
+
+      // The X and Y of the buffer we are currently drawing to.
+      int bufferX = frameBuffer->x;
+      int bufferY = frameBuffer->y;
+
+      bool flying = beginFlythroughFrame(&flythrough, &flythroughCamera, &flythroughTextured);
       
-      // Set the Identity Matrix.
-      // Anything mutliplied by this matrix remains unchanged.
-      // Its like setting the camera's rotation to its initial state.
-      gte_setRotationMatrix(
-         ONE,   0,   0,
-         0, ONE,   0,
-         0,   0, ONE
-      );
-      // Now we update the rotation matrix by multiplying the roll, yaw, and pitch appropriately.
-      rotateCurrentMatrix(-camera.roll, camera.yaw, camera.pitch);
+      // Place the framebuffer offset and screen clearing commands last.
+      // This means they will be executed first and be at the back of the screen.
+      // They don't depend on the camera, so they are queued before reading input.
+      queueFrameSetup(chain, bufferX, bufferY, SCREEN_WIDTH, SCREEN_HEIGHT, gp0_rgb(64, 64, 64));
 
-      // Update the translation matrix to move the camera in 3d space.
-      updateTranslationMatrix(-camera.x, -camera.y, -camera.z);
-
-      // Reset the polygon counter to 0
-      polyCount = 0;
-
-      // Iterate over every face in the model specified in RoomModel.h
-      for(uint16_t i = 0; i<roomModel.faceCount; i++){
-         
-         const Tri_Textured *tri = &roomModel.faces[i];
-         
-         // Load the 3 verts into their respective V register.
-         gte_loadV0(&roomModel.verts[tri->vertices[0]]);
-         gte_loadV1(&roomModel.verts[tri->vertices[1]]);
-         gte_loadV2(&roomModel.verts[tri->vertices[2]]);
-         // Perform a perspective transformation on the 3 verts, then perform "Normal Clipping."
-         gte_command(GTE_CMD_RTPT | GTE_SF);
-         gte_command(GTE_CMD_NCLIP);
-         // If the face is facing away from us, don't bother rendering it.
-         if(gte_getMAC0() <= 0){
-            continue;
-         }
+      // Read the controller as late as possible, right before the camera is used.
+      // This returns the results of the last background poll, so it never waits.
+      // The poll was started at the end of the last frame, so the data is fresh.
+      profilerBegin(PROF_INPUT);
+      getControllerSnapshot(&controllerSnapshot);
+      int serialCommand = pollSerialCommand();
 
-         // Calculate the average Z value of all 3 verts.
-         gte_command(GTE_CMD_AVSZ3 | GTE_SF);
-         int zIndex = gte_getOTZ();
-         
-         // If it is too far from the camera, clip it.
-         if((zIndex >= ORDERING_TABLE_SIZE)){
-            continue;
+      // Check if there is a controller connected to port 0 (Port 1 on the console) and read it's info.
+      bool controllerConnected = controllerSnapshot.connected[0] & 1;
+      if(controllerConnected){
+         controllerInfo = controllerSnapshot.pads[0][0];
+      }
+
+      // Start or stop recording, or replay what was last recorded.
+      uint32_t inputFlags =
+         (showingHelp     ? INPUT_FLAG_SHOWING_HELP     : 0) |
+         ((renderMode == RENDER_TEXTURED) ? INPUT_FLAG_RENDER_TEXTURED : 0) |
+         (renderMode << INPUT_FLAG_RENDER_MODE_SHIFT) |
+         (trianglePressed ? INPUT_FLAG_TRIANGLE_PRESSED : 0) |
+         (squarePressed   ? INPUT_FLAG_SQUARE_PRESSED   : 0);
+
+      bool recordingStopped = false;
+
+      if(serialCommand == INPUT_RECORD_SERIAL_COMMAND){
+         if(inputRecorder.mode == INPUT_MODE_RECORDING){
+            stopInputRecording(&inputRecorder);
+            recordingStopped = true;
+         } else {
+            startInputRecording(&inputRecorder, &camera, inputFlags);
          }
-         
-         // If the average value is behind the camera,
-         // Check if any of the corners are in view of the camera.
-         // If not, skip it.
-         if((zIndex <= 0)){
-            __asm__ volatile(
-               "\tmfc2 %0, $16\n"
-               "\tmfc2 %1, $17\n"
-               "\tmfc2 %2, $18\n"
-               : "=r"(z0), "=r"(z1), "=r"(z2)
-            );
-            if(z0 + z1 + z2 == 0){
-               continue;
+      }
+      if((serialCommand == FLYTHROUGH_SERIAL_COMMAND) && !flythrough.active){
+         startFlythrough(&flythrough);
+      }
+      if(serialCommand == INPUT_REPLAY_SERIAL_COMMAND){
+         replayRequested = true;
+         replaySource    = 0;
+      }
+      if(replayRequested){
+         replayRequested = false;
+
+         if(startInputReplay(&inputRecorder, replaySource, &camera, &inputFlags)){
+            showingHelp     = inputFlags & INPUT_FLAG_SHOWING_HELP;
+            renderMode      = (inputFlags & INPUT_FLAG_RENDER_MODE_MASK) >> INPUT_FLAG_RENDER_MODE_SHIFT;
+            if(inputFlags & INPUT_FLAG_RENDER_TEXTURED){
+               renderMode = RENDER_TEXTURED;
             }
-         }
-
-         
-         if(renderTextured){
-            // Calculate the texture UV coords for the verts in this face.
-            uint32_t uv0 = gp0_uv(reference_64.u + roomModel.faces[i].UVs[0].u, reference_64.v + roomModel.faces[i].UVs[0].v, reference_64.clut);
-            uint32_t uv1 = gp0_uv(reference_64.u + roomModel.faces[i].UVs[1].u, reference_64.v + roomModel.faces[i].UVs[1].v, reference_64.page);
-            uint32_t uv2 = gp0_uv(reference_64.u + roomModel.faces[i].UVs[2].u, reference_64.v + roomModel.faces[i].UVs[2].v, 0);
-
-            // Render a triangle at the XY coords calculated via the GTE with the texture UVs calculated above
-            ptr = allocatePacket(chain, zIndex, 7);
-            ptr[0] = 0x808080 | gp0_shadedTriangle(false, true, false);
-            ptr[1] = gte_getSXY0();
-            ptr[2] = uv0;
-            ptr[3] = gte_getSXY1();
-            ptr[4] = uv1;
-            ptr[5] = gte_getSXY2();
-            ptr[6] = uv2;
+            trianglePressed = inputFlags & INPUT_FLAG_TRIANGLE_PRESSED;
+            squarePressed   = inputFlags & INPUT_FLAG_SQUARE_PRESSED;
+            previousCamera  = camera;
          } else {
-            // Render a triangle at the XY coords calculated via the GTE with a flat colour selected using the poly's index.
-            ptr = allocatePacket(chain, zIndex, 4);
-            ptr[0] = colors[i%6] | gp0_shadedTriangle(false, false, false);
-            ptr[1] = gte_getSXY0();
-            ptr[2] = gte_getSXY1();
-            ptr[3] = gte_getSXY2();
+            LOG_WARN("no valid input recording to replay\n");
          }
-         // Increment the polygon counter as we rendered another polygon
-         polyCount++;
-
       }
 
-      // Print the help/debug menu
-      if(showingHelp){
-         char textBuffer[1024]= "\t\tControls\n======================\nL: \t \tMove\nR: \t \tLook\nL2/R2: \tDown/Up\nTriangle:\tToggle this menu\nSquare:\tToggle Textures/Colours\n";
-         sprintf(textBuffer, "%s\nX:%i\nY:%i\nZ:%i\n\np: %d/%d", textBuffer, (int32_t)(camera.x), (int32_t)(camera.y), (int32_t)(camera.z), polyCount, CHAIN_BUFFER_SIZE/8);
-         printString(chain, &font, 0, 0, textBuffer);
+      // Work out how many fixed-length simulation steps it takes to catch up with real time.
+      // If we're running at 30fps, this will run twice per frame so the camera doesn't slow down.
+      int steps = advanceFixedTimestep(&simTimestep);
+      int alpha = getFixedTimestepAlpha(&simTimestep);
+
+      // A replay instead runs exactly one step per frame with the recorded input, and draws
+      // it without interpolating. This way the frames drawn are the same however fast the
+      // build is, so benchmark runs can be compared.
+      if(inputRecorder.mode == INPUT_MODE_REPLAYING){
+         if(replayInputTick(&inputRecorder, &controllerInfo, &controllerConnected)){
+            steps = 1;
+            alpha = 1 << FIXED_TIMESTEP_ALPHA_SHIFT;
+         } else {
+            LOG_INFO("Replay finished\n");
+         }
       }
 
-      // Place the framebuffer offset and screen clearing commands last.
-      // This means they will be executed first and be at the back of the screen.
-      ptr = allocatePacket(chain, ORDERING_TABLE_SIZE -1 , 3);
-      ptr[0] = gp0_rgb(64, 64, 64) | gp0_vramFill();
-      ptr[1] = gp0_xy(bufferX, bufferY);
-      ptr[2] = gp0_xy(SCREEN_WIDTH, SCREEN_HEIGHT);
-
-      ptr = allocatePacket(chain, ORDERING_TABLE_SIZE - 1, 4);
-      ptr[0] = gp0_texpage(0, true, false);
-      ptr[1] = gp0_fbOffset1(bufferX, bufferY);
-      ptr[2] = gp0_fbOffset2(bufferX + SCREEN_WIDTH - 1, bufferY + SCREEN_HEIGHT - 2);
-      ptr[3] = gp0_fbOrigin(bufferX, bufferY);
-
-
-      // Check if there is a controller connected to port 0 (Port 1 on the console) and read it's info.
-      if(getControllerInfo(0, &controllerInfo)){
-
-         // Store the Sine and Cosine values for the camera's yaw as we use it multiple times
-         yawSin = isin(camera.yaw);
-         yawCos = icos(camera.yaw);
-         
-         // Up/Down
-         if(controllerInfo.buttons & BUTTON_MASK_L2) camera.y += 16;
-         if(controllerInfo.buttons & BUTTON_MASK_R2) camera.y -= 16;
-
-         // If the controller type is Dualshock, read the analogue stick values to move and look around
-         if(controllerInfo.type == 0x07){
-            if(controllerInfo.lx>156 || controllerInfo.lx < 100){\
-               camera.x += (((((controllerInfo.lx-127)) * yawCos)>>6) * MOVEMENT_SPEED)>>12;
-               camera.z -= (((((controllerInfo.lx-127)) * -yawSin)>>6) * MOVEMENT_SPEED)>>12;
-            }
-            if(controllerInfo.ly>156 || controllerInfo.ly < 100){
-               camera.x+=(((((controllerInfo.ly-127)) * yawSin)>>6) * MOVEMENT_SPEED)>>12;
-               camera.z-=(((((controllerInfo.ly-127)) * yawCos)>>6) * MOVEMENT_SPEED)>>12;
-            }
-            if(controllerInfo.rx>156 || controllerInfo.rx < 100){
-               camera.yaw -= (((controllerInfo.rx-127)>>6) * CAMERA_SENSITIVITY);
-            }
-            // Update camera pitch
-            if(controllerInfo.ry>156 || controllerInfo.ry<100){
-               camera.pitch += (((controllerInfo.ry-127)>>6) * CAMERA_SENSITIVITY);
-
-               // Lock camera pitch to 90 degrees up or down
-               if((int16_t)camera.pitch > 1024){
-                  camera.pitch = 1024;
-               }
-               if((int16_t)camera.pitch < -1024){
-                  camera.pitch = -1024;
-               }
-            }
+      // The buttons are handled once per step, the same as the camera, so they see exactly
+      // the input that gets recorded and a replay toggles things at the same points.
+      for(; steps > 0; steps--){
+         previousCamera = camera;
+         if(
+            (inputRecorder.mode == INPUT_MODE_RECORDING) &&
+            !recordInputTick(&inputRecorder, &controllerInfo, controllerConnected)
+         ){
+            recordingStopped = true; // The buffer is full
+         }
+         if(!controllerConnected){
+            continue;
          }
 
          // Toggle help menu only if the button isn't still being held.
-         // This prevents the menu from toggling every single frame.
+         // This prevents the menu from toggling every single step.
          if(controllerInfo.buttons & BUTTON_MASK_TRIANGLE){
             if(!trianglePressed){
                trianglePressed = true;
@@ -298,28 +512,198 @@ int main(){
             trianglePressed = false;
          }
 
-         // Similar code for toggling the render type
+         // Similar code for cycling through the render modes
          if(controllerInfo.buttons & BUTTON_MASK_SQUARE){
             if(!squarePressed){
                squarePressed = true;
-               renderTextured = !renderTextured;
+               renderMode = (renderMode + 1) % RENDER_MODE_COUNT;
             }
          }else{
             squarePressed = false;
          }
+
+         updateCamera(&camera, &controllerInfo);
+      }
+
+      // Draw the camera somewhere between the last two steps, depending on how far we are
+      // into the next one. This keeps motion smooth when the frame rate and SIM_RATE differ.
+      interpolateCamera(&renderCamera, &previousCamera, &camera, alpha);
+      if(flying){
+         renderCamera = flythroughCamera;
+      }
+      profilerEnd(PROF_INPUT);
+
+      // Set the Identity Matrix.
+      // Anything mutliplied by this matrix remains unchanged.
+      // Its like setting the camera's rotation to its initial state.
+      gte_setRotationMatrix(
+         ONE,   0,   0,
+         0, ONE,   0,
+         0,   0, ONE
+      );
+      // Now we update the rotation matrix by multiplying the roll, yaw, and pitch appropriately.
+      rotateCurrentMatrix(-renderCamera.roll, renderCamera.yaw, renderCamera.pitch);
+
+      // Update the translation matrix to move the camera in 3d space.
+      updateTranslationMatrix(-renderCamera.x, -renderCamera.y, -renderCamera.z);
+
+      // Transform, cull and queue every face in the model specified in RoomModel.h.
+      // The kernel for the current render mode is picked once here, so the face loop
+      // itself doesn't have to check the mode.
+      RenderMode frameMode = renderMode;
+      if(flying){
+         frameMode = flythroughTextured ? RENDER_TEXTURED : RENDER_FLAT;
+      }
+      RenderKernel renderKernel = getRenderKernel(frameMode);
+
+      profilerBegin(PROF_GEOMETRY);
+#ifdef STREAMING_CHAIN
+      polyCount = renderClusters(chain, renderKernel, roomClusters, roomClusterCount, &reference_64);
+#else
+      polyCount = renderKernel(chain, &room, &reference_64);
+#endif
+      profilerEnd(PROF_GEOMETRY);
+
+      // Asking for a capture is checked before the HUD is drawn, as the captured chain
+      // can't point to the HUD's own packets.
+      bool capturing = pollCaptureTrigger(controllerConnected ? controllerInfo.buttons : 0, serialCommand);
+
+      // Print the help/debug menu
+      profilerBegin(PROF_HUD);
+      // Each line is only rebuilt from the first character that changed, so the HUD
+      // costs next to nothing while the numbers on it stay the same.
+      // It is left out while the flythrough runs, so only the room gets measured.
+      if(showingHelp && !flying){
+         LogStats logStats;
+         getLogStats(&logStats);
+
+         char line[64];
+         char *end;
+
+         end  = formatInt(formatString(line, "X:"), camera.x);
+         *end = 0;
+         setTextField(&hud, hudLines[HUD_LINE_X], line);
+
+         end  = formatInt(formatString(line, "Y:"), camera.y);
+         *end = 0;
+         setTextField(&hud, hudLines[HUD_LINE_Y], line);
+
+         end  = formatInt(formatString(line, "Z:"), camera.z);
+         *end = 0;
+         setTextField(&hud, hudLines[HUD_LINE_Z], line);
+
+         end  = formatInt(formatString(line, "p: "), polyCount);
+         end  = formatString(formatString(end, " "), getRenderModeName(frameMode));
+         *end = 0;
+         setTextField(&hud, hudLines[HUD_LINE_POLYS], line);
+
+         end  = formatInt(formatString(line, "pkt: "), chain->stats.peakWords);
+         end  = formatInt(formatString(end, "/"), chainConfig.packetWords);
+         end  = formatInt(formatString(end, " (drop "), chain->stats.droppedPackets);
+         end  = formatString(end, ")");
+         *end = 0;
+         setTextField(&hud, hudLines[HUD_LINE_PACKETS], line);
+
+         end  = formatInt(formatString(line, "lat: "), ticksToMicroseconds(getProfilerAverage(PROF_LATENCY)));
+         end  = formatInt(formatString(end, "us (max "), ticksToMicroseconds(getProfilerStat(PROF_LATENCY)->max));
+         end  = formatString(end, "us)");
+         *end = 0;
+         setTextField(&hud, hudLines[HUD_LINE_LATENCY], line);
+
+         end  = formatInt(formatString(line, "log: "), logStats.peakUsage);
+         end  = formatInt(formatString(end, "/"), LOG_BUFFER_SIZE);
+         end  = formatInt(formatString(end, " (drop "), logStats.droppedBytes);
+         end  = formatString(end, ")");
+         *end = 0;
+         setTextField(&hud, hudLines[HUD_LINE_LOG], line);
+
+         if(capturing){
+            drawTextLayer(&hud, chain);
+         } else {
+            linkTextLayer(&hud, chain, 0);
+         }
+      }
+      profilerEnd(PROF_HUD);
+
+      // Send the input recording that was just stopped and dump the finished chain over
+      // serial if asked to. Either stalls for a few seconds, so the profiler is reset
+      // afterwards to keep the stall out of its stats.
+      bool stalled = false;
+
+      if(recordingStopped){
+         sendInputRecording(&inputRecorder);
+         stalled = true;
+      }
+#ifdef SAMPLING_PROFILER
+      if(serialCommand == SAMPLER_SERIAL_COMMAND){
+         sendSamplerHistogram();
+         resetSampler();
+         stalled = true;
+      }
+#endif
+      if(capturing){
+         // Any bands already sent have to be linked back up to the rest of the chain
+         // before it can be walked in one go.
+         relinkChainBands(chain);
+         captureChain(chain, &renderCamera, frameCount);
+         stalled = true;
       }
+      if(stalled){
+         resetProfiler();
+         profilerBegin(PROF_FRAME);
+      }
+      frameCount++;
+
+      // Start polling the controllers again. The poll runs in the background while we
+      // wait for the GPU, so the next frame reads input sampled as late as possible.
+      startControllerPoll();
 
+#ifdef STREAMING_CHAIN
       // Wait for the GPU to finish drawing and also wait for Vsync.
+      // When streaming, the GPU has been drawing this frame's chain all along, so the
+      // rest of it is sent first.
+      profilerBegin(PROF_GPU_WAIT);
+      finishChain(chain);
+      waitForDMADone();
       waitForGP0Ready();
+      profilerEnd(PROF_GPU_WAIT);
+#else
+      // Hand the frame over to be drawn once the GPU is free. Its latency is measured
+      // from when the input was read to the VBlank it's shown at.
+      queuePresentFrame((controllerSnapshot.sequence != 0) ? controllerSnapshot.timestamp : 0);
+#endif
+
+      // The GPU is idle (or the frame has been queued) at this point, so this is where
+      // the flythrough's frame time ends.
+      if(flying && endFlythroughFrame(&flythrough, room.faceCount, polyCount, chain)){
+         printFlythroughResults(&flythrough);
+         formatFlythroughResults(&flythrough, flythroughText, sizeof(flythroughText));
+         setTextField(&hud, hudTitle, flythroughText);
+         moveHudLines(&hud, hudLines, flythroughText);
+         showingHelp = true;
+      }
+#ifdef STREAMING_CHAIN
+      profilerBegin(PROF_VSYNC_WAIT);
       waitForVSync();
+      profilerEnd(PROF_VSYNC_WAIT);
 
-      // Swap the frame buffers.
-      bufferY = usingSecondFrame ? SCREEN_HEIGHT : 0;
-      GPU_GP1 = gp1_fbOffset(bufferX, bufferY); 
+      // The frame just built has already been drawn, so it's the one that becomes visible
+      // now. Streaming saves a frame of latency this way.
+      if(controllerSnapshot.sequence != 0){
+         profilerRecord(PROF_LATENCY, getTicks() - controllerSnapshot.timestamp);
+      }
+
+      // Show the buffer that was just drawn to. The next frame draws into the other one.
+      GPU_GP1 = gp1_fbOffset(bufferX, bufferY);
+#else
+      // Frames are shown from the VBlank interrupt, so the latency of whichever was
+      // shown last is picked up here instead.
+      uint32_t latency;
 
-      // Give DMA a pointer to the last item in the ordering table.
-      // We don't need to add a terminator, as it is already done for us by the OTC.
-      sendLinkedList(&(chain->orderingTable)[ORDERING_TABLE_SIZE - 1]);
+      if(getPresentLatency(&latency)){
+         profilerRecord(PROF_LATENCY, latency);
+      }
+#endif
    }
 
    // Stops intellisense from yelling at me.
@@ -0,0 +1,200 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Allocator stress benchmark. Runs the same pseudo-random sequence of malloc(),
+ * realloc() and free() calls against libc's TLSF allocator and the first-fit
+ * allocator it replaced, then prints the cost of each operation over serial.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "include/irq.h"
+#include "include/timer.h"
+
+#include "firstfit.h"
+
+#define SLOT_COUNT       512
+#define OP_COUNT         20000
+#define CYCLES_PER_TICK  8 // The timer runs at sysclk/8
+
+typedef struct{
+   const char *name;
+   void *(*alloc)(size_t size);
+   void *(*resize)(void *ptr, size_t size);
+   void (*release)(void *ptr);
+}Allocator;
+
+typedef struct{
+   uint32_t count, totalTicks, maxTicks;
+}OpStats;
+
+typedef struct{
+   OpStats alloc, resize, release;
+   uint32_t failures;
+   size_t heapGrowth;
+   HeapStats heap; // Only filled in for libc's allocator
+}BenchResult;
+
+static const Allocator allocators[] = {
+   { "first-fit", &firstFitMalloc, &firstFitRealloc, &firstFitFree },
+   { "tlsf",      &malloc,         &realloc,         &free         }
+};
+
+static void *slots[SLOT_COUNT];
+static uint32_t seed;
+static uint32_t timerOverhead;
+
+// Simple LCG, so both allocators see exactly the same sequence of requests.
+static uint32_t nextRandom(void){
+   seed = seed * 1103515245 + 12345;
+   return seed >> 16;
+}
+
+static size_t randomSize(void){
+   // Mostly small objects, with the occasional large buffer.
+   if((nextRandom() & 15) == 0){
+      return 1024 + (nextRandom() % 8192);
+   }
+   return 8 + (nextRandom() % 248);
+}
+
+static void recordOp(OpStats *stats, uint32_t ticks){
+   ticks = (ticks > timerOverhead) ? (ticks - timerOverhead) : 0;
+
+   stats->count++;
+   stats->totalTicks += ticks;
+   if(ticks > stats->maxTicks){
+      stats->maxTicks = ticks;
+   }
+}
+
+static void measureTimerOverhead(void){
+   uint32_t total = 0;
+
+   for(int i = 0; i < 256; i++){
+      uint32_t start = getTicks();
+      total += getTicks() - start;
+   }
+   timerOverhead = total / 256;
+}
+
+static void runBench(const Allocator *allocator, BenchResult *result){
+   __builtin_memset(result, 0, sizeof(BenchResult));
+   __builtin_memset(slots,  0, sizeof(slots));
+   seed = 1;
+
+   uint8_t *heapStart = sbrk(0);
+
+   for(int i = 0; i < OP_COUNT; i++){
+      int slot = nextRandom() % SLOT_COUNT;
+      uint32_t start;
+
+      if(!slots[slot]){
+         size_t size = randomSize();
+
+         start = getTicks();
+         slots[slot] = allocator->alloc(size);
+         recordOp(&result->alloc, getTicks() - start);
+
+         if(!slots[slot]) result->failures++;
+      } else if((nextRandom() & 3) == 0){
+         size_t size = randomSize();
+
+         start = getTicks();
+         void *ptr = allocator->resize(slots[slot], size);
+         recordOp(&result->resize, getTicks() - start);
+
+         if(ptr){
+            slots[slot] = ptr;
+         } else {
+            result->failures++;
+         }
+      } else {
+         start = getTicks();
+         allocator->release(slots[slot]);
+         recordOp(&result->release, getTicks() - start);
+
+         slots[slot] = 0;
+      }
+   }
+
+   result->heapGrowth = (uint8_t *) sbrk(0) - heapStart;
+
+   // Check how fragmented the heap got while it was still full.
+   if(allocator->alloc == &malloc){
+      getHeapStats(&result->heap);
+   }
+
+   // Free everything left over so the next allocator starts from a clean heap.
+   for(int i = 0; i < SLOT_COUNT; i++){
+      if(slots[i]) allocator->release(slots[i]);
+   }
+}
+
+static void printOp(const char *allocator, const char *op, const OpStats *stats){
+   uint32_t average = stats->count ? (stats->totalTicks * CYCLES_PER_TICK / stats->count) : 0;
+
+   printf("%-10s %-8s %6d %8d %8d\n",
+      allocator, op, (int)stats->count, (int)average, (int)(stats->maxTicks * CYCLES_PER_TICK)
+   );
+}
+
+int main(){
+   installExceptionHandler();
+   initTimer();
+   enableInterrupts();
+   initSerialIO(115200);
+
+   measureTimerOverhead();
+
+   printf("\nmalloc benchmark: %d ops, %d slots\n", OP_COUNT, SLOT_COUNT);
+   printf("%-10s %-8s %6s %8s %8s\n", "allocator", "op", "count", "avg cyc", "max cyc");
+
+   for(size_t i = 0; i < sizeof(allocators) / sizeof(Allocator); i++){
+      const Allocator *allocator = &allocators[i];
+      BenchResult result;
+
+      runBench(allocator, &result);
+
+      printOp(allocator->name, "malloc",  &result.alloc);
+      printOp(allocator->name, "realloc", &result.resize);
+      printOp(allocator->name, "free",    &result.release);
+      printf("%-10s heap growth: %d bytes, %d failures\n",
+         allocator->name, (int)result.heapGrowth, (int)result.failures
+      );
+
+      // The TLSF allocator also keeps track of how well it's using the heap.
+      if(allocator->alloc == &malloc){
+         const HeapStats *heap = &result.heap;
+         int fragmentation = heap->freeBytes ? (100 - (int)((uint64_t)heap->largestFreeBlock * 100 / heap->freeBytes)) : 0;
+
+         printf("%-10s heap size %d, used %d, peak %d, free %d, largest free %d (%d%% fragmented)\n",
+            allocator->name, (int)heap->heapSize, (int)heap->usedBytes, (int)heap->peakUsedBytes,
+            (int)heap->freeBytes, (int)heap->largestFreeBlock, fragmentation
+         );
+      }
+   }
+
+   for(;;){
+      __asm__ volatile("");
+   }
+   return 0;
+}
@@ -0,0 +1,240 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * String routine benchmark. Times libc's assembly memcpy(), memmove(),
+ * memcmp(), strcmp() and strlen() against the plain C loops they replaced,
+ * across a range of sizes and source/destination alignments, checks that both
+ * versions agree and prints the results over serial.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "include/irq.h"
+#include "include/timer.h"
+
+#include "reference.h"
+
+#define MAX_SIZE         4096
+#define AREA_SIZE        (MAX_SIZE + 16)
+#define REPEAT_COUNT     16
+#define CYCLES_PER_TICK  8 // The timer runs at sysclk/8
+
+typedef enum{
+   OP_COPY,    // dest and src are separate buffers
+   OP_OVERLAP, // dest overlaps the end of src, forcing a backwards copy
+   OP_COMPARE, // dest is a copy of src with only the last byte changed
+   OP_STRING   // src is null terminated after count bytes
+}OpType;
+
+// Every routine is wrapped to the same signature so they can share one loop.
+typedef int (*StringFunc)(uint8_t *dest, uint8_t *src, size_t count);
+
+typedef struct{
+   const char *name;
+   OpType type;
+   StringFunc reference, optimized;
+}Routine;
+
+typedef struct{
+   int dest, src;
+}Alignment;
+
+static int refMemcpyWrapper(uint8_t *dest, uint8_t *src, size_t count){
+   return (uint8_t *) refMemcpy(dest, src, count) - dest;
+}
+static int asmMemcpyWrapper(uint8_t *dest, uint8_t *src, size_t count){
+   return (uint8_t *) memcpy(dest, src, count) - dest;
+}
+static int refMemmoveWrapper(uint8_t *dest, uint8_t *src, size_t count){
+   return (uint8_t *) refMemmove(dest, src, count) - dest;
+}
+static int asmMemmoveWrapper(uint8_t *dest, uint8_t *src, size_t count){
+   return (uint8_t *) memmove(dest, src, count) - dest;
+}
+static int refMemcmpWrapper(uint8_t *dest, uint8_t *src, size_t count){
+   return refMemcmp(dest, src, count);
+}
+static int asmMemcmpWrapper(uint8_t *dest, uint8_t *src, size_t count){
+   return memcmp(dest, src, count);
+}
+static int refStrcmpWrapper(uint8_t *dest, uint8_t *src, size_t count){
+   return refStrcmp((const char *) dest, (const char *) src);
+}
+static int asmStrcmpWrapper(uint8_t *dest, uint8_t *src, size_t count){
+   return strcmp((const char *) dest, (const char *) src);
+}
+static int refStrlenWrapper(uint8_t *dest, uint8_t *src, size_t count){
+   return refStrlen((const char *) src);
+}
+static int asmStrlenWrapper(uint8_t *dest, uint8_t *src, size_t count){
+   return strlen((const char *) src);
+}
+
+static const Routine routines[] = {
+   { "memcpy",  OP_COPY,    &refMemcpyWrapper,  &asmMemcpyWrapper  },
+   { "memmove", OP_OVERLAP, &refMemmoveWrapper, &asmMemmoveWrapper },
+   { "memcmp",  OP_COMPARE, &refMemcmpWrapper,  &asmMemcmpWrapper  },
+   { "strcmp",  OP_COMPARE, &refStrcmpWrapper,  &asmStrcmpWrapper  },
+   { "strlen",  OP_STRING,  &refStrlenWrapper,  &asmStrlenWrapper  }
+};
+
+static const size_t sizes[] = { 4, 16, 64, 256, 1024, MAX_SIZE };
+
+// Both aligned, both misaligned by the same amount (the fast path), and each
+// side misaligned on its own.
+static const Alignment alignments[] = {
+   { 0, 0 }, { 1, 1 }, { 0, 1 }, { 3, 0 }
+};
+
+// Each implementation gets its own copy of the buffers, so the results can be
+// compared afterwards.
+static uint32_t refArea[AREA_SIZE * 2 / 4];
+static uint32_t asmArea[AREA_SIZE * 2 / 4];
+static uint32_t timerOverhead;
+
+static void measureTimerOverhead(void){
+   uint32_t total = 0;
+
+   for(int i = 0; i < 256; i++){
+      uint32_t start = getTicks();
+      total += getTicks() - start;
+   }
+   timerOverhead = total / 256;
+}
+
+// Fills an area with a known pattern and works out where dest and src go.
+static void prepareArea(
+   uint32_t *area, const Routine *routine, const Alignment *alignment, size_t count,
+   uint8_t **dest, uint8_t **src
+){
+   uint8_t *bytes = (uint8_t *) area;
+
+   // Never zero, so strings only end where we put the terminator.
+   for(int i = 0; i < AREA_SIZE * 2; i++){
+      bytes[i] = (uint8_t) (i * 7) | 1;
+   }
+
+   *src  = &bytes[alignment->src];
+   *dest = &bytes[AREA_SIZE + alignment->dest];
+
+   switch(routine->type){
+      case OP_OVERLAP:
+         *dest = &bytes[8 + alignment->dest];
+         break;
+
+      case OP_COMPARE:
+         // Only the last byte differs, so the whole buffer has to be scanned.
+         // Setting the top bit also checks that bytes are compared unsigned.
+         for(size_t i = 0; i < count; i++){
+            (*dest)[i] = (*src)[i];
+         }
+         (*dest)[count - 1] ^= 0x80;
+         (*src)[count]  = 0;
+         (*dest)[count] = 0;
+         break;
+
+      case OP_STRING:
+         (*src)[count] = 0;
+         break;
+
+      default:
+         break;
+   }
+}
+
+static uint32_t timeRoutine(StringFunc func, uint8_t *dest, uint8_t *src, size_t count, int *result){
+   uint32_t start = getTicks();
+
+   for(int i = 0; i < REPEAT_COUNT; i++){
+      *result = func(dest, src, count);
+   }
+
+   uint32_t ticks = getTicks() - start;
+
+   ticks = (ticks > timerOverhead) ? (ticks - timerOverhead) : 0;
+   return ticks * CYCLES_PER_TICK / REPEAT_COUNT;
+}
+
+static bool resultsMatch(const Routine *routine, int refResult, int asmResult){
+   if(routine->type == OP_COMPARE){
+      // Only the sign of a comparison is meaningful.
+      return ((refResult > 0) == (asmResult > 0)) && ((refResult < 0) == (asmResult < 0));
+   }
+   return refResult == asmResult;
+}
+
+int main(){
+   installExceptionHandler();
+   initTimer();
+   enableInterrupts();
+   initSerialIO(115200);
+
+   measureTimerOverhead();
+
+   int failures = 0;
+
+   printf("\nstring benchmark: %d calls per measurement\n", REPEAT_COUNT);
+   printf("%-8s %5s %4s %4s %8s %8s %8s\n", "routine", "size", "dst", "src", "c cyc", "asm cyc", "speedup");
+
+   for(size_t r = 0; r < sizeof(routines) / sizeof(Routine); r++){
+      const Routine *routine = &routines[r];
+
+      for(size_t s = 0; s < sizeof(sizes) / sizeof(size_t); s++){
+         for(size_t a = 0; a < sizeof(alignments) / sizeof(Alignment); a++){
+            const Alignment *alignment = &alignments[a];
+            size_t count = sizes[s];
+            uint8_t *refDest, *refSrc, *asmDest, *asmSrc;
+            int refResult, asmResult;
+
+            prepareArea(refArea, routine, alignment, count, &refDest, &refSrc);
+            prepareArea(asmArea, routine, alignment, count, &asmDest, &asmSrc);
+
+            uint32_t refCycles = timeRoutine(routine->reference, refDest, refSrc, count, &refResult);
+            uint32_t asmCycles = timeRoutine(routine->optimized, asmDest, asmSrc, count, &asmResult);
+
+            // memmove() shuffles the same area every time it's called, so
+            // both copies only match if both versions got every call right.
+            bool ok = resultsMatch(routine, refResult, asmResult) &&
+               !refMemcmp(refArea, asmArea, sizeof(refArea));
+
+            if(!ok){
+               failures++;
+            }
+
+            uint32_t speedup = asmCycles ? (refCycles * 100 / asmCycles) : 0;
+
+            printf("%-8s %5d %4d %4d %8d %8d %5d.%02dx%s\n",
+               routine->name, (int)count, alignment->dest, alignment->src,
+               (int)refCycles, (int)asmCycles, (int)(speedup / 100), (int)(speedup % 100),
+               ok ? "" : " MISMATCH"
+            );
+         }
+      }
+   }
+
+   printf("%d mismatches\n", failures);
+
+   for(;;){
+      __asm__ volatile("");
+   }
+   return 0;
+}
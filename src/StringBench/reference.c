@@ -0,0 +1,101 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "reference.h"
+
+// GCC may spot these loops and turn them back into calls to the very functions
+// we're comparing against, so that optimization is turned off for this file.
+#pragma GCC optimize("no-tree-loop-distribute-patterns")
+
+void *refMemcpy(void *dest, const void *src, size_t count){
+    uint8_t       *_dest = (uint8_t *) dest;
+    const uint8_t *_src  = (const uint8_t *) src;
+
+    for(; count; count--){
+        *(_dest++) = *(_src++);
+    }
+
+    return dest;
+}
+
+void *refMemmove(void *dest, const void *src, size_t count){
+    uint8_t       *_dest = (uint8_t *) dest;
+    const uint8_t *_src  = (const uint8_t *) src;
+
+    if(_dest == _src){
+        return dest;
+    }
+    if((_dest >= &_src[count]) || (&_dest[count] <= _src)){
+        return refMemcpy(dest, src, count);
+    }
+
+    if(_dest < _src){ // Copy forwards
+        for(; count; count--){
+            *(_dest++) = *(_src++);
+        }
+    } else { // Copy backwards
+        _src  += count;
+        _dest += count;
+
+        for(; count; count--){
+            *(--_dest) = *(--_src);
+        }
+    }
+
+    return dest;
+}
+
+int refMemcmp(const void *lhs, const void *rhs, size_t count){
+    const uint8_t *_lhs = (const uint8_t *) lhs;
+    const uint8_t *_rhs = (const uint8_t *) rhs;
+
+    for(; count; count--){
+        uint8_t a = *(_lhs++), b = *(_rhs++);
+
+        if(a != b){
+            return a - b;
+        }
+    }
+
+    return 0;
+}
+
+int refStrcmp(const char *lhs, const char *rhs){
+    for(;;){
+        uint8_t a = *(lhs++), b = *(rhs++);
+
+        if(a != b){
+            return a - b;
+        }
+        if(!a){
+            return 0;
+        }
+    }
+}
+
+size_t refStrlen(const char *str){
+    size_t length = 0;
+
+    for(; *str; str++){
+        length++;
+    }
+
+    return length;
+}
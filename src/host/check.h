@@ -0,0 +1,61 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Bare-bones checks for the host tests run by ctest. A failed check prints
+ * its line and keeps going, so one run shows every failure; main() ends with
+ * return finishChecks(), which makes the test fail if any check did.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+static int _checkFailures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("line %d: %s\n", __LINE__, #condition); \
+			_checkFailures++; \
+		} \
+	} while (0)
+
+#define CHECK_EQUAL(actual, expected) \
+	checkEqual((int64_t) (actual), (int64_t) (expected), #actual, __LINE__)
+
+static inline void checkEqual(
+	int64_t actual, int64_t expected, const char *expression, int line
+) {
+	if (actual != expected) {
+		printf(
+			"line %d: %s is %lld, expected %lld\n", line, expression,
+			(long long) actual, (long long) expected
+		);
+		_checkFailures++;
+	}
+}
+
+static inline int finishChecks(void) {
+	if (_checkFailures) {
+		printf("%d checks failed\n", _checkFailures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Tests for the fixed-point library (include/fixed.hpp). The CPU matrix and
+ * cross products are compared against MVMVA and OP on the software GTE, and
+ * updateCamera(), which is built on the library, against the hand-written
+ * arithmetic it replaced.
+ */
+
+#include <stdint.h>
+
+#include "check.h"
+#include "include/camera.h"
+#include "include/controller.h"
+#include "include/fixed.hpp"
+#include "include/trig.h"
+#include "ps1/cop0gte.h"
+
+using namespace fixed;
+
+static void testScalars(void){
+   Q12 half  = Q12::fromRaw(ONE / 2);
+   Q12 three = Q12::fromInt(3);
+
+   CHECK_EQUAL((three * half).raw, (ONE * 3) / 2);
+   CHECK_EQUAL((three - half).round(), 3);
+   CHECK_EQUAL((-three).toInt(), -3);
+   CHECK_EQUAL(Q0(three * half).raw, 1);
+   CHECK_EQUAL(Q0(-(three * half)).raw, -2);
+   CHECK_EQUAL(Q12(Q0::fromInt(-5)).raw, -5 * ONE);
+
+   // A Q0 coordinate times a Q12 factor stays a Q0 coordinate.
+   CHECK_EQUAL((Q0::fromInt(1000) * fixed::cos(0)).raw, 1000);
+   CHECK_EQUAL((Q0::fromInt(1000) * fixed::sin(ISIN_PI / 2)).raw, 1000);
+}
+
+// The CPU matrix multiply should give exactly what MVMVA leaves in IR1-3, as
+// long as nothing saturates. Negative components are where truncating each
+// product on its own would go wrong.
+static void testMatrixVector(void){
+   static const int16_t components[] = { 0, 1, -1, 4095, -4096, 12345, -23456, 32767 };
+   const int count = sizeof(components) / sizeof(components[0]);
+
+   for(int angle = 0; angle < (ISIN_PI * 2); angle += 173){
+      Mat3 matrix = Mat3::rotationY(angle) * Mat3::rotationX(angle * 3);
+
+      for(int i = 0; i < count; i++){
+         Vec3q vector = {
+            Q12::fromRaw(components[i]),
+            Q12::fromRaw(components[(i + 3) % count]),
+            Q12::fromRaw(components[(i + 5) % count])
+         };
+
+         Vec3q cpu = matrix * vector;
+
+         gte::loadRotation(matrix);
+         gte::loadIR(vector);
+         gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_RT | GTE_V_IR | GTE_CV_NONE);
+
+         CHECK_EQUAL(cpu.x.raw, gte_getMAC1());
+         CHECK_EQUAL(cpu.y.raw, gte_getMAC2());
+         CHECK_EQUAL(cpu.z.raw, gte_getMAC3());
+      }
+   }
+}
+
+static void testCross(void){
+   Vec3q a = { Q12::fromRaw(1200), Q12::fromRaw(-3400), Q12::fromRaw(560) };
+   Vec3q b = { Q12::fromRaw(-780), Q12::fromRaw(90), Q12::fromRaw(2300) };
+
+   Vec3q cpu = fixed::cross(a, b);
+   Vec3q gpu = gte::cross(a, b);
+
+   CHECK_EQUAL(cpu.x.raw, gpu.x.raw);
+   CHECK_EQUAL(cpu.y.raw, gpu.y.raw);
+   CHECK_EQUAL(cpu.z.raw, gpu.z.raw);
+}
+
+static void testFlags(void){
+   // Large enough for IR1 to saturate.
+   gte_setRotationMatrix(0x7fff, 0, 0, 0, ONE, 0, 0, 0, ONE);
+   gte_setIR1(0x7fff);
+   gte_setIR2(0);
+   gte_setIR3(0);
+   gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_RT | GTE_V_IR | GTE_CV_NONE);
+
+   CHECK_EQUAL((gte_getFlags() & GTE_FLAG_IR1_SATURATED) != 0, true);
+
+   gte_setIR1(ONE);
+   gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_RT | GTE_V_IR | GTE_CV_NONE);
+
+   CHECK_EQUAL(gte_getFlags() & GTE_FLAG_IR1_SATURATED, 0);
+}
+
+// updateCamera() moves along the stick axes with the library; this is the
+// arithmetic it replaced, which it has to match exactly so recordings made
+// before still replay the same.
+static void testCameraMovement(void){
+   for(int yaw = 0; yaw < (ISIN_PI * 2); yaw += 97){
+      for(int axis = 0; axis < 256; axis += 5){
+         int yawSin = isin(yaw), yawCos = icos(yaw);
+
+         Camera camera = { 0 };
+         camera.yaw = yaw;
+
+         ControllerInfo input = { 0 };
+         input.type = 0x07;
+         input.lx   = axis;
+         input.ly   = 255 - axis;
+         input.rx   = input.ry = 127;
+
+         updateCamera(&camera, &input);
+
+         int32_t x = 0, z = 0;
+
+         if((input.lx > 156) || (input.lx < 100)){
+            x += (((((input.lx - 127)) * yawCos) >> 6) * MOVEMENT_SPEED) >> 12;
+            z -= (((((input.lx - 127)) * -yawSin) >> 6) * MOVEMENT_SPEED) >> 12;
+         }
+         if((input.ly > 156) || (input.ly < 100)){
+            x += (((((input.ly - 127)) * yawSin) >> 6) * MOVEMENT_SPEED) >> 12;
+            z -= (((((input.ly - 127)) * yawCos) >> 6) * MOVEMENT_SPEED) >> 12;
+         }
+
+         CHECK_EQUAL(camera.x, x);
+         CHECK_EQUAL(camera.z, z);
+      }
+   }
+}
+
+int main(void){
+   testScalars();
+   testMatrixVector();
+   testCross();
+   testFlags();
+   testCameraMovement();
+
+   return finishChecks();
+}
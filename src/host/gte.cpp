@@ -0,0 +1,793 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Scalar implementation of the software GTE. It works at the register level
+ * (mtc2, mfc2, ctc2, cfc2 and cop2 commands) and follows the PS1's fixed-point
+ * behaviour, including the 44-bit MAC overflow checks, the saturation flags
+ * and the UNR division used by RTPS/RTPT.
+ *
+ * Only the commands used by the renderer are implemented for now; any other
+ * command aborts rather than silently returning garbage.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "include/hal.h"
+#include "ps1/cop0gte.h"
+#include "gte.hpp"
+#include "host.h"
+
+namespace softgte {
+
+/* Helpers */
+
+template<typename T> static inline T clamp(T value, T min, T max) {
+	return (value < min) ? min : ((value > max) ? max : value);
+}
+
+static inline int64_t signExtend44(int64_t value) {
+	return int64_t(uint64_t(value) << 20) >> 20;
+}
+
+static inline uint32_t packXY(int16_t x, int16_t y) {
+	return (uint32_t(uint16_t(x))) | (uint32_t(uint16_t(y)) << 16);
+}
+
+static inline uint32_t signExtend16(uint32_t value) {
+	return uint32_t(int32_t(int16_t(value)));
+}
+
+struct UNRTable {
+	uint8_t values[0x101];
+
+	UNRTable(void) {
+		for (int i = 0; i < 0x101; i++) {
+			int value = ((0x40000 / (i + 0x100)) + 1) / 2 - 0x101;
+
+			values[i] = uint8_t((value < 0) ? 0 : value);
+		}
+	}
+};
+
+static const UNRTable unrTable;
+
+const uint8_t *getUNRTable(void) {
+	return unrTable.values;
+}
+
+static const int32_t noTranslation[3] = { 0, 0, 0 };
+
+/* Flags and saturation */
+
+// MAC1-3 are 44 bits wide internally, and overflows are checked after each
+// addition rather than only on the final result.
+static inline int64_t checkMAC(uint32_t &flag, int index, int64_t value) {
+	if (value > 0x7ffffffffffLL)
+		flag |= GTE_FLAG_MAC1_OVERFLOW >> (index - 1);
+	else if (value < -0x80000000000LL)
+		flag |= GTE_FLAG_MAC1_UNDERFLOW >> (index - 1);
+
+	return signExtend44(value);
+}
+static inline void checkMAC0(uint32_t &flag, int64_t value) {
+	if (value > 0x7fffffffLL)
+		flag |= GTE_FLAG_MAC0_OVERFLOW;
+	else if (value < -0x80000000LL)
+		flag |= GTE_FLAG_MAC0_UNDERFLOW;
+}
+
+static inline int16_t saturateIR(uint32_t &flag, int index, int32_t value, bool lm) {
+	int32_t min = lm ? 0 : -0x8000;
+
+	if ((value < min) || (value > 0x7fff)) {
+		flag |= GTE_FLAG_IR1_SATURATED >> (index - 1);
+		return int16_t(clamp<int32_t>(value, min, 0x7fff));
+	}
+
+	return int16_t(value);
+}
+static inline int64_t saturate(
+	uint32_t &flag, uint32_t bit, int64_t value, int64_t min, int64_t max
+) {
+	if ((value < min) || (value > max)) {
+		flag |= bit;
+		return clamp(value, min, max);
+	}
+
+	return value;
+}
+
+// Multiplies a matrix by a vector and adds a translation vector (scaled up by
+// 12 bits) to the result.
+static inline void transform(
+	uint32_t &flag, int64_t *output, const int16_t (*matrix)[3],
+	const int16_t *vector, const int32_t *translation
+) {
+	for (int i = 0; i < 3; i++) {
+		int64_t value = int64_t(translation[i]) * 4096;
+
+		value = checkMAC(flag, i + 1, value + int32_t(matrix[i][0]) * vector[0]);
+		value = checkMAC(flag, i + 1, value + int32_t(matrix[i][1]) * vector[1]);
+		value = checkMAC(flag, i + 1, value + int32_t(matrix[i][2]) * vector[2]);
+
+		output[i] = value;
+	}
+}
+
+static inline uint32_t divide(uint32_t &flag, uint32_t lhs, uint32_t rhs) {
+	if ((rhs * 2) <= lhs) {
+		flag |= GTE_FLAG_DIVIDE_OVERFLOW;
+		return 0x1ffff;
+	}
+
+	int shift = __builtin_clz(rhs) - 16;
+
+	lhs <<= shift;
+	rhs <<= shift;
+
+	int32_t divisor = int32_t(rhs | 0x8000);
+	int32_t x = 0x101 + unrTable.values[((divisor & 0x7fff) + 0x40) >> 7];
+	int32_t d = ((divisor * -x) + 0x80) >> 8;
+
+	uint32_t reciprocal = uint32_t(((x * (0x20000 + d)) + 0x80) >> 8);
+	uint32_t result     = uint32_t((uint64_t(lhs) * reciprocal + 0x8000) >> 16);
+
+	return (result > 0x1ffff) ? 0x1ffff : result;
+}
+
+/* Projection */
+
+// Everything RTPS does to a single vertex. GTE::rtp() applies the results to
+// the registers.
+struct Projection {
+	int32_t  mac[3];
+	int16_t  ir[3];
+	uint16_t sz;
+	int16_t  sx, sy;
+	int32_t  mac0;
+	int16_t  ir0;
+	uint32_t flag, depthFlag;
+};
+
+static void projectVertex(
+	Projection &out, const ProjectionParams &params, const int16_t *vector,
+	int shift, bool lm
+) {
+	int64_t result[3];
+
+	out.flag      = 0;
+	out.depthFlag = 0;
+
+	transform(out.flag, result, params.rt, vector, params.tr);
+
+	for (int i = 0; i < 3; i++)
+		out.mac[i] = int32_t(result[i] >> shift);
+
+	out.ir[0] = saturateIR(out.flag, 1, out.mac[0], lm);
+	out.ir[1] = saturateIR(out.flag, 2, out.mac[1], lm);
+
+	// IR3 is saturated as usual, but its flag is set based on the value
+	// shifted by 12 bits regardless of sf (and ignoring lm).
+	saturateIR(out.flag, 3, int32_t(result[2] >> 12), false);
+	out.ir[2] = int16_t(clamp<int32_t>(out.mac[2], lm ? 0 : -0x8000, 0x7fff));
+
+	out.sz = uint16_t(saturate(out.flag, GTE_FLAG_Z_SATURATED, result[2] >> 12, 0, 0xffff));
+
+	int64_t quotient = divide(out.flag, params.h, out.sz);
+	int64_t x        = quotient * out.ir[0] + params.ofx;
+	int64_t y        = quotient * out.ir[1] + params.ofy;
+
+	checkMAC0(out.flag, x);
+	checkMAC0(out.flag, y);
+	out.sx = int16_t(saturate(out.flag, GTE_FLAG_SX2_SATURATED, x >> 16, -0x400, 0x3ff));
+	out.sy = int16_t(saturate(out.flag, GTE_FLAG_SY2_SATURATED, y >> 16, -0x400, 0x3ff));
+
+	int64_t depth = quotient * params.dqa + params.dqb;
+
+	checkMAC0(out.depthFlag, depth);
+	out.mac0 = int32_t(depth);
+	out.ir0  = int16_t(saturate(out.depthFlag, GTE_FLAG_IR0_SATURATED, depth >> 12, 0, 0x1000));
+}
+
+ProjectedVertex projectVertex(
+	const ProjectionParams &params, const GTEVector16 &input, bool lm
+) {
+	const int16_t vector[3] = { input.x, input.y, input.z };
+	Projection    projection;
+	ProjectedVertex output;
+
+	projectVertex(projection, params, vector, 12, lm);
+
+	output.sx        = projection.sx;
+	output.sy        = projection.sy;
+	output.sz        = projection.sz;
+	output.ir0       = projection.ir0;
+	output.flag      = projection.flag;
+	output.depthFlag = projection.depthFlag;
+	return output;
+}
+
+/* Commands */
+
+void GTE::pushSZ(int64_t value) {
+	sz[0] = sz[1];
+	sz[1] = sz[2];
+	sz[2] = sz[3];
+	sz[3] = uint16_t(value);
+}
+
+void GTE::pushSXY(int64_t x, int64_t y) {
+	sxy[0][0] = sxy[1][0];
+	sxy[0][1] = sxy[1][1];
+	sxy[1][0] = sxy[2][0];
+	sxy[1][1] = sxy[2][1];
+	sxy[2][0] = int16_t(x);
+	sxy[2][1] = int16_t(y);
+}
+
+void GTE::setMACAndIR(int index, int64_t value, int shift, bool lm) {
+	mac[index] = int32_t(value >> shift);
+	ir[index]  = saturateIR(flag, index, mac[index], lm);
+}
+
+void GTE::rtp(const int16_t *vector, int shift, bool lm, bool last) {
+	Projection projection;
+
+	projectVertex(projection, proj, vector, shift, lm);
+
+	for (int i = 0; i < 3; i++) {
+		mac[i + 1] = projection.mac[i];
+		ir[i + 1]  = projection.ir[i];
+	}
+
+	pushSZ(projection.sz);
+	pushSXY(projection.sx, projection.sy);
+	flag |= projection.flag;
+
+	if (last) {
+		mac[0] = projection.mac0;
+		ir[0]  = projection.ir0;
+		flag  |= projection.depthFlag;
+	}
+}
+
+void GTE::mvmva(uint32_t cmd, int shift, bool lm) {
+	int16_t garbage[3][3];
+	const int16_t (*matrix)[3];
+
+	switch (cmd & GTE_MX_BITMASK) {
+		case GTE_MX_RT:
+			matrix = proj.rt;
+			break;
+
+		case GTE_MX_LLM:
+			matrix = llm;
+			break;
+
+		case GTE_MX_LCM:
+			matrix = lcm;
+			break;
+
+		default:
+			// The "reserved" matrix is made up of whatever happens to be on
+			// the GTE's internal buses.
+			garbage[0][0] = int16_t(-(rgbc[0] << 4));
+			garbage[0][1] = int16_t(rgbc[0] << 4);
+			garbage[0][2] = ir[0];
+			garbage[1][0] = proj.rt[0][2];
+			garbage[1][1] = proj.rt[0][2];
+			garbage[1][2] = proj.rt[0][2];
+			garbage[2][0] = proj.rt[1][1];
+			garbage[2][1] = proj.rt[1][1];
+			garbage[2][2] = proj.rt[1][1];
+			matrix = garbage;
+			break;
+	}
+
+	v[3][0] = ir[1];
+	v[3][1] = ir[2];
+	v[3][2] = ir[3];
+
+	const int16_t *vector = v[(cmd & GTE_V_BITMASK) >> 15];
+	int64_t result[3];
+
+	switch (cmd & GTE_CV_BITMASK) {
+		case GTE_CV_TR:
+			transform(flag, result, matrix, vector, proj.tr);
+			break;
+
+		case GTE_CV_BK:
+			transform(flag, result, matrix, vector, bk);
+			break;
+
+		case GTE_CV_FC:
+			// Hardware bug: the first column is added to the far color and
+			// checked for overflow, but the result is then thrown away.
+			for (int i = 0; i < 3; i++) {
+				int64_t value = checkMAC(
+					flag, i + 1,
+					(int64_t(fc[i]) * 4096) + int32_t(matrix[i][0]) * vector[0]
+				);
+
+				saturateIR(flag, i + 1, int32_t(value >> shift), false);
+
+				value     = checkMAC(flag, i + 1, int32_t(matrix[i][1]) * vector[1]);
+				result[i] = checkMAC(flag, i + 1, value + int32_t(matrix[i][2]) * vector[2]);
+			}
+			break;
+
+		default:
+			transform(flag, result, matrix, vector, noTranslation);
+			break;
+	}
+
+	for (int i = 0; i < 3; i++)
+		setMACAndIR(i + 1, result[i], shift, lm);
+}
+
+void GTE::nclip(void) {
+	int64_t value =
+		int64_t(sxy[0][0]) * sxy[1][1] +
+		int64_t(sxy[1][0]) * sxy[2][1] +
+		int64_t(sxy[2][0]) * sxy[0][1] -
+		int64_t(sxy[0][0]) * sxy[2][1] -
+		int64_t(sxy[1][0]) * sxy[0][1] -
+		int64_t(sxy[2][0]) * sxy[1][1];
+
+	checkMAC0(flag, value);
+	mac[0] = int32_t(value);
+}
+
+void GTE::avsz(int count) {
+	int64_t value;
+
+	if (count == 3)
+		value = int64_t(zsf3) * (uint32_t(sz[1]) + sz[2] + sz[3]);
+	else
+		value = int64_t(zsf4) * (uint32_t(sz[0]) + sz[1] + sz[2] + sz[3]);
+
+	checkMAC0(flag, value);
+	mac[0] = int32_t(value);
+	otz    = uint16_t(saturate(flag, GTE_FLAG_Z_SATURATED, value >> 12, 0, 0xffff));
+}
+
+void GTE::sqr(int shift, bool lm) {
+	for (int i = 1; i <= 3; i++)
+		setMACAndIR(i, checkMAC(flag, i, int32_t(ir[i]) * ir[i]), shift, lm);
+}
+
+void GTE::op(int shift, bool lm) {
+	int32_t d1 = proj.rt[0][0], d2 = proj.rt[1][1], d3 = proj.rt[2][2];
+
+	int64_t x = checkMAC(flag, 1, int64_t(ir[3]) * d2 - int64_t(ir[2]) * d3);
+	int64_t y = checkMAC(flag, 2, int64_t(ir[1]) * d3 - int64_t(ir[3]) * d1);
+	int64_t z = checkMAC(flag, 3, int64_t(ir[2]) * d1 - int64_t(ir[1]) * d2);
+
+	setMACAndIR(1, x, shift, lm);
+	setMACAndIR(2, y, shift, lm);
+	setMACAndIR(3, z, shift, lm);
+}
+
+// Copies MAC1-3 to IR1-3 and pushes them onto the color FIFO along with RGBC's
+// code byte, as the last step of every color command.
+void GTE::pushColor(bool lm) {
+	uint32_t color = uint32_t(rgbc[3]) << 24;
+
+	for (int i = 1; i <= 3; i++) {
+		ir[i] = saturateIR(flag, i, mac[i], lm);
+
+		int64_t value = saturate(
+			flag, GTE_FLAG_R_SATURATED >> (i - 1), mac[i] >> 4, 0, 0xff
+		);
+		color |= uint32_t(value) << ((i - 1) * 8);
+	}
+
+	rgb[0] = rgb[1];
+	rgb[1] = rgb[2];
+	rgb[2] = color;
+}
+
+void GTE::nccs(int shift, bool lm) {
+	int64_t result[3];
+
+	// Light intensities from the normal in V0, then their colors plus the
+	// background color.
+	transform(flag, result, llm, v[0], noTranslation);
+
+	for (int i = 0; i < 3; i++)
+		setMACAndIR(i + 1, result[i], shift, lm);
+
+	transform(flag, result, lcm, &ir[1], bk);
+
+	for (int i = 0; i < 3; i++)
+		setMACAndIR(i + 1, result[i], shift, lm);
+
+	// Multiply the result by RGBC.
+	for (int i = 0; i < 3; i++) {
+		int64_t value = checkMAC(flag, i + 1, int64_t(rgbc[i]) * ir[i + 1] * 16);
+
+		mac[i + 1] = int32_t(value >> shift);
+	}
+
+	pushColor(lm);
+}
+
+void GTE::dpcs(int shift, bool lm) {
+	// Interpolate from RGBC towards the far color using IR0.
+	for (int i = 0; i < 3; i++) {
+		int64_t color = int64_t(rgbc[i]) << 16;
+		int64_t delta = checkMAC(flag, i + 1, (int64_t(fc[i]) * 4096) - color);
+
+		ir[i + 1] = saturateIR(flag, i + 1, int32_t(delta >> shift), false);
+
+		int64_t value = checkMAC(flag, i + 1, int64_t(ir[i + 1]) * ir[0] + color);
+
+		mac[i + 1] = int32_t(value >> shift);
+	}
+
+	pushColor(lm);
+}
+
+void GTE::command(uint32_t cmd) {
+	int  shift = (cmd & GTE_SF) ? 12 : 0;
+	bool lm    = (cmd & GTE_LM) ? true : false;
+
+	flag = 0;
+
+	switch (cmd & GTE_CMD_BITMASK) {
+		case GTE_CMD_RTPS:
+			rtp(v[0], shift, lm, true);
+			break;
+
+		case GTE_CMD_RTPT:
+			rtp(v[0], shift, lm, false);
+			rtp(v[1], shift, lm, false);
+			rtp(v[2], shift, lm, true);
+			break;
+
+		case GTE_CMD_NCLIP:
+			nclip();
+			break;
+
+		case GTE_CMD_AVSZ3:
+			avsz(3);
+			break;
+
+		case GTE_CMD_AVSZ4:
+			avsz(4);
+			break;
+
+		case GTE_CMD_MVMVA:
+			mvmva(cmd, shift, lm);
+			break;
+
+		case GTE_CMD_SQR:
+			sqr(shift, lm);
+			break;
+
+		case GTE_CMD_OP:
+			op(shift, lm);
+			break;
+
+		case GTE_CMD_NCCS:
+			nccs(shift, lm);
+			break;
+
+		case GTE_CMD_DPCS:
+			dpcs(shift, lm);
+			break;
+
+		default:
+			fprintf(stderr, "GTE command 0x%02x is not implemented\n", cmd & GTE_CMD_BITMASK);
+			abort();
+	}
+
+	flag = updateErrorFlag(flag);
+}
+
+/* Registers */
+
+static inline uint32_t packMatrix(const int16_t (*m)[3], int reg) {
+	const int16_t *values = &m[0][0];
+
+	if (reg == 4)
+		return signExtend16(uint16_t(values[8]));
+
+	return packXY(values[reg * 2], values[reg * 2 + 1]);
+}
+
+static inline void unpackMatrix(int16_t (*m)[3], int reg, uint32_t value) {
+	int16_t *values = &m[0][0];
+
+	if (reg == 4) {
+		values[8] = int16_t(value);
+	} else {
+		values[reg * 2]     = int16_t(value);
+		values[reg * 2 + 1] = int16_t(value >> 16);
+	}
+}
+
+void GTE::reset(void) {
+	__builtin_memset(this, 0, sizeof(GTE));
+}
+
+uint32_t GTE::getData(int reg) const {
+	switch (reg) {
+		case GTE_VXY0:
+		case GTE_VXY1:
+		case GTE_VXY2:
+			return packXY(v[reg / 2][0], v[reg / 2][1]);
+
+		case GTE_VZ0:
+		case GTE_VZ1:
+		case GTE_VZ2:
+			return uint32_t(int32_t(v[reg / 2][2]));
+
+		case GTE_RGBC:
+			return uint32_t(rgbc[0]) | (uint32_t(rgbc[1]) << 8)
+				| (uint32_t(rgbc[2]) << 16) | (uint32_t(rgbc[3]) << 24);
+
+		case GTE_OTZ:
+			return otz;
+
+		case GTE_IR0 ... GTE_IR3:
+			return uint32_t(int32_t(ir[reg - GTE_IR0]));
+
+		case GTE_SXY0 ... GTE_SXY2:
+			return packXY(sxy[reg - GTE_SXY0][0], sxy[reg - GTE_SXY0][1]);
+
+		case GTE_SXYP:
+			return packXY(sxy[2][0], sxy[2][1]);
+
+		case GTE_SZ0 ... GTE_SZ3:
+			return sz[reg - GTE_SZ0];
+
+		case GTE_RGB0 ... GTE_RGB2:
+			return rgb[reg - GTE_RGB0];
+
+		case GTE_MAC0 ... GTE_MAC3:
+			return uint32_t(mac[reg - GTE_MAC0]);
+
+		case GTE_IRGB:
+		case GTE_ORGB: {
+			uint32_t value = 0;
+
+			for (int i = 0; i < 3; i++)
+				value |= uint32_t(clamp(ir[i + 1] >> 7, 0, 0x1f)) << (i * 5);
+
+			return value;
+		}
+
+		case GTE_LZCS:
+			return lzcs;
+
+		case GTE_LZCR:
+			// Counts the leading bits that are equal to the sign bit.
+			return uint32_t(__builtin_clz(((lzcs & 0x80000000) ? ~lzcs : lzcs) | 1))
+				+ (((lzcs == 0) || (lzcs == 0xffffffff)) ? 1 : 0);
+
+		default:
+			// Register 23 (RES1) is unused.
+			return res1;
+	}
+}
+
+void GTE::setData(int reg, uint32_t value) {
+	switch (reg) {
+		case GTE_VXY0:
+		case GTE_VXY1:
+		case GTE_VXY2:
+			v[reg / 2][0] = int16_t(value);
+			v[reg / 2][1] = int16_t(value >> 16);
+			break;
+
+		case GTE_VZ0:
+		case GTE_VZ1:
+		case GTE_VZ2:
+			v[reg / 2][2] = int16_t(value);
+			break;
+
+		case GTE_RGBC:
+			for (int i = 0; i < 4; i++)
+				rgbc[i] = uint8_t(value >> (i * 8));
+			break;
+
+		case GTE_OTZ:
+			otz = uint16_t(value);
+			break;
+
+		case GTE_IR0 ... GTE_IR3:
+			ir[reg - GTE_IR0] = int16_t(value);
+			break;
+
+		case GTE_SXY0 ... GTE_SXY2:
+			sxy[reg - GTE_SXY0][0] = int16_t(value);
+			sxy[reg - GTE_SXY0][1] = int16_t(value >> 16);
+			break;
+
+		case GTE_SXYP:
+			// Writing to SXYP pushes a new entry onto the FIFO.
+			pushSXY(int16_t(value), int16_t(value >> 16));
+			break;
+
+		case GTE_SZ0 ... GTE_SZ3:
+			sz[reg - GTE_SZ0] = uint16_t(value);
+			break;
+
+		case GTE_RGB0 ... GTE_RGB2:
+			rgb[reg - GTE_RGB0] = value;
+			break;
+
+		case GTE_MAC0 ... GTE_MAC3:
+			mac[reg - GTE_MAC0] = int32_t(value);
+			break;
+
+		case GTE_IRGB:
+			ir[1] = int16_t((value & 0x1f) << 7);
+			ir[2] = int16_t(((value >> 5) & 0x1f) << 7);
+			ir[3] = int16_t(((value >> 10) & 0x1f) << 7);
+			break;
+
+		case GTE_LZCS:
+			lzcs = value;
+			break;
+
+		case GTE_ORGB:
+		case GTE_LZCR:
+			// Read-only
+			break;
+
+		default:
+			res1 = value;
+			break;
+	}
+}
+
+uint32_t GTE::getControl(int reg) const {
+	switch (reg) {
+		case GTE_RT11RT12 ... GTE_RT33:
+			return packMatrix(proj.rt, reg - GTE_RT11RT12);
+
+		case GTE_TRX ... GTE_TRZ:
+			return uint32_t(proj.tr[reg - GTE_TRX]);
+
+		case GTE_L11L12 ... GTE_L33:
+			return packMatrix(llm, reg - GTE_L11L12);
+
+		case GTE_RBK ... GTE_BBK:
+			return uint32_t(bk[reg - GTE_RBK]);
+
+		case GTE_LC11LC12 ... GTE_LC33:
+			return packMatrix(lcm, reg - GTE_LC11LC12);
+
+		case GTE_RFC ... GTE_BFC:
+			return uint32_t(fc[reg - GTE_RFC]);
+
+		case GTE_OFX:
+			return uint32_t(proj.ofx);
+
+		case GTE_OFY:
+			return uint32_t(proj.ofy);
+
+		case GTE_H:
+			// H is unsigned, but reading it back sign extends it.
+			return signExtend16(proj.h);
+
+		case GTE_DQA:
+			return signExtend16(uint16_t(proj.dqa));
+
+		case GTE_DQB:
+			return uint32_t(proj.dqb);
+
+		case GTE_ZSF3:
+			return signExtend16(uint16_t(zsf3));
+
+		case GTE_ZSF4:
+			return signExtend16(uint16_t(zsf4));
+
+		default:
+			return flag;
+	}
+}
+
+void GTE::setControl(int reg, uint32_t value) {
+	switch (reg) {
+		case GTE_RT11RT12 ... GTE_RT33:
+			unpackMatrix(proj.rt, reg - GTE_RT11RT12, value);
+			break;
+
+		case GTE_TRX ... GTE_TRZ:
+			proj.tr[reg - GTE_TRX] = int32_t(value);
+			break;
+
+		case GTE_L11L12 ... GTE_L33:
+			unpackMatrix(llm, reg - GTE_L11L12, value);
+			break;
+
+		case GTE_RBK ... GTE_BBK:
+			bk[reg - GTE_RBK] = int32_t(value);
+			break;
+
+		case GTE_LC11LC12 ... GTE_LC33:
+			unpackMatrix(lcm, reg - GTE_LC11LC12, value);
+			break;
+
+		case GTE_RFC ... GTE_BFC:
+			fc[reg - GTE_RFC] = int32_t(value);
+			break;
+
+		case GTE_OFX:
+			proj.ofx = int32_t(value);
+			break;
+
+		case GTE_OFY:
+			proj.ofy = int32_t(value);
+			break;
+
+		case GTE_H:
+			proj.h = uint16_t(value);
+			break;
+
+		case GTE_DQA:
+			proj.dqa = int16_t(value);
+			break;
+
+		case GTE_DQB:
+			proj.dqb = int32_t(value);
+			break;
+
+		case GTE_ZSF3:
+			zsf3 = int16_t(value);
+			break;
+
+		case GTE_ZSF4:
+			zsf4 = int16_t(value);
+			break;
+
+		default:
+			flag = updateErrorFlag(value & 0x7ffff000);
+			break;
+	}
+}
+
+}
+
+/* HAL interface */
+
+static softgte::GTE gte;
+
+extern "C" uint32_t hal_gteGetData(int reg) {
+	return gte.getData(reg & 31);
+}
+extern "C" void hal_gteSetData(int reg, uint32_t value) {
+	gte.setData(reg & 31, value);
+}
+extern "C" uint32_t hal_gteGetControl(int reg) {
+	return gte.getControl(reg & 31);
+}
+extern "C" void hal_gteSetControl(int reg, uint32_t value) {
+	gte.setControl(reg & 31, value);
+}
+extern "C" void hal_gteCommand(uint32_t command) {
+	gte.command(command);
+}
+
+extern "C" void hostResetGTE(void) {
+	gte.reset();
+}
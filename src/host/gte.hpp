@@ -0,0 +1,189 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Software GTE library. GTE is a register-level model of the coprocessor
+ * (used by the host build through include/hal.h), while the projection
+ * functions give offline tools the result of RTPS/RTPT for large numbers of
+ * vertices at once. Both are bit-exact with the console for the commands they
+ * implement, including saturation and FLAG behaviour.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ps1/cop0gte.h"
+
+namespace softgte {
+
+/* Projection */
+
+// Every register RTPS and RTPT read, other than the vertex itself.
+struct ProjectionParams {
+	int16_t  rt[3][3];
+	int32_t  tr[3];
+	int32_t  ofx, ofy;
+	uint16_t h;
+	int16_t  dqa;
+	int32_t  dqb;
+};
+
+// What RTPS would leave in SXY2, SZ3 and IR0 for a vertex. The FLAG bits are
+// split in two, as RTPT only performs the depth cueing step (which sets MAC0
+// and IR0) for its last vertex.
+struct ProjectedVertex {
+	int16_t  sx, sy;
+	uint16_t sz;
+	int16_t  ir0;
+	uint32_t flag, depthFlag;
+};
+
+enum ProjectionPath {
+	PROJECT_AUTO   = 0, // Fastest path the CPU supports
+	PROJECT_SCALAR = 1,
+	PROJECT_SSE2   = 2,
+	PROJECT_AVX2   = 3
+};
+
+// Projects vertices as RTPS with sf=1 would. The scalar path runs the same
+// code as the GTE class; the SIMD paths produce identical results, but fall
+// back to the scalar one if the translation vector is large enough for the
+// 44-bit accumulators to overflow.
+void project(
+	const ProjectionParams &params, const GTEVector16 *input,
+	ProjectedVertex *output, size_t count, bool lm = false,
+	ProjectionPath path = PROJECT_AUTO
+);
+
+// Projects a single vertex using the scalar path.
+ProjectedVertex projectVertex(
+	const ProjectionParams &params, const GTEVector16 &input, bool lm = false
+);
+
+// Returns the path PROJECT_AUTO resolves to on this CPU.
+ProjectionPath getBestProjectionPath(void);
+const char *getProjectionPathName(ProjectionPath path);
+
+// The 257-entry reciprocal table used by the division unit.
+const uint8_t *getUNRTable(void);
+
+// Sets or clears the error bit (bit 31) based on the other bits.
+static inline uint32_t updateErrorFlag(uint32_t flag) {
+	return (flag & 0x7f87e000) ? (flag | GTE_FLAG_ERROR) : (flag & ~GTE_FLAG_ERROR);
+}
+
+// FLAG as it would be after an RTPT on the three vertices.
+static inline uint32_t getRTPTFlag(
+	const ProjectedVertex &v0, const ProjectedVertex &v1,
+	const ProjectedVertex &v2
+) {
+	return updateErrorFlag(v0.flag | v1.flag | v2.flag | v2.depthFlag);
+}
+
+// MAC0 after NCLIP. The screen coordinates are saturated to 11 bits, so this
+// can never overflow.
+static inline int32_t nclip(
+	const ProjectedVertex &v0, const ProjectedVertex &v1,
+	const ProjectedVertex &v2
+) {
+	return
+		int32_t(v0.sx) * v1.sy + int32_t(v1.sx) * v2.sy +
+		int32_t(v2.sx) * v0.sy - int32_t(v0.sx) * v2.sy -
+		int32_t(v1.sx) * v0.sy - int32_t(v2.sx) * v1.sy;
+}
+
+// OTZ after AVSZ3. FLAG bits set by the command are ORed into flag.
+static inline uint16_t avsz3(
+	int16_t zsf3, const ProjectedVertex &v0, const ProjectedVertex &v1,
+	const ProjectedVertex &v2, uint32_t &flag
+) {
+	int64_t value = int64_t(zsf3) * (uint32_t(v0.sz) + v1.sz + v2.sz);
+
+	if (value > 0x7fffffffLL)
+		flag |= GTE_FLAG_MAC0_OVERFLOW;
+	else if (value < -0x80000000LL)
+		flag |= GTE_FLAG_MAC0_UNDERFLOW;
+
+	value >>= 12;
+
+	if ((value < 0) || (value > 0xffff)) {
+		flag |= GTE_FLAG_Z_SATURATED;
+		return (value < 0) ? 0 : 0xffff;
+	}
+
+	return uint16_t(value);
+}
+
+/* Register-level model */
+
+class GTE {
+private:
+	// Data registers
+	int16_t  v[4][3]; // V0-V2, plus IR1-IR3 as v[3] when MVMVA needs it
+	uint8_t  rgbc[4];
+	uint16_t otz;
+	int16_t  ir[4];
+	int16_t  sxy[3][2];
+	uint16_t sz[4];
+	uint32_t rgb[3], res1;
+	int32_t  mac[4];
+	uint32_t lzcs;
+
+	// Control registers (RT, TR, OFX/OFY, H, DQA and DQB are in proj)
+	ProjectionParams proj;
+	int16_t  llm[3][3], lcm[3][3];
+	int32_t  bk[3], fc[3];
+	int16_t  zsf3, zsf4;
+	uint32_t flag;
+
+	void pushSZ(int64_t value);
+	void pushSXY(int64_t x, int64_t y);
+	void setMACAndIR(int index, int64_t value, int shift, bool lm);
+
+	void rtp(const int16_t *vector, int shift, bool lm, bool last);
+	void mvmva(uint32_t cmd, int shift, bool lm);
+	void nclip(void);
+	void avsz(int count);
+	void sqr(int shift, bool lm);
+	void op(int shift, bool lm);
+	void pushColor(bool lm);
+	void nccs(int shift, bool lm);
+	void dpcs(int shift, bool lm);
+
+public:
+	GTE(void) {
+		reset();
+	}
+
+	void reset(void);
+
+	uint32_t getData(int reg) const;
+	void setData(int reg, uint32_t value);
+	uint32_t getControl(int reg) const;
+	void setControl(int reg, uint32_t value);
+	void command(uint32_t cmd);
+
+	inline const ProjectionParams &getProjectionParams(void) const {
+		return proj;
+	}
+	inline int16_t getZSF3(void) const {
+		return zsf3;
+	}
+};
+
+}
@@ -0,0 +1,282 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Host backend for include/hal.h. Instead of driving real hardware, GP0 writes
+ * and DMA transfers are appended to a buffer holding the current frame, which
+ * is hashed (and optionally saved to a file) whenever the VBlank interrupt is
+ * acknowledged. This makes it possible to check a change to the renderer
+ * produces exactly the same command stream without running it on a console.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+#include "include/hal.h"
+#include "include/timer.h"
+#include "ps1/registers.h"
+#include "host.h"
+
+#define WINDOW_SIZE 0x1000000
+
+// If a linked list is longer than this, it's most likely looping forever.
+#define MAX_LIST_PACKETS (HOST_RAM_SIZE / 4)
+
+static uint8_t *_ramBase = 0;
+static size_t _ramUsed = 0;
+
+static uint32_t *_frame = 0;
+static size_t _frameLength = 0, _frameCapacity = 0;
+static HostFrameInfo _lastFrame;
+static FILE *_recording = 0;
+
+static uint32_t _cop0[32];
+
+/* Memory */
+
+void *hostAllocRAM(size_t size){
+    if(!_ramBase){
+        // Map twice the window's size, so there's always a 16 MB aligned window
+        // somewhere inside it. Pages that are never touched cost nothing.
+        uint8_t *ptr = mmap(
+            0, WINDOW_SIZE * 2, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
+        );
+        if(ptr == MAP_FAILED){
+            perror("mmap");
+            abort();
+        }
+
+        _ramBase = (uint8_t *) (((uintptr_t) ptr + WINDOW_SIZE - 1) & ~((uintptr_t) WINDOW_SIZE - 1));
+    }
+
+    size = (size + 7) & ~7;
+    if(size > (HOST_RAM_SIZE - _ramUsed)){
+        return 0;
+    }
+
+    void *ptr = &_ramBase[_ramUsed];
+    _ramUsed += size;
+    return ptr;
+}
+
+// Only used by asserts, so it's unused in release builds.
+__attribute__((unused)) static bool _isInRAM(const void *ptr){
+    return _ramBase
+        && ((const uint8_t *) ptr >= _ramBase)
+        && ((const uint8_t *) ptr < &_ramBase[HOST_RAM_SIZE]);
+}
+
+static uint32_t *_resolveAddress(uint32_t address){
+    assert((address & 0xffffff) < HOST_RAM_SIZE);
+    return (uint32_t *) &_ramBase[address & 0xffffff];
+}
+
+/* Frame recording */
+
+static void _recordWord(uint32_t value){
+    if(_frameLength >= _frameCapacity){
+        _frameCapacity = _frameCapacity ? (_frameCapacity * 2) : 0x4000;
+        _frame = realloc(_frame, _frameCapacity * sizeof(uint32_t));
+
+        if(!_frame){
+            fprintf(stderr, "Out of memory recording frame\n");
+            abort();
+        }
+    }
+
+    _frame[_frameLength++] = value;
+}
+
+static void _writeWord(FILE *file, uint32_t value){
+    uint8_t bytes[4] = {
+        (uint8_t) value, (uint8_t) (value >> 8),
+        (uint8_t) (value >> 16), (uint8_t) (value >> 24)
+    };
+
+    fwrite(bytes, 1, 4, file);
+}
+
+static void _endFrame(void){
+    uint32_t hash = 0x811c9dc5;
+
+    for(size_t i = 0; i < _frameLength; i++){
+        for(int shift = 0; shift < 32; shift += 8){
+            hash ^= (_frame[i] >> shift) & 0xff;
+            hash *= 0x01000193;
+        }
+    }
+
+    if(_recording){
+        _writeWord(_recording, (uint32_t) _frameLength);
+
+        for(size_t i = 0; i < _frameLength; i++){
+            _writeWord(_recording, _frame[i]);
+        }
+    }
+
+    _lastFrame.index++;
+    _lastFrame.words = (uint32_t) _frameLength;
+    _lastFrame.hash  = hash;
+    _frameLength     = 0;
+}
+
+bool hostOpenRecording(const char *path){
+    hostCloseRecording();
+
+    _recording = fopen(path, "wb");
+    return _recording ? true : false;
+}
+
+void hostCloseRecording(void){
+    if(_recording){
+        fclose(_recording);
+        _recording = 0;
+    }
+}
+
+const HostFrameInfo *hostGetLastFrame(void){
+    return &_lastFrame;
+}
+
+/* GPU and DMA */
+
+void hal_writeGP0(uint32_t value){
+    _recordWord(value);
+}
+
+void hal_writeGP1(uint32_t value){
+    // Display settings don't affect what gets drawn, so they aren't recorded.
+    (void) value;
+}
+
+uint32_t hal_readGPUStat(void){
+    // Commands are "executed" as soon as they are written, so the GPU is
+    // always ready for more.
+    return GP1_STAT_CMD_READY | GP1_STAT_DREQ | GP1_STAT_WRITE_READY;
+}
+
+static void _runListDMA(uint32_t address){
+    for(int packets = 0; packets < MAX_LIST_PACKETS; packets++){
+        const uint32_t *packet = _resolveAddress(address);
+        uint32_t header = packet[0];
+
+        for(uint32_t i = 1; i <= (header >> 24); i++){
+            _recordWord(packet[i]);
+        }
+
+        // Like the real DMA unit, stop at the first address with bit 23 set
+        // rather than only at 0xffffff.
+        address = header & 0xffffff;
+        if(address & 0x800000){
+            return;
+        }
+    }
+
+    fprintf(stderr, "DMA linked list does not terminate\n");
+    abort();
+}
+
+void hal_startDMA(DMAChannel channel, const void *address, uint32_t bcr, uint32_t chcr){
+    assert(_isInRAM(address));
+    assert(chcr & DMA_CHCR_ENABLE);
+
+    uint32_t *ptr = (uint32_t *) address;
+
+    switch(channel){
+        case DMA_GPU:
+            switch(chcr & DMA_CHCR_MODE_BITMASK){
+                case DMA_CHCR_MODE_LIST:
+                    _runListDMA((uint32_t) ((uintptr_t) address & 0xffffff));
+                    break;
+
+                case DMA_CHCR_MODE_SLICE:
+                    for(uint32_t i = (bcr & 0xffff) * (bcr >> 16); i; i--){
+                        _recordWord(*(ptr++));
+                    }
+                    break;
+
+                default:
+                    for(uint32_t i = (bcr & 0xffff) ? (bcr & 0xffff) : 0x10000; i; i--){
+                        _recordWord(*(ptr++));
+                    }
+                    break;
+            }
+            break;
+
+        case DMA_OTC:
+            // Each entry is linked to the one before it, and the first one
+            // terminates the list.
+            for(uint32_t i = (bcr & 0xffff) ? (bcr & 0xffff) : 0x10000; i > 1; i--, ptr--){
+                *ptr = (uint32_t) ((uintptr_t) (ptr - 1) & 0xffffff);
+            }
+            *ptr = 0xffffff;
+            break;
+
+        default:
+            fprintf(stderr, "DMA channel %d is not emulated\n", channel);
+            abort();
+    }
+}
+
+bool hal_isDMABusy(DMAChannel channel){
+    // Transfers are performed in full by hal_startDMA().
+    (void) channel;
+    return false;
+}
+
+/* Interrupts */
+
+bool hal_isIRQPending(IRQChannel channel){
+    // There's no display to wait for, so a VBlank is always due.
+    return (channel == IRQ_VSYNC);
+}
+
+void hal_acknowledgeIRQ(IRQChannel channel){
+    if(channel == IRQ_VSYNC){
+        _endFrame();
+    }
+}
+
+/* COP0 */
+
+uint32_t hal_cop0Get(int reg){
+    return _cop0[reg & 31];
+}
+
+void hal_cop0Set(int reg, uint32_t value){
+    _cop0[reg & 31] = value;
+}
+
+/* Timer */
+
+void initTimer(void){}
+
+uint32_t getTicks(void){
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t) (
+        (uint64_t) now.tv_sec * TIMER_TICKS_PER_SECOND
+        + ((uint64_t) now.tv_nsec * TIMER_TICKS_PER_SECOND) / 1000000000
+    );
+}
@@ -0,0 +1,57 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// DMA only sees the bottom 24 bits of each address, just like on the PS1, so
+// anything the renderer hands to DMA (ordering tables and packet buffers) has
+// to come from this region rather than from malloc(). It is aligned to 16 MB,
+// which lets a 24-bit address be turned back into a pointer.
+#define HOST_RAM_SIZE 0x200000
+
+// Statistics for the last frame recorded, i.e. everything written to GP0 (by
+// either the CPU or DMA) between two acknowledged VBlank interrupts.
+typedef struct{
+    uint32_t index;
+    uint32_t words;
+    uint32_t hash; // 32-bit FNV-1a of the words, in little endian byte order
+}HostFrameInfo;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Allocates memory DMA can access. There is no way to free it.
+void *hostAllocRAM(size_t size);
+
+// Starts saving every recorded frame to a file as a 32-bit word count followed
+// by the GP0 words themselves, both little endian.
+bool hostOpenRecording(const char *path);
+void hostCloseRecording(void);
+
+const HostFrameInfo *hostGetLastFrame(void);
+
+// Resets the software GTE to its power-on state.
+void hostResetGTE(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,260 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Host build of the renderer. Flies a camera through the room along a fixed
+ * path, building each frame with the same code the PS1 build uses, and prints
+ * a hash of the GP0 command stream for every frame. Two builds producing the
+ * same hashes draw exactly the same thing, so this can be used to check that
+ * an optimization hasn't changed the output without having to run it on a
+ * console.
+ *
+ * Usage: host [-n frames] [-t | -m mode] [-b bands] [-q] [-o recording.bin]
+ *
+ * -b draws the room in clusters and streams the chain in the given number of
+ * depth bands, as FirstPersonCamera does when built with PSX_STREAMING_CHAIN.
+ * DMA finishes instantly here, so every band is sent as soon as it's complete
+ * and the hashes are those of the whole chain drawn in cluster order.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "include/arena.h"
+#include "include/camera.h"
+#include "include/controller.h"
+#include "include/font.h"
+#include "include/gpu.h"
+#include "include/gte.h"
+#include "include/render.h"
+#include "ps1/gpucmd.h"
+
+#include "FirstPersonCamera/RoomModel.h"
+#include "host.h"
+
+#define SCREEN_WIDTH  320
+#define SCREEN_HEIGHT 256
+#define FONT_WIDTH    96
+#define FONT_HEIGHT   56
+#define HUD_TEXT_SIZE 256
+#define CLUSTER_GRID  6
+
+// Fills in the controller state for a given frame. The path turns on the
+// spot, walks forward, strafes while looking up and down and finally rises
+// above the room, so most of the clipping paths get exercised.
+static void getScriptedInput(ControllerInfo *input, int frame){
+   input->type    = 0x07;
+   input->buttons = 0;
+   input->lx = input->ly = input->rx = input->ry = 127;
+
+   switch((frame / 60) % 4){
+      case 0:
+         input->rx = 255;
+         break;
+
+      case 1:
+         input->ly = 0;
+         input->rx = 160 + (frame % 60);
+         break;
+
+      case 2:
+         input->lx = 255;
+         input->ry = (frame % 60) < 30 ? 0 : 255;
+         break;
+
+      default:
+         input->buttons = BUTTON_MASK_R2;
+         input->ly = 255;
+         break;
+   }
+}
+
+int main(int argc, char **argv){
+   int frames = 240;
+   RenderMode mode = RENDER_FLAT;
+   bool quiet = false;
+   int bandCount = 0;
+   const char *outputPath = 0;
+   int option;
+
+   while((option = getopt(argc, argv, "n:tm:b:qo:")) != -1){
+      switch(option){
+         case 'n':
+            frames = atoi(optarg);
+            break;
+         case 't':
+            mode = RENDER_TEXTURED;
+            break;
+         case 'm':
+            mode = atoi(optarg);
+            if((mode < 0) || (mode >= RENDER_MODE_COUNT)){
+               fprintf(stderr, "Mode must be between 0 and %d\n", RENDER_MODE_COUNT - 1);
+               return 1;
+            }
+            break;
+         case 'b':
+            bandCount = atoi(optarg);
+            if((bandCount < 1) || (bandCount > CHAIN_MAX_BANDS)){
+               fprintf(stderr, "Bands must be between 1 and %d\n", CHAIN_MAX_BANDS);
+               return 1;
+            }
+            break;
+         case 'q':
+            quiet = true;
+            break;
+         case 'o':
+            outputPath = optarg;
+            break;
+         default:
+            fprintf(stderr, "Usage: %s [-n frames] [-t | -m mode] [-b bands] [-q] [-o recording.bin]\n", argv[0]);
+            return 1;
+      }
+   }
+
+   if(outputPath && !hostOpenRecording(outputPath)){
+      perror(outputPath);
+      return 1;
+   }
+
+   setupGPU(GP1_MODE_PAL, SCREEN_WIDTH, SCREEN_HEIGHT);
+   setupGTE(SCREEN_WIDTH, SCREEN_HEIGHT);
+   setupRenderLighting();
+
+   ChainConfig chainConfig = {
+      .packetWords    = CHAIN_BUFFER_SIZE,
+      .arenaSize      = FRAME_ARENA_SIZE,
+      .reserveWords   = CHAIN_BUFFER_SIZE / 8,
+      .overflowPolicy = CHAIN_OVERFLOW_DROP_FAR,
+      .bandCount      = bandCount
+   };
+   DMAChain dmaChains[2];
+   bool usingSecondFrame = false;
+
+   for(int i = 0; i < 2; i++){
+      void *chainMemory = hostAllocRAM(getChainMemorySize(&chainConfig));
+      assert(chainMemory);
+
+      initChain(&dmaChains[i], &chainConfig, chainMemory);
+   }
+
+   // The texture contents don't matter here (nothing is rasterized), only
+   // where they end up in VRAM. Memory from hostAllocRAM() starts out zeroed.
+   TextureInfo font, reference_64;
+   uploadIndexedTexture(&font, hostAllocRAM(FONT_WIDTH * FONT_HEIGHT / 2), SCREEN_WIDTH+16, 0, FONT_WIDTH, FONT_HEIGHT,
+      hostAllocRAM(32), SCREEN_WIDTH+16, FONT_HEIGHT, GP0_COLOR_4BPP
+   );
+   uploadIndexedTexture(&reference_64, hostAllocRAM(64 * 64 / 2), SCREEN_WIDTH, 0, 64, 64,
+      hostAllocRAM(32), SCREEN_WIDTH, 64, GP0_COLOR_4BPP
+   );
+
+   // Frame 0 only contains the texture uploads.
+   waitForVSync();
+   if(!quiet){
+      printf("frame,polys,words,hash\n");
+      printf("0,0,%u,%08x\n", hostGetLastFrame()->words, hostGetLastFrame()->hash);
+   }
+
+   Camera camera = {0};
+   camera.y = -1000;
+
+   GTEVector16 *roomNormals = malloc(roomModel.faceCount * sizeof(GTEVector16));
+   assert(roomNormals);
+
+   const Model room = {
+      .faceCount = roomModel.faceCount,
+      .verts     = roomModel.verts,
+      .faces     = roomModel.faces,
+      .normals   = roomNormals
+   };
+   computeFaceNormals(&room, roomNormals);
+   RenderKernel renderKernel = getRenderKernel(mode);
+
+   ModelCluster roomClusters[RENDER_MAX_CLUSTERS];
+   int roomClusterCount = 0;
+
+   if(bandCount){
+      Tri_Textured *clusterFaces   = malloc(room.faceCount * sizeof(Tri_Textured));
+      GTEVector16  *clusterNormals = malloc(room.faceCount * sizeof(GTEVector16));
+      assert(clusterFaces && clusterNormals);
+
+      roomClusterCount = buildModelClusters(&room, CLUSTER_GRID, roomClusters, clusterFaces, clusterNormals);
+   }
+
+   int bufferX = 0;
+   int bufferY = 0;
+   uint32_t combinedHash = 0;
+
+   for(int frame = 0; frame < frames; frame++){
+      DMAChain *chain = &dmaChains[usingSecondFrame];
+      usingSecondFrame = !usingSecondFrame;
+
+      resetChain(chain);
+
+      queueFrameSetup(chain, bufferX, bufferY, SCREEN_WIDTH, SCREEN_HEIGHT, gp0_rgb(64, 64, 64));
+
+      // The camera is stepped once per frame, as if the game was running at
+      // exactly SIM_RATE frames per second.
+      ControllerInfo input;
+      getScriptedInput(&input, frame);
+      updateCamera(&camera, &input);
+
+      gte_setRotationMatrix(
+         ONE,   0,   0,
+         0, ONE,   0,
+         0,   0, ONE
+      );
+      rotateCurrentMatrix(-camera.roll, camera.yaw, camera.pitch);
+      updateTranslationMatrix(-camera.x, -camera.y, -camera.z);
+
+      int polyCount;
+
+      if(bandCount){
+         polyCount = renderClusters(chain, renderKernel, roomClusters, roomClusterCount, &reference_64);
+      }else{
+         polyCount = renderKernel(chain, &room, &reference_64);
+      }
+
+      char *textBuffer = arenaAlloc(&chain->arena, HUD_TEXT_SIZE);
+      assert(textBuffer);
+      snprintf(textBuffer, HUD_TEXT_SIZE, "X:%i\nY:%i\nZ:%i\n\np: %d", (int)camera.x, (int)camera.y, (int)camera.z, polyCount);
+      printString(chain, &font, 0, 0, textBuffer);
+
+      bufferY = usingSecondFrame ? SCREEN_HEIGHT : 0;
+
+      // On the PS1 the list is sent after VSync and drawn during the next
+      // frame. Here, sending it first means each recorded frame holds exactly
+      // one chain.
+      finishChain(chain);
+      waitForVSync();
+
+      const HostFrameInfo *info = hostGetLastFrame();
+      combinedHash = (combinedHash ^ info->hash) * 0x01000193;
+
+      if(!quiet){
+         printf("%u,%d,%u,%08x\n", info->index - 1, polyCount, info->words, info->hash);
+      }
+   }
+
+   printf("%d frames, combined hash %08x\n", frames, combinedHash);
+
+   hostCloseRecording();
+   return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Tests for the fixed-size object pools (include/pool.h): the order slots are
+ * handed out and reused in, running out of slots, and the used, peak and
+ * overflow counters.
+ */
+
+#include <stdint.h>
+
+#include "check.h"
+#include "include/pool.h"
+
+#define OBJECT_COUNT 8
+
+typedef struct{
+   int32_t x, y, z;
+   uint16_t flags;
+}Particle;
+
+DEFINE_POOL(particles, Particle, OBJECT_COUNT)
+
+static void testAllocFree(void){
+   particlesInit();
+
+   Particle *first  = particlesAlloc();
+   Particle *second = particlesAlloc();
+
+   // Slots are handed out in order at first, so they're next to each other.
+   CHECK(first  == &particlesStorage[0]);
+   CHECK(second == &particlesStorage[1]);
+   CHECK(particles.used == 2);
+
+   // A freed slot is the next one to be reused.
+   particlesFree(first);
+   CHECK(particles.used == 1);
+   CHECK(particlesAlloc() == first);
+
+   // Freeing a null pointer does nothing.
+   particlesFree(0);
+   CHECK(particles.used == 2);
+}
+
+static void testExhaustion(void){
+   Particle *objects[OBJECT_COUNT];
+
+   particlesInit();
+
+   for(int i = 0; i < OBJECT_COUNT; i++){
+      objects[i] = particlesAlloc();
+      CHECK(objects[i]);
+
+      for(int j = 0; j < i; j++){
+         CHECK(objects[i] != objects[j]);
+      }
+   }
+
+   CHECK(!particlesAlloc());
+   CHECK(!particlesAlloc());
+   CHECK(particles.overflows == 2);
+   CHECK(particles.used == OBJECT_COUNT);
+
+   // Once something is freed, allocating works again.
+   particlesFree(objects[3]);
+   CHECK(particlesAlloc() == objects[3]);
+   CHECK(particles.overflows == 2);
+}
+
+static void testPeak(void){
+   particlesInit();
+
+   Particle *a = particlesAlloc();
+   Particle *b = particlesAlloc();
+   Particle *c = particlesAlloc();
+
+   particlesFree(b);
+   particlesFree(a);
+   CHECK(particles.used == 1);
+   CHECK(particles.peak == 3);
+
+   // The peak only moves once more objects are in use than ever before.
+   a = particlesAlloc();
+   b = particlesAlloc();
+   CHECK(particles.peak == 3);
+
+   particlesAlloc();
+   CHECK(particles.peak == 4);
+
+   particlesFree(a);
+   particlesFree(b);
+   particlesFree(c);
+   CHECK(particles.used == 1);
+   CHECK(particles.peak == 4);
+
+   // Starting over resets the stats.
+   particlesInit();
+   CHECK((particles.used == 0) && (particles.peak == 0) && (particles.overflows == 0));
+}
+
+int main(void){
+   testAllocFree();
+   testExhaustion();
+   testPeak();
+
+   return finishChecks();
+}
@@ -0,0 +1,502 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Batched RTPS for offline tools. The SIMD paths carry out the GTE's integer
+ * arithmetic in double precision: every intermediate value RTPS produces fits
+ * comfortably within a double's 53-bit mantissa, and arithmetic shifts become
+ * exact multiplications by powers of two followed by floor(), so the results
+ * are identical to the scalar path's. The only case this doesn't hold for is
+ * a 44-bit MAC overflow, which can only happen with very large translation
+ * vectors; those batches are handed to the scalar path instead.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ps1/cop0gte.h"
+#include "gte.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+#endif
+
+namespace softgte {
+
+// The division's reciprocal table with 0x101 already added to each entry,
+// converted to doubles so the AVX2 path can gather from it directly.
+struct UNRTableDouble {
+	double values[0x101];
+
+	UNRTableDouble(void) {
+		const uint8_t *table = getUNRTable();
+
+		for (int i = 0; i < 0x101; i++)
+			values[i] = double(0x101 + table[i]);
+	}
+};
+
+// Returns whether any of the sums RTPS computes could exceed the 44-bit
+// range of MAC1-3 for any possible vertex.
+static bool canOverflow(const ProjectionParams &params) {
+	for (int i = 0; i < 3; i++) {
+		int64_t bound = (params.tr[i] < 0) ? -int64_t(params.tr[i]) : params.tr[i];
+
+		bound <<= 12;
+
+		for (int j = 0; j < 3; j++) {
+			int64_t value = params.rt[i][j];
+
+			bound += ((value < 0) ? -value : value) * 0x8000;
+		}
+
+		if (bound > 0x7ffffffffffLL)
+			return true;
+	}
+
+	return false;
+}
+
+static void projectScalar(
+	const ProjectionParams &params, const GTEVector16 *input,
+	ProjectedVertex *output, size_t count, bool lm
+) {
+	for (; count; count--)
+		*(output++) = projectVertex(params, *(input++), lm);
+}
+
+#ifdef HAVE_X86_SIMD
+
+// The division's divisor is normalized by shifting it left until bit 15 is
+// set. For a double this is the same as replacing its exponent with 15, and
+// the dividend can then be scaled by the same amount by building a power of
+// two out of the difference between the exponents.
+#define MANTISSA_MASK    0x000fffffffffffffLL
+#define EXPONENT_MASK    0x7ff0000000000000LL
+#define DIVISOR_EXPONENT (int64_t(1023 + 15) << 52)
+#define SCALE_EXPONENT   (int64_t(1023 + 1023 + 15) << 52)
+
+/* SSE2 path (2 vertices at a time) */
+
+// Arithmetic right shift of an integer stored in a double. SSE2 has no floor
+// instruction, so the value is biased so that rounding to nearest gives the
+// same result as rounding down, and then rounded by pushing the fractional
+// part out of the mantissa. Only valid for integers below 2^51.
+__attribute__((target("sse2"))) static inline __m128d shiftRightSSE2(__m128d value, int shift) {
+	const __m128d magic = _mm_set1_pd(6755399441055744.0);
+
+	double scale = 1.0 / double(1 << shift);
+	double bias  = (0.5 - double(1 << (shift - 1))) * scale;
+
+	value = _mm_add_pd(_mm_mul_pd(value, _mm_set1_pd(scale)), _mm_set1_pd(bias));
+	return _mm_sub_pd(_mm_add_pd(value, magic), magic);
+}
+
+__attribute__((target("sse2"))) static inline __m128i saturateSSE2(
+	__m128d &value, double min, double max, uint32_t bit
+) {
+	__m128d minValue = _mm_set1_pd(min), maxValue = _mm_set1_pd(max);
+	__m128d mask     = _mm_or_pd(_mm_cmplt_pd(value, minValue), _mm_cmpgt_pd(value, maxValue));
+
+	value = _mm_min_pd(_mm_max_pd(value, minValue), maxValue);
+	return _mm_and_si128(_mm_castpd_si128(mask), _mm_set1_epi64x(bit));
+}
+
+__attribute__((target("sse2"))) static inline __m128i checkMAC0SSE2(__m128d value) {
+	__m128i overflow = _mm_and_si128(
+		_mm_castpd_si128(_mm_cmpgt_pd(value, _mm_set1_pd(2147483647.0))),
+		_mm_set1_epi64x(GTE_FLAG_MAC0_OVERFLOW)
+	);
+	__m128i underflow = _mm_and_si128(
+		_mm_castpd_si128(_mm_cmplt_pd(value, _mm_set1_pd(-2147483648.0))),
+		_mm_set1_epi64x(GTE_FLAG_MAC0_UNDERFLOW)
+	);
+
+	return _mm_or_si128(overflow, underflow);
+}
+
+__attribute__((target("sse2"))) static void projectSSE2(
+	const ProjectionParams &params, const GTEVector16 *input,
+	ProjectedVertex *output, size_t count, bool lm
+) {
+	static const UNRTableDouble unrTable;
+
+	const double irMin = lm ? 0.0 : -32768.0;
+
+	__m128d matrix[3][3], translation[3];
+
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++)
+			matrix[i][j] = _mm_set1_pd(params.rt[i][j]);
+
+		translation[i] = _mm_set1_pd(double(params.tr[i]) * 4096.0);
+	}
+
+	for (; count >= 2; count -= 2, input += 2, output += 2) {
+		// Sign extend two vertices to 32 bits and split them into one register
+		// per component.
+		__m128i packed = _mm_loadu_si128((const __m128i *) input);
+		__m128i first  = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+		__m128i second = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+		__m128i xy     = _mm_unpacklo_epi32(first, second);
+		__m128i zw     = _mm_unpackhi_epi32(first, second);
+
+		__m128d vector[3] = {
+			_mm_cvtepi32_pd(xy),
+			_mm_cvtepi32_pd(_mm_srli_si128(xy, 8)),
+			_mm_cvtepi32_pd(zw)
+		};
+
+		// MAC1-3 = (TR * 1000h + RT * V) SAR 12
+		__m128d mac[3];
+
+		for (int i = 0; i < 3; i++) {
+			__m128d value = translation[i];
+
+			for (int j = 0; j < 3; j++)
+				value = _mm_add_pd(value, _mm_mul_pd(matrix[i][j], vector[j]));
+
+			mac[i] = shiftRightSSE2(value, 12);
+		}
+
+		__m128d ir1 = mac[0], ir2 = mac[1], ir3 = mac[2], sz = mac[2];
+		__m128i flag;
+
+		flag = saturateSSE2(ir1, irMin, 32767.0, GTE_FLAG_IR1_SATURATED);
+		flag = _mm_or_si128(flag, saturateSSE2(ir2, irMin, 32767.0, GTE_FLAG_IR2_SATURATED));
+		flag = _mm_or_si128(flag, saturateSSE2(ir3, -32768.0, 32767.0, GTE_FLAG_IR3_SATURATED));
+		flag = _mm_or_si128(flag, saturateSSE2(sz, 0.0, 65535.0, GTE_FLAG_Z_SATURATED));
+
+		// Division. Lanes that overflow get a divisor of 1, so the rest of
+		// the calculation doesn't have to deal with zeroes.
+		__m128d h        = _mm_set1_pd(params.h);
+		__m128d overflow = _mm_cmple_pd(_mm_add_pd(sz, sz), h);
+		__m128d one      = _mm_set1_pd(1.0);
+		__m128d rhs      = _mm_or_pd(_mm_and_pd(overflow, one), _mm_andnot_pd(overflow, sz));
+
+		flag = _mm_or_si128(flag, _mm_and_si128(
+			_mm_castpd_si128(overflow), _mm_set1_epi64x(GTE_FLAG_DIVIDE_OVERFLOW)
+		));
+
+		__m128d divisor = _mm_castsi128_pd(_mm_or_si128(
+			_mm_and_si128(_mm_castpd_si128(rhs), _mm_set1_epi64x(MANTISSA_MASK)),
+			_mm_set1_epi64x(DIVISOR_EXPONENT)
+		));
+		__m128d lhs = _mm_mul_pd(h, _mm_castsi128_pd(_mm_sub_epi64(
+			_mm_set1_epi64x(SCALE_EXPONENT),
+			_mm_and_si128(_mm_castpd_si128(rhs), _mm_set1_epi64x(EXPONENT_MASK))
+		)));
+
+		__m128i index = _mm_cvttpd_epi32(_mm_mul_pd(
+			_mm_add_pd(divisor, _mm_set1_pd(0x40 - 0x8000)), _mm_set1_pd(1.0 / 128.0)
+		));
+		__m128d x = _mm_set_pd(
+			unrTable.values[_mm_cvtsi128_si32(_mm_srli_si128(index, 4))],
+			unrTable.values[_mm_cvtsi128_si32(index)]
+		);
+		__m128d d = shiftRightSSE2(
+			_mm_sub_pd(_mm_set1_pd(0x80), _mm_mul_pd(divisor, x)), 8
+		);
+		__m128d reciprocal = shiftRightSSE2(
+			_mm_add_pd(_mm_mul_pd(x, _mm_add_pd(d, _mm_set1_pd(0x20000))), _mm_set1_pd(0x80)), 8
+		);
+		__m128d quotient = shiftRightSSE2(
+			_mm_add_pd(_mm_mul_pd(lhs, reciprocal), _mm_set1_pd(0x8000)), 16
+		);
+
+		quotient = _mm_min_pd(quotient, _mm_set1_pd(0x1ffff));
+		quotient = _mm_or_pd(
+			_mm_and_pd(overflow, _mm_set1_pd(0x1ffff)), _mm_andnot_pd(overflow, quotient)
+		);
+
+		// Screen coordinates
+		__m128d sx = _mm_add_pd(_mm_mul_pd(quotient, ir1), _mm_set1_pd(params.ofx));
+		__m128d sy = _mm_add_pd(_mm_mul_pd(quotient, ir2), _mm_set1_pd(params.ofy));
+
+		flag = _mm_or_si128(flag, checkMAC0SSE2(sx));
+		flag = _mm_or_si128(flag, checkMAC0SSE2(sy));
+
+		sx   = shiftRightSSE2(sx, 16);
+		sy   = shiftRightSSE2(sy, 16);
+		flag = _mm_or_si128(flag, saturateSSE2(sx, -1024.0, 1023.0, GTE_FLAG_SX2_SATURATED));
+		flag = _mm_or_si128(flag, saturateSSE2(sy, -1024.0, 1023.0, GTE_FLAG_SY2_SATURATED));
+
+		// Depth cueing
+		__m128d depth = _mm_add_pd(_mm_mul_pd(quotient, _mm_set1_pd(params.dqa)), _mm_set1_pd(params.dqb));
+		__m128i depthFlag = checkMAC0SSE2(depth);
+		__m128d ir0 = shiftRightSSE2(depth, 12);
+
+		depthFlag = _mm_or_si128(depthFlag, saturateSSE2(ir0, 0.0, 4096.0, GTE_FLAG_IR0_SATURATED));
+
+		int32_t sxValues[4], syValues[4], szValues[4], ir0Values[4];
+		uint32_t flagValues[4], depthFlagValues[4];
+
+		_mm_storeu_si128((__m128i *) sxValues,  _mm_cvttpd_epi32(sx));
+		_mm_storeu_si128((__m128i *) syValues,  _mm_cvttpd_epi32(sy));
+		_mm_storeu_si128((__m128i *) szValues,  _mm_cvttpd_epi32(sz));
+		_mm_storeu_si128((__m128i *) ir0Values, _mm_cvttpd_epi32(ir0));
+		_mm_storeu_si128((__m128i *) flagValues,      flag);
+		_mm_storeu_si128((__m128i *) depthFlagValues, depthFlag);
+
+		for (int i = 0; i < 2; i++) {
+			output[i].sx        = int16_t(sxValues[i]);
+			output[i].sy        = int16_t(syValues[i]);
+			output[i].sz        = uint16_t(szValues[i]);
+			output[i].ir0       = int16_t(ir0Values[i]);
+			output[i].flag      = flagValues[i * 2];
+			output[i].depthFlag = depthFlagValues[i * 2];
+		}
+	}
+
+	projectScalar(params, input, output, count, lm);
+}
+
+/* AVX2 path (4 vertices at a time) */
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i saturateAVX2(
+	__m256d &value, double min, double max, uint32_t bit
+) {
+	__m256d minValue = _mm256_set1_pd(min), maxValue = _mm256_set1_pd(max);
+	__m256d mask     = _mm256_or_pd(
+		_mm256_cmp_pd(value, minValue, _CMP_LT_OQ),
+		_mm256_cmp_pd(value, maxValue, _CMP_GT_OQ)
+	);
+
+	value = _mm256_min_pd(_mm256_max_pd(value, minValue), maxValue);
+	return _mm256_and_si256(_mm256_castpd_si256(mask), _mm256_set1_epi64x(bit));
+}
+
+AVX2 static inline __m256i checkMAC0AVX2(__m256d value) {
+	__m256i overflow = _mm256_and_si256(
+		_mm256_castpd_si256(_mm256_cmp_pd(value, _mm256_set1_pd(2147483647.0), _CMP_GT_OQ)),
+		_mm256_set1_epi64x(GTE_FLAG_MAC0_OVERFLOW)
+	);
+	__m256i underflow = _mm256_and_si256(
+		_mm256_castpd_si256(_mm256_cmp_pd(value, _mm256_set1_pd(-2147483648.0), _CMP_LT_OQ)),
+		_mm256_set1_epi64x(GTE_FLAG_MAC0_UNDERFLOW)
+	);
+
+	return _mm256_or_si256(overflow, underflow);
+}
+
+AVX2 static inline __m256d shiftRightAVX2(__m256d value, double scale) {
+	return _mm256_floor_pd(_mm256_mul_pd(value, _mm256_set1_pd(scale)));
+}
+
+AVX2 static void projectAVX2(
+	const ProjectionParams &params, const GTEVector16 *input,
+	ProjectedVertex *output, size_t count, bool lm
+) {
+	static const UNRTableDouble unrTable;
+
+	const double irMin = lm ? 0.0 : -32768.0;
+
+	__m256d matrix[3][3], translation[3];
+
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++)
+			matrix[i][j] = _mm256_set1_pd(params.rt[i][j]);
+
+		translation[i] = _mm256_set1_pd(double(params.tr[i]) * 4096.0);
+	}
+
+	for (; count >= 4; count -= 4, input += 4, output += 4) {
+		__m128i packed0 = _mm_loadu_si128((const __m128i *) &input[0]);
+		__m128i packed1 = _mm_loadu_si128((const __m128i *) &input[2]);
+		__m256i wide0   = _mm256_cvtepi16_epi32(packed0); // x0 y0 z0 p0 x1 y1 z1 p1
+		__m256i wide1   = _mm256_cvtepi16_epi32(packed1); // x2 y2 z2 p2 x3 y3 z3 p3
+
+		// Transpose into x0-x3, y0-y3 and z0-z3.
+		const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+		__m256i xyz0 = _mm256_permutevar8x32_epi32(wide0, order); // x0 x1 y0 y1 z0 z1 p0 p1
+		__m256i xyz1 = _mm256_permutevar8x32_epi32(wide1, order); // x2 x3 y2 y3 z2 z3 p2 p3
+		__m256i lo   = _mm256_unpacklo_epi64(xyz0, xyz1);         // x0 x1 x2 x3 z0 z1 z2 z3
+		__m256i hi   = _mm256_unpackhi_epi64(xyz0, xyz1);         // y0 y1 y2 y3 p0 p1 p2 p3
+
+		__m256d vector[3] = {
+			_mm256_cvtepi32_pd(_mm256_castsi256_si128(lo)),
+			_mm256_cvtepi32_pd(_mm256_castsi256_si128(hi)),
+			_mm256_cvtepi32_pd(_mm256_extracti128_si256(lo, 1))
+		};
+
+		__m256d mac[3];
+
+		for (int i = 0; i < 3; i++) {
+			__m256d value = translation[i];
+
+			for (int j = 0; j < 3; j++)
+				value = _mm256_add_pd(value, _mm256_mul_pd(matrix[i][j], vector[j]));
+
+			mac[i] = shiftRightAVX2(value, 1.0 / 4096.0);
+		}
+
+		__m256d ir1 = mac[0], ir2 = mac[1], ir3 = mac[2], sz = mac[2];
+		__m256i flag;
+
+		flag = saturateAVX2(ir1, irMin, 32767.0, GTE_FLAG_IR1_SATURATED);
+		flag = _mm256_or_si256(flag, saturateAVX2(ir2, irMin, 32767.0, GTE_FLAG_IR2_SATURATED));
+		flag = _mm256_or_si256(flag, saturateAVX2(ir3, -32768.0, 32767.0, GTE_FLAG_IR3_SATURATED));
+		flag = _mm256_or_si256(flag, saturateAVX2(sz, 0.0, 65535.0, GTE_FLAG_Z_SATURATED));
+
+		__m256d h        = _mm256_set1_pd(params.h);
+		__m256d overflow = _mm256_cmp_pd(_mm256_add_pd(sz, sz), h, _CMP_LE_OQ);
+		__m256d rhs      = _mm256_blendv_pd(sz, _mm256_set1_pd(1.0), overflow);
+
+		flag = _mm256_or_si256(flag, _mm256_and_si256(
+			_mm256_castpd_si256(overflow), _mm256_set1_epi64x(GTE_FLAG_DIVIDE_OVERFLOW)
+		));
+
+		__m256d divisor = _mm256_castsi256_pd(_mm256_or_si256(
+			_mm256_and_si256(_mm256_castpd_si256(rhs), _mm256_set1_epi64x(MANTISSA_MASK)),
+			_mm256_set1_epi64x(DIVISOR_EXPONENT)
+		));
+		__m256d lhs = _mm256_mul_pd(h, _mm256_castsi256_pd(_mm256_sub_epi64(
+			_mm256_set1_epi64x(SCALE_EXPONENT),
+			_mm256_and_si256(_mm256_castpd_si256(rhs), _mm256_set1_epi64x(EXPONENT_MASK))
+		)));
+
+		__m128i index = _mm256_cvttpd_epi32(_mm256_mul_pd(
+			_mm256_add_pd(divisor, _mm256_set1_pd(0x40 - 0x8000)), _mm256_set1_pd(1.0 / 128.0)
+		));
+		// The masked form is used as the plain one starts from an undefined
+		// register, which GCC reports as uninitialized.
+		__m256d x = _mm256_mask_i32gather_pd(
+			_mm256_setzero_pd(), unrTable.values, index,
+			_mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8
+		);
+		__m256d d = shiftRightAVX2(
+			_mm256_sub_pd(_mm256_set1_pd(0x80), _mm256_mul_pd(divisor, x)), 1.0 / 256.0
+		);
+		__m256d reciprocal = shiftRightAVX2(
+			_mm256_add_pd(_mm256_mul_pd(x, _mm256_add_pd(d, _mm256_set1_pd(0x20000))), _mm256_set1_pd(0x80)),
+			1.0 / 256.0
+		);
+		__m256d quotient = shiftRightAVX2(
+			_mm256_add_pd(_mm256_mul_pd(lhs, reciprocal), _mm256_set1_pd(0x8000)), 1.0 / 65536.0
+		);
+
+		quotient = _mm256_min_pd(quotient, _mm256_set1_pd(0x1ffff));
+		quotient = _mm256_blendv_pd(quotient, _mm256_set1_pd(0x1ffff), overflow);
+
+		__m256d sx = _mm256_add_pd(_mm256_mul_pd(quotient, ir1), _mm256_set1_pd(params.ofx));
+		__m256d sy = _mm256_add_pd(_mm256_mul_pd(quotient, ir2), _mm256_set1_pd(params.ofy));
+
+		flag = _mm256_or_si256(flag, checkMAC0AVX2(sx));
+		flag = _mm256_or_si256(flag, checkMAC0AVX2(sy));
+
+		sx   = shiftRightAVX2(sx, 1.0 / 65536.0);
+		sy   = shiftRightAVX2(sy, 1.0 / 65536.0);
+		flag = _mm256_or_si256(flag, saturateAVX2(sx, -1024.0, 1023.0, GTE_FLAG_SX2_SATURATED));
+		flag = _mm256_or_si256(flag, saturateAVX2(sy, -1024.0, 1023.0, GTE_FLAG_SY2_SATURATED));
+
+		__m256d depth = _mm256_add_pd(
+			_mm256_mul_pd(quotient, _mm256_set1_pd(params.dqa)), _mm256_set1_pd(params.dqb)
+		);
+		__m256i depthFlag = checkMAC0AVX2(depth);
+		__m256d ir0 = shiftRightAVX2(depth, 1.0 / 4096.0);
+
+		depthFlag = _mm256_or_si256(depthFlag, saturateAVX2(ir0, 0.0, 4096.0, GTE_FLAG_IR0_SATURATED));
+
+		int32_t sxValues[4], syValues[4], szValues[4], ir0Values[4];
+		uint64_t flagValues[4], depthFlagValues[4];
+
+		_mm_storeu_si128((__m128i *) sxValues,  _mm256_cvttpd_epi32(sx));
+		_mm_storeu_si128((__m128i *) syValues,  _mm256_cvttpd_epi32(sy));
+		_mm_storeu_si128((__m128i *) szValues,  _mm256_cvttpd_epi32(sz));
+		_mm_storeu_si128((__m128i *) ir0Values, _mm256_cvttpd_epi32(ir0));
+		_mm256_storeu_si256((__m256i *) flagValues,      flag);
+		_mm256_storeu_si256((__m256i *) depthFlagValues, depthFlag);
+
+		for (int i = 0; i < 4; i++) {
+			output[i].sx        = int16_t(sxValues[i]);
+			output[i].sy        = int16_t(syValues[i]);
+			output[i].sz        = uint16_t(szValues[i]);
+			output[i].ir0       = int16_t(ir0Values[i]);
+			output[i].flag      = uint32_t(flagValues[i]);
+			output[i].depthFlag = uint32_t(depthFlagValues[i]);
+		}
+	}
+
+	projectScalar(params, input, output, count, lm);
+}
+
+#undef AVX2
+
+#endif
+
+/* Dispatch */
+
+ProjectionPath getBestProjectionPath(void) {
+#ifdef HAVE_X86_SIMD
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return PROJECT_AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return PROJECT_SSE2;
+#endif
+
+	return PROJECT_SCALAR;
+}
+
+const char *getProjectionPathName(ProjectionPath path) {
+	switch (path) {
+		case PROJECT_AUTO:
+			return getProjectionPathName(getBestProjectionPath());
+
+		case PROJECT_SSE2:
+			return "SSE2";
+
+		case PROJECT_AVX2:
+			return "AVX2";
+
+		default:
+			return "scalar";
+	}
+}
+
+void project(
+	const ProjectionParams &params, const GTEVector16 *input,
+	ProjectedVertex *output, size_t count, bool lm, ProjectionPath path
+) {
+	static ProjectionPath bestPath = getBestProjectionPath();
+
+	if (path == PROJECT_AUTO)
+		path = bestPath;
+	if (canOverflow(params))
+		path = PROJECT_SCALAR;
+
+	switch (path) {
+#ifdef HAVE_X86_SIMD
+		case PROJECT_SSE2:
+			projectSSE2(params, input, output, count, lm);
+			break;
+
+		case PROJECT_AVX2:
+			projectAVX2(params, input, output, count, lm);
+			break;
+#endif
+
+		default:
+			projectScalar(params, input, output, count, lm);
+			break;
+	}
+}
+
+}
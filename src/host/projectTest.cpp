@@ -0,0 +1,140 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Tests for the software GTE's batched projection (project.cpp). Random
+ * vertices are projected with every SIMD path this CPU supports and compared
+ * against the scalar path, which is itself checked against projectVertex().
+ * Half the batches use scene-like values and half use the full range of every
+ * register, so saturation, division overflow and the lm bit are all covered.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "check.h"
+#include "gte.hpp"
+
+using namespace softgte;
+
+#define BATCH_COUNT 256
+#define BATCH_SIZE  1027 // Not a multiple of any SIMD width, to cover the tail
+
+// Fixed seed, so a failure can be reproduced.
+static uint32_t randomState = 0x12345678;
+
+static uint32_t randomWord(void){
+   // xorshift32
+   randomState ^= randomState << 13;
+   randomState ^= randomState >> 17;
+   randomState ^= randomState << 5;
+   return randomState;
+}
+static int32_t randomRange(int32_t min, int32_t max){
+   return min + int32_t(randomWord() % uint32_t(max - min + 1));
+}
+
+static void randomParams(ProjectionParams &params, bool fullRange){
+   for(int i = 0; i < 3; i++){
+      for(int j = 0; j < 3; j++){
+         params.rt[i][j] = fullRange ? int16_t(randomWord()) : int16_t(randomRange(-4096, 4096));
+      }
+
+      params.tr[i] = fullRange ? int32_t(randomWord()) : randomRange(-0x8000, 0x8000);
+   }
+
+   params.ofx = fullRange ? int32_t(randomWord()) : (randomRange(0, 640) << 16);
+   params.ofy = fullRange ? int32_t(randomWord()) : (randomRange(0, 512) << 16);
+   params.h   = fullRange ? uint16_t(randomWord()) : uint16_t(randomRange(100, 400));
+   params.dqa = int16_t(randomWord());
+   params.dqb = int32_t(randomWord());
+}
+
+static void randomVertices(GTEVector16 *vertices, size_t count, bool fullRange){
+   int32_t min = fullRange ? -0x8000 : -0x1000;
+   int32_t max = fullRange ?  0x7fff :  0x1000;
+
+   for(size_t i = 0; i < count; i++){
+      vertices[i].x = int16_t(randomRange(min, max));
+      vertices[i].y = int16_t(randomRange(min, max));
+      vertices[i].z = int16_t(randomRange(min, max));
+   }
+}
+
+// Compares two results field by field, only printing the first few vertices
+// that differ so a broken path doesn't flood the output.
+static int compareVertices(
+   const ProjectedVertex *actual, const ProjectedVertex *expected, size_t count,
+   const char *pathName, int batch
+){
+   int mismatches = 0;
+
+   for(size_t i = 0; i < count; i++){
+      const ProjectedVertex &a = actual[i], &e = expected[i];
+
+      bool same =
+         (a.sx == e.sx) && (a.sy == e.sy) && (a.sz == e.sz) && (a.ir0 == e.ir0) &&
+         (a.flag == e.flag) && (a.depthFlag == e.depthFlag);
+
+      if(!same && (mismatches++ < 4)){
+         printf(
+            "batch %d vertex %d (%s): sxy %d,%d sz %d ir0 %d flag %08x/%08x, "
+            "expected sxy %d,%d sz %d ir0 %d flag %08x/%08x\n",
+            batch, int(i), pathName, a.sx, a.sy, a.sz, a.ir0, a.flag, a.depthFlag,
+            e.sx, e.sy, e.sz, e.ir0, e.flag, e.depthFlag
+         );
+      }
+   }
+
+   return mismatches;
+}
+
+int main(void){
+   static GTEVector16     vertices[BATCH_SIZE];
+   static ProjectedVertex expected[BATCH_SIZE], actual[BATCH_SIZE];
+
+   ProjectionPath bestPath = getBestProjectionPath();
+
+   printf("testing up to the %s path\n", getProjectionPathName(bestPath));
+
+   for(int batch = 0; batch < BATCH_COUNT; batch++){
+      bool fullRange = batch & 1;
+      bool lm        = batch & 2;
+
+      ProjectionParams params;
+
+      randomParams(params, fullRange);
+      randomVertices(vertices, BATCH_SIZE, fullRange);
+
+      project(params, vertices, expected, BATCH_SIZE, lm, PROJECT_SCALAR);
+
+      // The scalar batch path and the single-vertex one must agree as well.
+      for(int i = 0; i < BATCH_SIZE; i += 97){
+         actual[i] = projectVertex(params, vertices[i], lm);
+         CHECK(compareVertices(&actual[i], &expected[i], 1, "single", batch) == 0);
+      }
+
+      for(int path = PROJECT_SSE2; path <= bestPath; path++){
+         const char *name = getProjectionPathName(ProjectionPath(path));
+
+         project(params, vertices, actual, BATCH_SIZE, lm, ProjectionPath(path));
+         CHECK(compareVertices(actual, expected, BATCH_SIZE, name, batch) == 0);
+      }
+   }
+
+   return finishChecks();
+}
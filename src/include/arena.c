@@ -0,0 +1,59 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+#include "log.h"
+
+#define ARENA_ALIGNMENT 8
+
+void initArena(Arena *arena, void *buffer, size_t capacity){
+    assert(!((uintptr_t) buffer % ARENA_ALIGNMENT));
+
+    arena->base      = (uint8_t *) buffer;
+    arena->capacity  = buffer ? capacity : 0;
+    arena->used      = 0;
+    arena->peak      = 0;
+    arena->overflows = 0;
+}
+
+void resetArena(Arena *arena){
+    arena->used = 0;
+}
+
+void *arenaAlloc(Arena *arena, size_t size){
+    size_t offset = arena->used;
+    size_t end    = offset + ((size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1));
+
+    // Don't take down the whole program, just let the caller skip whatever it
+    // wanted the memory for. Only the first overflow is logged, as there's
+    // usually a whole frame's worth of them.
+    if(end > arena->capacity){
+        if(!(arena->overflows++)){
+            LOG_WARN("frame arena overflow (%d/%d bytes)\n", (int) end, (int) arena->capacity);
+        }
+        return 0;
+    }
+
+    arena->used = end;
+    if(end > arena->peak){
+        arena->peak = end;
+    }
+
+    return &arena->base[offset];
+}
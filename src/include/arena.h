@@ -0,0 +1,45 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Linear "bump" allocator for data that only needs to live for a single frame.
+// Allocating is just a pointer increment and everything is freed at once by
+// resetArena(), so it's safe to use in the middle of the render loop.
+typedef struct{
+    uint8_t *base;
+    size_t capacity;
+    size_t used;
+    size_t peak;        // Highest value used has reached since initArena()
+    uint32_t overflows; // Number of allocations that didn't fit
+}Arena;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void initArena(Arena *arena, void *buffer, size_t capacity);
+void resetArena(Arena *arena);
+
+// Returns an 8-byte aligned block, or a null pointer if the arena is full.
+void *arenaAlloc(Arena *arena, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
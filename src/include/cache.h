@@ -0,0 +1,37 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+// The R3000 has a 4 KB direct-mapped instruction cache with 16-byte lines, so
+// two pieces of code 4 KB apart always evict each other. Functions marked HOT
+// are placed next to each other (starting on a cache line) by the linker
+// script, which finds them as GCC puts them in .text.hot.* sections (this
+// needs -freorder-functions, which cmake/setup.cmake enables for all builds),
+// so as long as they add up to less than the cache they can all stay cached at
+// once. tools/codeLayout.py reports how much of the budget they use after each
+// build.
+//
+// COLD functions (and anything GCC decides is unlikely to run, such as code
+// that always ends in a call to a cold function) go to a separate region,
+// away from the rest of the code. Marking a function cold also makes GCC treat
+// branches leading to it as unlikely.
+#define ICACHE_SIZE      4096
+#define ICACHE_LINE_SIZE 16
+
+#define HOT  __attribute__((hot))
+#define COLD __attribute__((cold))
@@ -1 +0,0 @@
-// camera.c is empty for now...
\ No newline at end of file
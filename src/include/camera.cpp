@@ -0,0 +1,115 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "camera.h"
+#include "controller.h"
+#include "fixed.hpp"
+#include "timer.h"
+#include "trig.h"
+
+using namespace fixed;
+
+// Stick deflection is kept with 6 fractional bits, and MOVEMENT_SPEED is in
+// the same format (i.e. in 64ths of a unit per step, per unit of deflection).
+using Deflection = Fixed<6, int32_t>;
+
+static const Deflection _movementSpeed = Deflection::fromRaw(MOVEMENT_SPEED);
+
+// How far a step moves the camera along a direction, for a stick axis.
+static Vec3i _stickStep(int axis, const Vec3q &direction){
+    Deflection deflection = Deflection::fromInt(axis - 127);
+
+    return {
+        Q0((deflection * direction.x) * _movementSpeed),
+        Q0((deflection * direction.y) * _movementSpeed),
+        Q0((deflection * direction.z) * _movementSpeed)
+    };
+}
+
+static inline bool _outsideDeadzone(int axis){
+    return (axis > 156) || (axis < 100);
+}
+
+void updateCamera(Camera *camera, const ControllerInfo *input){
+    // Store the Sine and Cosine values for the camera's yaw as we use it multiple times
+    Q12 yawSin = fixed::sin(camera->yaw);
+    Q12 yawCos = fixed::cos(camera->yaw);
+
+    // Up/Down
+    if(input->buttons & BUTTON_MASK_L2) camera->y += VERTICAL_SPEED;
+    if(input->buttons & BUTTON_MASK_R2) camera->y -= VERTICAL_SPEED;
+
+    // If the controller type is Dualshock, read the analogue stick values to move and look around
+    if(input->type != 0x07){
+        return;
+    }
+
+    // The left stick strafes along the camera's right vector and moves along its
+    // forward one. Z points the opposite way to the stick's Y axis.
+    Vec3q right   = { yawCos, Q12(), -yawSin };
+    Vec3q forward = { yawSin, Q12(), yawCos };
+
+    if(_outsideDeadzone(input->lx)){
+        Vec3i step = _stickStep(input->lx, right);
+
+        camera->x += step.x.raw;
+        camera->z -= step.z.raw;
+    }
+    if(_outsideDeadzone(input->ly)){
+        Vec3i step = _stickStep(input->ly, forward);
+
+        camera->x += step.x.raw;
+        camera->z -= step.z.raw;
+    }
+    if(_outsideDeadzone(input->rx)){
+        camera->yaw -= (((input->rx-127)>>6) * CAMERA_SENSITIVITY);
+    }
+    // Update camera pitch
+    if(_outsideDeadzone(input->ry)){
+        camera->pitch += (((input->ry-127)>>6) * CAMERA_SENSITIVITY);
+
+        // Lock camera pitch to 90 degrees up or down
+        if(camera->pitch > 1024){
+            camera->pitch = 1024;
+        }
+        if(camera->pitch < -1024){
+            camera->pitch = -1024;
+        }
+    }
+}
+
+static int32_t _lerp(int32_t from, int32_t to, int alpha){
+    return from + (((to - from) * alpha) >> FIXED_TIMESTEP_ALPHA_SHIFT);
+}
+
+static int16_t _lerpAngle(int16_t from, int16_t to, int alpha){
+    // Angles wrap around, so take the shortest way from one to the other.
+    int16_t delta = (int16_t) (to - from);
+
+    return (int16_t) (from + ((delta * alpha) >> FIXED_TIMESTEP_ALPHA_SHIFT));
+}
+
+void interpolateCamera(Camera *output, const Camera *previous, const Camera *current, int alpha){
+    *output = *current;
+
+    output->x     = _lerp(previous->x, current->x, alpha);
+    output->y     = _lerp(previous->y, current->y, alpha);
+    output->z     = _lerp(previous->z, current->z, alpha);
+    output->pitch = _lerpAngle(previous->pitch, current->pitch, alpha);
+    output->roll  = _lerpAngle(previous->roll,  current->roll,  alpha);
+    output->yaw   = _lerpAngle(previous->yaw,   current->yaw,   alpha);
+}
@@ -16,18 +16,36 @@
 
 #pragma once
 #include <stdint.h>
+#include "controller.h"
 
-// Constants for the speed and sensitivity of our camera
-#define CAMERA_SENSITIVITY 10
-#define MOVEMENT_SPEED 30
+// Constants for the speed and sensitivity of our camera.
+// These are applied once per simulation step, not once per frame.
+#define CAMERA_SENSITIVITY    10
+#define MOVEMENT_SPEED        30
+#define VERTICAL_SPEED        16
 
-// Somewhere to store the Sine and Cosine of the camera's yaw value.
-// This saves us from recalculating it multiple times per frame.
-int16_t yawSin;
-int16_t yawCos;
+// How many times per second the camera is updated.
+// This is independent of the frame rate, so the camera moves at the
+// same speed on PAL and NTSC, and even when the renderer drops frames.
+#define SIM_RATE 60
 
 typedef struct {
    int32_t x, y, z;
    int16_t pitch, roll, yaw;
    uint32_t forward[3], up[3], right[3];
 } Camera;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Moves the camera by one simulation step according to the controller's state.
+void updateCamera(Camera *camera, const ControllerInfo *input);
+
+// Blends between two simulation steps. alpha goes from 0 (previous) to
+// (1 << FIXED_TIMESTEP_ALPHA_SHIFT) (current).
+void interpolateCamera(Camera *output, const Camera *previous, const Camera *current, int alpha);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,188 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "cache.h"
+#include "camera.h"
+#include "capture.h"
+#include "gpu.h"
+#include "ps1/registers.h"
+
+static uint32_t _crcTable[256];
+static bool     _crcTableReady = false;
+static uint8_t  _sequence      = 0;
+static bool     _buttonsHeld   = false;
+
+// Standard (zlib) CRC-32, so the host side can use zlib.crc32(). The table is
+// only built the first time a capture is taken.
+static COLD void _initCRCTable(void){
+    for(int i = 0; i < 256; i++){
+        uint32_t value = i;
+
+        for(int bit = 0; bit < 8; bit++){
+            value = (value >> 1) ^ ((value & 1) ? 0xedb88320 : 0);
+        }
+        _crcTable[i] = value;
+    }
+
+    _crcTableReady = true;
+}
+
+static uint32_t _updateCRC(uint32_t crc, const void *data, size_t length){
+    const uint8_t *ptr = (const uint8_t *) data;
+
+    crc = ~crc;
+    for(; length; length--){
+        crc = (crc >> 8) ^ _crcTable[(crc ^ *(ptr++)) & 0xff];
+    }
+
+    return ~crc;
+}
+
+// Captures are far bigger than the log buffer (see log.h), so they bypass it
+// and wait for the serial port. Whatever was queued before goes out first so
+// the two don't get interleaved.
+static void _sendBytes(const void *data, size_t length){
+    const uint8_t *ptr = (const uint8_t *) data;
+
+    flushSerialOutput();
+    for(; length; length--){
+        _putcharBlocking(*(ptr++));
+    }
+}
+
+// Sends a block made up of an optional 32-bit prefix (the offset for table
+// and data blocks) followed by the payload.
+static void _sendBlock(
+    CaptureBlockType type, const uint32_t *prefix, const void *data, size_t length
+){
+    if(!_crcTableReady){
+        _initCRCTable();
+    }
+
+    CaptureBlockHeader header = {
+        .sync     = { CAPTURE_SYNC0, CAPTURE_SYNC1 },
+        .type     = type,
+        .sequence = _sequence++,
+        .length   = length + (prefix ? 4 : 0)
+    };
+
+    uint32_t crc = _updateCRC(0, &header, sizeof(header));
+    if(prefix){
+        crc = _updateCRC(crc, prefix, 4);
+    }
+    crc = _updateCRC(crc, data, length);
+
+    _sendBytes(&header, sizeof(header));
+    if(prefix){
+        _sendBytes(prefix, 4);
+    }
+    _sendBytes(data, length);
+    _sendBytes(&crc, 4);
+}
+
+uint32_t updateCaptureCRC(uint32_t crc, const void *data, size_t length){
+    if(!_crcTableReady){
+        _initCRCTable();
+    }
+
+    return _updateCRC(crc, data, length);
+}
+
+COLD void sendCaptureBlock(CaptureBlockType type, const void *data, size_t length){
+    _sendBlock(type, 0, data, length);
+}
+
+COLD uint32_t sendCaptureBuffer(
+    CaptureBlockType type, const void *data, size_t length, uint32_t crc
+){
+    const uint8_t *ptr = (const uint8_t *) data;
+
+    for(uint32_t offset = 0; offset < length; offset += CAPTURE_BLOCK_SIZE - 4){
+        size_t chunk = length - offset;
+
+        if(chunk > (CAPTURE_BLOCK_SIZE - 4)){
+            chunk = CAPTURE_BLOCK_SIZE - 4;
+        }
+
+        _sendBlock(type, &offset, &ptr[offset], chunk);
+    }
+
+    return _updateCRC(crc, data, length);
+}
+
+int pollSerialCommand(void){
+    int command = -1;
+
+    // Drain the receive FIFO without blocking.
+    while(SIO_STAT(1) & SIO_STAT_RX_NOT_EMPTY){
+        command = SIO_DATA(1);
+    }
+
+    return command;
+}
+
+bool pollCaptureTrigger(uint16_t buttons, int command){
+    bool triggered = (command == CAPTURE_SERIAL_COMMAND);
+
+    // Only trigger on the frame the combination is completed, so holding the
+    // buttons down doesn't capture every frame.
+    if((buttons & CAPTURE_BUTTONS) == CAPTURE_BUTTONS){
+        triggered   |= !_buttonsHeld;
+        _buttonsHeld = true;
+    } else {
+        _buttonsHeld = false;
+    }
+
+    return triggered;
+}
+
+COLD void captureChain(const DMAChain *chain, const Camera *camera, uint32_t frame){
+    size_t dataWords = chain->nextPacket - chain->data;
+
+    CaptureHeader header = {
+        .version        = CAPTURE_VERSION,
+        .headerSize     = sizeof(CaptureHeader),
+        .frame          = frame,
+        .tableAddress   = (uintptr_t) chain->orderingTable & 0xffffff,
+        .tableEntries   = ORDERING_TABLE_SIZE,
+        .dataAddress    = (uintptr_t) chain->data & 0xffffff,
+        .dataWords      = dataWords,
+        .flushedWords   = chain->flushedWords,
+        .droppedPackets = chain->droppedPackets,
+        .cameraX        = camera->x,
+        .cameraY        = camera->y,
+        .cameraZ        = camera->z,
+        .cameraPitch    = camera->pitch,
+        .cameraRoll     = camera->roll,
+        .cameraYaw      = camera->yaw
+    };
+
+    // If the chain has been flushed, only the packets queued since the last
+    // flush are still around. flushedWords lets the host tell this apart from
+    // a complete frame.
+    _sendBlock(CAPTURE_BLOCK_BEGIN, 0, &header, sizeof(header));
+
+    uint32_t crc = 0;
+    crc = sendCaptureBuffer(CAPTURE_BLOCK_TABLE, chain->orderingTable, ORDERING_TABLE_SIZE * 4, crc);
+    crc = sendCaptureBuffer(CAPTURE_BLOCK_DATA, chain->data, dataWords * 4, crc);
+
+    _sendBlock(CAPTURE_BLOCK_END, 0, &crc, 4);
+}
@@ -0,0 +1,103 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "camera.h"
+#include "gpu.h"
+
+// Holding all of these buttons (or sending CAPTURE_SERIAL_COMMAND over the
+// serial port) dumps the next frame's chain.
+#define CAPTURE_BUTTONS        (BUTTON_MASK_SELECT | BUTTON_MASK_START)
+#define CAPTURE_SERIAL_COMMAND 'C'
+
+// A capture is sent as a series of blocks, each made up of this header, up to
+// CAPTURE_BLOCK_SIZE bytes of payload and the CRC-32 of the header and payload.
+// The blocks can be picked out from any other output on the serial port by
+// their sync bytes, and the sequence number reveals any that went missing.
+#define CAPTURE_SYNC0      0xa5
+#define CAPTURE_SYNC1      0x5a
+#define CAPTURE_VERSION    1
+#define CAPTURE_BLOCK_SIZE 1024
+
+typedef enum {
+    CAPTURE_BLOCK_BEGIN         = 1, // CaptureHeader
+    CAPTURE_BLOCK_TABLE         = 2, // Byte offset into the ordering table, then words
+    CAPTURE_BLOCK_DATA          = 3, // Byte offset into data[], then words
+    CAPTURE_BLOCK_END           = 4, // CRC-32 of everything sent since the last BEGIN
+    CAPTURE_BLOCK_INPUT_BEGIN   = 5, // InputRecordingHeader (see replay.h)
+    CAPTURE_BLOCK_INPUT         = 6, // Byte offset into the recorded ticks, then ticks
+    CAPTURE_BLOCK_SAMPLES_BEGIN = 7, // SamplerHeader (see sampler.h)
+    CAPTURE_BLOCK_SAMPLES       = 8  // Address and sample count pairs
+} CaptureBlockType;
+
+typedef struct{
+    uint8_t  sync[2];
+    uint8_t  type;
+    uint8_t  sequence;
+    uint16_t length;
+}CaptureBlockHeader;
+
+// Everything needed to walk the chain offline. The addresses are the 24-bit
+// ones the packets' tags point to, so the table and data[] can be placed back
+// where they were.
+typedef struct{
+    uint16_t version, headerSize;
+    uint32_t frame;
+    uint32_t tableAddress, tableEntries;
+    uint32_t dataAddress, dataWords;
+    uint32_t flushedWords, droppedPackets;
+    int32_t  cameraX, cameraY, cameraZ;
+    int16_t  cameraPitch, cameraRoll, cameraYaw, _padding;
+}CaptureHeader;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns the last byte received over SIO1 since the previous call, or -1 if
+// nothing arrived. Debug commands are single characters, so only the latest
+// one is kept.
+int pollSerialCommand(void);
+
+// Returns true once when the button combination is pressed or the serial
+// command arrives. Must be called once per frame.
+bool pollCaptureTrigger(uint16_t buttons, int command);
+
+// Low-level helpers for sending other kinds of data in the same format.
+// updateCaptureCRC() computes the same CRC-32 as zlib, continued from the one
+// passed in (0 to start a new one). sendCaptureBuffer() splits the buffer into as many blocks as needed, each
+// prefixed with its offset, and returns the CRC-32 of the buffer continued
+// from the one passed in.
+void sendCaptureBlock(CaptureBlockType type, const void *data, size_t length);
+uint32_t updateCaptureCRC(uint32_t crc, const void *data, size_t length);
+uint32_t sendCaptureBuffer(
+    CaptureBlockType type, const void *data, size_t length, uint32_t crc
+);
+
+// Sends the ordering table, the used part of the chain's packet buffer and the
+// camera over SIO1. This busy-waits on the serial port, so the frame it is
+// called in will take several seconds at 115200 baud; call it once all packets
+// have been queued but before the chain is handed to sendLinkedList().
+void captureChain(const DMAChain *chain, const Camera *camera, uint32_t frame);
+
+#ifdef __cplusplus
+}
+#endif
@@ -14,7 +14,10 @@
  * PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include "cache.h"
 #include "controller.h"
+#include "irq.h"
+#include "timer.h"
 #include "ps1/registers.h"
 
 // All packets sent by controllers in response to a poll command include a 4-bit
@@ -72,7 +75,7 @@ void delayMicroseconds(int time){
     );
 }
 
-void initControllerBus(void){
+COLD void initControllerBus(void){
     // Set up the serial interface with the settings used by
     // controllers and memory cards
 
@@ -177,28 +180,54 @@ int exchangePacket(
     return respLength;
 }
 
-bool getControllerInfo(int port, ControllerInfo *output) {
-    // Build the request packet.
-    uint8_t request[4], response[8];
-    //char *ptr = output;
+/* Interrupt-driven polling */
 
-    request[0] = CMD_POLL;  // Command
-    request[1] = 0x00;      // Multitap address
-    request[2] = 0x00;      // Rumble motor control 1
-    request[3] = 0x00;      // Rumble motor control 2
+// Instead of spinning on every byte, the poll packet is sent one byte per
+// interrupt. The controller's acknowledge pulse raises IRQ_SIO0 once it is
+// ready for the next byte, and root counter 0 is used as a one-shot timer for
+// the DTR delay and the acknowledge timeout. No ack before the timer fires
+// means the device has nothing more to send.
 
-    // Send the request to the specified controller port and grab the response.
-    // This is a very slow process so only run it once per frame unless absolutely necessary
-    selectPort(port);
-    int respLength = exchangePacket(
-        ADDR_CONTROLLER, request, response, sizeof(request), sizeof(response)
-    );
+#define POLL_REQUEST_LENGTH  4
+#define POLL_RESPONSE_LENGTH (2 + (8 * MULTITAP_SLOTS))
 
-    //ptr += sprintf(ptr, "Port %d:\n", port + 1);
+typedef enum {
+    POLL_IDLE,
+    POLL_SELECT,   // Waiting for DTR to settle before sending the address
+    POLL_TRANSFER, // Exchanging bytes, waiting for an ack or timeout
+    POLL_RELEASE,  // Waiting before releasing DTR
+    POLL_NEXT_PORT // Waiting between ports
+} PollState;
+
+static volatile PollState _pollState = POLL_IDLE;
+static int _pollPort;
+static int _txIndex, _respLength;
+
+static const uint8_t _pollRequest[POLL_REQUEST_LENGTH] = {
+    CMD_POLL, // Command
+    0x01,     // Ask a multitap (if any) to return all four slots at once
+    0x00,     // Rumble motor control 1
+    0x00      // Rumble motor control 2
+};
+static uint8_t _pollResponse[POLL_RESPONSE_LENGTH];
 
-    if(respLength < 4){
-        // All controllers reply with at least 4 bytes of data.
-        //ptr += sprintf(ptr, " No controller connected!");
+// Double-buffered results. The handler only ever writes to the back buffer,
+// then publishes it by flipping _frontSnapshot.
+static ControllerSnapshot _snapshots[2];
+static volatile int _frontSnapshot = 0;
+
+static void _armPollTimer(int microseconds){
+    // Writing the control register resets the counter and re-arms the
+    // one-shot IRQ.
+    TIMER_RELOAD(0) = (F_CPU / 1000000) * microseconds;
+    TIMER_CTRL(0)   = TIMER_CTRL_RELOAD | TIMER_CTRL_IRQ_ON_RELOAD;
+    IRQ_STAT        = ~(1 << IRQ_TIMER0);
+}
+
+static bool _parsePad(const uint8_t *response, int length, ControllerInfo *output){
+    // All controllers reply with at least 4 bytes of data. A multitap
+    // reports 0xff as the type of empty slots.
+    if((length < 4) || (response[0] == 0xff)){
         return false;
     }
 
@@ -209,9 +238,208 @@ bool getControllerInfo(int port, ControllerInfo *output) {
     // Bytes 2 and 3 hold a bitfield representing the state of all buttons.
     // The buttons are active-low, so invert the values.
     output->buttons = (response[2] | (response[3] << 8)) ^ 0xffff;
-    output->rx = (response[4]);
-    output->ry = (response[5]);
-    output->lx = (response[6]);
-    output->ly = (response[7]);
+
+    // Digital controllers don't send any analog data; report centered sticks.
+    if(length < 8){
+        output->rx = 0x80;
+        output->ry = 0x80;
+        output->lx = 0x80;
+        output->ly = 0x80;
+    } else {
+        output->rx = (response[4]);
+        output->ry = (response[5]);
+        output->lx = (response[6]);
+        output->ly = (response[7]);
+    }
     return true;
 }
+
+static void _storePollResult(void){
+    ControllerSnapshot *snapshot = &_snapshots[_frontSnapshot ^ 1];
+    int port = _pollPort;
+
+    snapshot->connected[port] = 0;
+    snapshot->multitap[port]  = false;
+
+    if((_respLength >= 2) && ((_pollResponse[0] >> 4) == 0x8)){
+        // Multitap: the header is followed by one 8-byte block per slot.
+        snapshot->multitap[port] = true;
+
+        for(int slot = 0; slot < MULTITAP_SLOTS; slot++){
+            int offset = 2 + (8 * slot);
+            int length = _respLength - offset;
+
+            if(length > 8){
+                length = 8;
+            }
+            if(_parsePad(&_pollResponse[offset], length, &(snapshot->pads[port][slot]))){
+                snapshot->connected[port] |= 1 << slot;
+            }
+        }
+    } else if(_parsePad(_pollResponse, _respLength, &(snapshot->pads[port][0]))){
+        snapshot->connected[port] = 1;
+    }
+}
+
+static void _startTransfer(int port){
+    // Assert DTR and give the device some time to get ready. The rest of the
+    // transfer continues from the timer interrupt.
+    _pollPort = port;
+    selectPort(port);
+
+    SIO_CTRL(0) |= SIO_CTRL_DTR | SIO_CTRL_ACKNOWLEDGE;
+    _pollState   = POLL_SELECT;
+    _armPollTimer(DTR_DELAY);
+}
+
+static void _endTransfer(void){
+    // Collect the last byte, which the device doesn't acknowledge.
+    if((SIO_STAT(0) & SIO_STAT_RX_NOT_EMPTY) && (_respLength < POLL_RESPONSE_LENGTH)){
+        uint8_t value = SIO_DATA(0);
+
+        if(_txIndex > 0){
+            _pollResponse[_respLength++] = value;
+        }
+    }
+
+    _pollState = POLL_RELEASE;
+    _armPollTimer(DTR_DELAY);
+}
+
+static HOT void _sendNextByte(void){
+    SIO_DATA(0) = (_txIndex < POLL_REQUEST_LENGTH) ? _pollRequest[_txIndex] : 0;
+    _txIndex++;
+    _armPollTimer(DSR_TIMEOUT);
+}
+
+static HOT void _pollAckHandler(void){
+    SIO_CTRL(0) |= SIO_CTRL_ACKNOWLEDGE;
+
+    if(_pollState != POLL_TRANSFER){
+        return;
+    }
+
+    // The byte the device sent back while receiving ours is already in the
+    // FIFO. The reply to the address byte (sent before any request byte, so
+    // _txIndex == 0) carries no data.
+    if(SIO_STAT(0) & SIO_STAT_RX_NOT_EMPTY){
+        uint8_t value = SIO_DATA(0);
+
+        if(_txIndex > 0){
+            _pollResponse[_respLength++] = value;
+        }
+    }
+
+    if(_respLength >= POLL_RESPONSE_LENGTH){
+        _endTransfer();
+    } else {
+        _sendNextByte();
+    }
+}
+
+static HOT void _pollTimerHandler(void){
+    switch(_pollState){
+        case POLL_SELECT:
+            // Empty the RX FIFO and send the address byte.
+            while(SIO_STAT(0) & SIO_STAT_RX_NOT_EMPTY){
+                SIO_DATA(0);
+            }
+
+            _txIndex    = 0;
+            _respLength = 0;
+            _pollState  = POLL_TRANSFER;
+
+            SIO_DATA(0) = ADDR_CONTROLLER;
+            _armPollTimer(DSR_TIMEOUT);
+            break;
+
+        case POLL_TRANSFER:
+            // An ack may have arrived right as the timer expired. In that case
+            // let the SIO0 handler deal with it.
+            if(SIO_STAT(0) & SIO_STAT_IRQ){
+                break;
+            }
+
+            _endTransfer();
+            break;
+
+        case POLL_RELEASE:
+            // Release DTR, allowing the device to go idle.
+            SIO_CTRL(0) &= ~SIO_CTRL_DTR;
+            _storePollResult();
+
+            if(_pollPort + 1 < CONTROLLER_PORTS){
+                _pollState = POLL_NEXT_PORT;
+                _armPollTimer(DTR_DELAY);
+            } else {
+                // Both ports done, publish the new snapshot.
+                _snapshots[_frontSnapshot ^ 1].sequence =
+                    _snapshots[_frontSnapshot].sequence + 1;
+                _snapshots[_frontSnapshot ^ 1].timestamp = getTicks();
+                _frontSnapshot ^= 1;
+                _pollState      = POLL_IDLE;
+            }
+            break;
+
+        case POLL_NEXT_PORT:
+            _startTransfer(_pollPort + 1);
+            break;
+
+        default:
+            break;
+    }
+}
+
+COLD void initControllerPolling(void){
+    _pollState     = POLL_IDLE;
+    _frontSnapshot = 0;
+
+    setInterruptHandler(IRQ_SIO0,   &_pollAckHandler);
+    setInterruptHandler(IRQ_TIMER0, &_pollTimerHandler);
+}
+
+void startControllerPoll(void){
+    // Kick off a new poll of both ports if the previous one has finished.
+    // This never waits; a poll takes well under a frame.
+    bool enabled = disableInterrupts();
+
+    if(_pollState == POLL_IDLE){
+        _startTransfer(0);
+    }
+
+    restoreInterrupts(enabled);
+}
+
+bool isControllerPollBusy(void){
+    return _pollState != POLL_IDLE;
+}
+
+void getControllerSnapshot(ControllerSnapshot *output){
+    // Copy with interrupts off, so the buffer can't be flipped and reused
+    // halfway through.
+    bool enabled = disableInterrupts();
+
+    *output = _snapshots[_frontSnapshot];
+
+    restoreInterrupts(enabled);
+}
+
+bool getMultitapControllerInfo(int port, int slot, ControllerInfo *output){
+    bool enabled = disableInterrupts();
+
+    const ControllerSnapshot *snapshot = &_snapshots[_frontSnapshot];
+    bool connected = (snapshot->connected[port] >> slot) & 1;
+
+    if(connected){
+        *output = snapshot->pads[port][slot];
+    }
+
+    restoreInterrupts(enabled);
+    return connected;
+}
+
+bool getControllerInfo(int port, ControllerInfo *output) {
+    // Returns the latest results of the background poll for the first
+    // controller on the given port (or slot A of a multitap).
+    return getMultitapControllerInfo(port, 0, output);
+}
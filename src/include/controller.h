@@ -22,6 +22,10 @@
 #define DTR_DELAY   60
 #define DSR_TIMEOUT 120
 
+// Number of controller ports, and of slots behind a multitap plugged into one.
+#define CONTROLLER_PORTS 2
+#define MULTITAP_SLOTS   4
+
 // The controller bus is shared with memory cards.
 // An addressing mechanism is used to ensure packets are processed
 // by only one device at a time.
@@ -80,6 +84,16 @@ typedef struct{
     uint16_t ly;
 }ControllerInfo;
 
+// A complete set of poll results for both ports. The interrupt handler fills
+// one of these in the background while the other is being read.
+typedef struct{
+    ControllerInfo pads[CONTROLLER_PORTS][MULTITAP_SLOTS];
+    uint8_t connected[CONTROLLER_PORTS]; // Bitmask of slots with a controller
+    bool multitap[CONTROLLER_PORTS];
+    uint32_t sequence;  // Incremented every time a new snapshot is published
+    uint32_t timestamp; // getTicks() value when the poll finished
+}ControllerSnapshot;
+
 void delayMicroseconds(int time);
 void initControllerBus(void);
 bool waitForAcknowledge(int timeout);
@@ -91,4 +105,12 @@ int exchangePacket(
     int reqLength, int maxRespLength
 );
 
-bool getControllerInfo(int port, ControllerInfo *output);
\ No newline at end of file
+// Interrupt-driven polling. The blocking functions above must not be used
+// while a background poll is in progress.
+void initControllerPolling(void);
+void startControllerPoll(void);
+bool isControllerPollBusy(void);
+void getControllerSnapshot(ControllerSnapshot *output);
+
+bool getControllerInfo(int port, ControllerInfo *output);
+bool getMultitapControllerInfo(int port, int slot, ControllerInfo *output);
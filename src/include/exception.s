@@ -0,0 +1,130 @@
+# (C) 2024 Rhys Baker
+#
+# Permission to use, copy, modify, and/or distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+# REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+# AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+# INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+# OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+# PERFORMANCE OF THIS SOFTWARE.
+
+.set noreorder
+.set noat
+
+.set COP0_CAUSE, $13
+.set COP0_EPC,   $14
+
+## Exception vector stub
+
+# installExceptionHandler() copies these four instructions to 0x80000080. They
+# can only use $k0 and $k1, as every other register belongs to the code that
+# was interrupted.
+
+.section .text.unlikely._exceptionVector, "ax", @progbits
+.global _exceptionVector
+.global _exceptionVectorEnd
+.type _exceptionVector, @function
+
+_exceptionVector:
+	lui   $k0, %hi(_exceptionHandler)
+	addiu $k0, %lo(_exceptionHandler)
+	jr    $k0
+	nop
+_exceptionVectorEnd:
+
+## Exception handler
+
+# Saves every register C code is allowed to clobber into a static frame, calls
+# _handleException(epc, cause) and resumes from the address it returns.
+# Interrupts are disabled by the CPU on entry, so the frame can't be reused
+# before we are done with it. Callee-saved registers, $gp and $sp are left
+# alone; the handler borrows the interrupted code's stack. It runs on every
+# interrupt, so it's placed with the rest of the hot code (see cache.h).
+
+.section .text.hot._exceptionHandler, "ax", @progbits
+.global _exceptionHandler
+.type _exceptionHandler, @function
+
+_exceptionHandler:
+	la    $k0, _exceptionFrame
+	sw    $at, 0x00($k0)
+	sw    $v0, 0x04($k0)
+	sw    $v1, 0x08($k0)
+	sw    $a0, 0x0c($k0)
+	sw    $a1, 0x10($k0)
+	sw    $a2, 0x14($k0)
+	sw    $a3, 0x18($k0)
+	sw    $t0, 0x1c($k0)
+	sw    $t1, 0x20($k0)
+	sw    $t2, 0x24($k0)
+	sw    $t3, 0x28($k0)
+	sw    $t4, 0x2c($k0)
+	sw    $t5, 0x30($k0)
+	sw    $t6, 0x34($k0)
+	sw    $t7, 0x38($k0)
+	sw    $t8, 0x3c($k0)
+	sw    $t9, 0x40($k0)
+	sw    $ra, 0x44($k0)
+	mfhi  $t0
+	mflo  $t1
+	sw    $t0, 0x48($k0)
+	sw    $t1, 0x4c($k0)
+
+	mfc0  $a0, COP0_EPC
+	mfc0  $a1, COP0_CAUSE
+	jal   _handleException
+	addiu $sp, -16 # Reserve space for the argument registers
+
+	addiu $sp, 16
+	move  $k1, $v0 # Return address
+
+	la    $k0, _exceptionFrame
+	lw    $t0, 0x48($k0)
+	lw    $t1, 0x4c($k0)
+	lw    $at, 0x00($k0)
+	mthi  $t0
+	mtlo  $t1
+	lw    $v0, 0x04($k0)
+	lw    $v1, 0x08($k0)
+	lw    $a0, 0x0c($k0)
+	lw    $a1, 0x10($k0)
+	lw    $a2, 0x14($k0)
+	lw    $a3, 0x18($k0)
+	lw    $t0, 0x1c($k0)
+	lw    $t1, 0x20($k0)
+	lw    $t2, 0x24($k0)
+	lw    $t3, 0x28($k0)
+	lw    $t4, 0x2c($k0)
+	lw    $t5, 0x30($k0)
+	lw    $t6, 0x34($k0)
+	lw    $t7, 0x38($k0)
+	lw    $t8, 0x3c($k0)
+	lw    $t9, 0x40($k0)
+	lw    $ra, 0x44($k0)
+
+	jr    $k1
+	rfe
+
+## BIOS cache flush
+
+# Calls the BIOS's FlushCache() (A(44h)). The BIOS returns straight to our
+# caller, as we jump to it rather than calling it.
+
+.section .text.unlikely._flushCache, "ax", @progbits
+.global _flushCache
+.type _flushCache, @function
+
+_flushCache:
+	li    $t0, 0xa0
+	jr    $t0
+	li    $t1, 0x44
+
+.section .bss._exceptionFrame, "aw", @nobits
+.balign 4
+
+_exceptionFrame:
+	.space 0x50
@@ -0,0 +1,414 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Header-only fixed-point math on top of the GTE wrappers.
+ *
+ * Fixed<F, T> stores a value as a raw integer of type T with F fractional bits
+ * (so Fixed<12, int16_t> is the GTE's native 1.3.12 format). All operators
+ * compile down to the same adds, multiplies and shifts we would otherwise write
+ * by hand. In Debug builds every operation is also carried out with 64-bit
+ * intermediates and checked against the range of T, so overflows trip an
+ * assert instead of silently wrapping.
+ *
+ * Vec3 and Mat3 are plain CPU-side types. When an operand already lives in GTE
+ * registers, use the tag types in the gte namespace instead (for example
+ * gte::rotation * gte::v0) and the multiplication is turned into a single
+ * MVMVA or OP command rather than a bunch of CPU multiplies.
+ */
+
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include "gte.h"
+#include "trig.h"
+#include "ps1/cop0gte.h"
+
+namespace fixed {
+
+/* Integer traits */
+
+// We don't have <limits> or <type_traits> in this environment, so here's the
+// bare minimum needed to range check raw values.
+template<typename T> struct IntTraits {};
+
+template<> struct IntTraits<int8_t> {
+	static constexpr int64_t min = -0x80, max = 0x7f;
+};
+template<> struct IntTraits<int16_t> {
+	static constexpr int64_t min = -0x8000, max = 0x7fff;
+};
+template<> struct IntTraits<int32_t> {
+	static constexpr int64_t min = -0x80000000LL, max = 0x7fffffffLL;
+};
+
+template<typename T> static inline T narrow(int64_t value) {
+	// Only check in Debug builds. The assert compiles out along with the
+	// comparisons when NDEBUG is defined.
+	assert(
+		(value >= IntTraits<T>::min) && (value <= IntTraits<T>::max)
+		&& "fixed-point overflow"
+	);
+	return (T) value;
+}
+
+// Intermediate type for all arithmetic. Release builds use plain 32-bit ints,
+// the same as hand-written code; Debug builds widen them so narrow() can tell
+// when a result has overflowed.
+#ifdef NDEBUG
+using Wide = int32_t;
+#else
+using Wide = int64_t;
+#endif
+
+/* Scalars */
+
+template<int F, typename T = int32_t> class Fixed {
+public:
+	static constexpr int FRAC_BITS = F;
+	static constexpr T   ONE_RAW   = T(1) << F;
+
+	T raw;
+
+	constexpr Fixed(void) : raw(0) {}
+
+	static constexpr Fixed fromRaw(T value) {
+		Fixed out;
+		out.raw = value;
+		return out;
+	}
+	static inline Fixed fromInt(int value) {
+		return fromRaw(narrow<T>(Wide(value) << F));
+	}
+
+	// Converting between formats is explicit, as it may lose precision or
+	// overflow. Shifting is done on a widened value in Debug builds.
+	template<int G, typename U> explicit inline Fixed(Fixed<G, U> other) {
+		constexpr int right = (G > F) ? (G - F) : 0;
+		constexpr int left  = (F > G) ? (F - G) : 0;
+
+		raw = narrow<T>((Wide(other.raw) >> right) << left);
+	}
+
+	inline int toInt(void) const {
+		return raw >> F;
+	}
+	inline int round(void) const {
+		return (raw + (ONE_RAW >> 1)) >> F;
+	}
+
+	inline Fixed operator-(void) const {
+		return fromRaw(narrow<T>(-Wide(raw)));
+	}
+	inline Fixed operator+(Fixed other) const {
+		return fromRaw(narrow<T>(Wide(raw) + other.raw));
+	}
+	inline Fixed operator-(Fixed other) const {
+		return fromRaw(narrow<T>(Wide(raw) - other.raw));
+	}
+
+	// Multiplying by another fixed-point value keeps this value's format, so
+	// e.g. a Q0 world coordinate times a Q12 sine is still a Q0 coordinate.
+	template<int G, typename U> inline Fixed operator*(Fixed<G, U> other) const {
+		return fromRaw(narrow<T>((Wide(raw) * other.raw) >> G));
+	}
+	inline Fixed operator*(int value) const {
+		return fromRaw(narrow<T>(Wide(raw) * value));
+	}
+	inline Fixed operator/(int value) const {
+		return fromRaw(raw / value);
+	}
+	inline Fixed operator>>(int shift) const {
+		return fromRaw(raw >> shift);
+	}
+	inline Fixed operator<<(int shift) const {
+		return fromRaw(narrow<T>(Wide(raw) << shift));
+	}
+
+	inline Fixed &operator+=(Fixed other) {
+		return *this = *this + other;
+	}
+	inline Fixed &operator-=(Fixed other) {
+		return *this = *this - other;
+	}
+	template<int G, typename U> inline Fixed &operator*=(Fixed<G, U> other) {
+		return *this = *this * other;
+	}
+	inline Fixed &operator*=(int value) {
+		return *this = *this * value;
+	}
+
+	inline bool operator==(Fixed other) const { return raw == other.raw; }
+	inline bool operator!=(Fixed other) const { return raw != other.raw; }
+	inline bool operator< (Fixed other) const { return raw <  other.raw; }
+	inline bool operator<=(Fixed other) const { return raw <= other.raw; }
+	inline bool operator> (Fixed other) const { return raw >  other.raw; }
+	inline bool operator>=(Fixed other) const { return raw >= other.raw; }
+};
+
+// Commonly used formats. Q12 matches the GTE's ONE (1 << 12), Q0 is a plain
+// integer (world coordinates) that still benefits from the overflow checks.
+using Q0    = Fixed<0,  int32_t>;
+using Q12   = Fixed<12, int32_t>;
+using Q12s  = Fixed<12, int16_t>;
+using Angle = int; // 4096 units per full turn, as used by isin()/icos()
+
+static inline Q12 sin(Angle angle) {
+	return Q12::fromRaw(isin(angle));
+}
+static inline Q12 cos(Angle angle) {
+	return Q12::fromRaw(icos(angle));
+}
+
+/* Vectors */
+
+template<typename T> struct Vec3 {
+	T x, y, z;
+
+	inline Vec3 operator-(void) const {
+		return { -x, -y, -z };
+	}
+	inline Vec3 operator+(const Vec3 &other) const {
+		return { x + other.x, y + other.y, z + other.z };
+	}
+	inline Vec3 operator-(const Vec3 &other) const {
+		return { x - other.x, y - other.y, z - other.z };
+	}
+	template<typename S> inline Vec3 operator*(S scale) const {
+		return { x * scale, y * scale, z * scale };
+	}
+	inline Vec3 operator>>(int shift) const {
+		return { x >> shift, y >> shift, z >> shift };
+	}
+
+	inline Vec3 &operator+=(const Vec3 &other) {
+		return *this = *this + other;
+	}
+	inline Vec3 &operator-=(const Vec3 &other) {
+		return *this = *this - other;
+	}
+};
+
+using Vec3i  = Vec3<Q0>;
+using Vec3q  = Vec3<Q12>;
+
+// Like the GTE, these add up the products before shifting, so they give the
+// same results as OP (and MVMVA, for dot products). The sum is only 32 bits
+// wide in Release builds, so Debug builds check it fits before shifting.
+template<int F, typename T, int G, typename U>
+static inline Fixed<F, T> dot(const Vec3<Fixed<F, T>> &a, const Vec3<Fixed<G, U>> &b) {
+	Wide sum = 0
+		+ Wide(a.x.raw) * b.x.raw
+		+ Wide(a.y.raw) * b.y.raw
+		+ Wide(a.z.raw) * b.z.raw;
+
+	return Fixed<F, T>::fromRaw(narrow<T>(narrow<int32_t>(sum) >> G));
+}
+
+template<int F, typename T, int G, typename U>
+static inline Vec3<Fixed<F, T>> cross(const Vec3<Fixed<F, T>> &a, const Vec3<Fixed<G, U>> &b) {
+	Wide x = Wide(a.y.raw) * b.z.raw - Wide(a.z.raw) * b.y.raw;
+	Wide y = Wide(a.z.raw) * b.x.raw - Wide(a.x.raw) * b.z.raw;
+	Wide z = Wide(a.x.raw) * b.y.raw - Wide(a.y.raw) * b.x.raw;
+
+	return {
+		Fixed<F, T>::fromRaw(narrow<T>(narrow<int32_t>(x) >> G)),
+		Fixed<F, T>::fromRaw(narrow<T>(narrow<int32_t>(y) >> G)),
+		Fixed<F, T>::fromRaw(narrow<T>(narrow<int32_t>(z) >> G))
+	};
+}
+
+// Converts a vector into the 16-bit layout expected by gte_loadV0() and
+// friends. Each component must fit in an int16_t.
+template<int F, typename T>
+static inline GTEVector16 toGTEVector(const Vec3<Fixed<F, T>> &v) {
+	GTEVector16 out;
+
+	out.x = narrow<int16_t>(v.x.raw);
+	out.y = narrow<int16_t>(v.y.raw);
+	out.z = narrow<int16_t>(v.z.raw);
+	return out;
+}
+
+/* Matrices */
+
+// Row-major 3x3 matrix in 1.3.12 format. The layout is identical to GTEMatrix,
+// so it can be handed to gte_loadRotationMatrix() without any conversion.
+struct Mat3 {
+	int16_t values[3][3];
+	uint8_t _padding[2];
+
+	static inline Mat3 identity(void) {
+		return {{
+			{ ONE,   0,   0 },
+			{   0, ONE,   0 },
+			{   0,   0, ONE }
+		}, { 0, 0 }};
+	}
+	static inline Mat3 rotationX(Angle angle) {
+		int16_t s = isin(angle), c = icos(angle);
+
+		return {{ { ONE, 0, 0 }, { 0, c, (int16_t) -s }, { 0, s, c } }, { 0, 0 }};
+	}
+	static inline Mat3 rotationY(Angle angle) {
+		int16_t s = isin(angle), c = icos(angle);
+
+		return {{ { c, 0, s }, { 0, ONE, 0 }, { (int16_t) -s, 0, c } }, { 0, 0 }};
+	}
+	static inline Mat3 rotationZ(Angle angle) {
+		int16_t s = isin(angle), c = icos(angle);
+
+		return {{ { c, (int16_t) -s, 0 }, { s, c, 0 }, { 0, 0, ONE } }, { 0, 0 }};
+	}
+
+	inline Q12s at(int row, int column) const {
+		return Q12s::fromRaw(values[row][column]);
+	}
+
+	// CPU path, equivalent to MVMVA with the sf bit set (as long as nothing
+	// saturates): each row's products are summed, then shifted. As with dot(),
+	// the sums must fit in 32 bits.
+	template<int F, typename T>
+	inline Vec3<Fixed<F, T>> operator*(const Vec3<Fixed<F, T>> &v) const {
+		return { row(0, v), row(1, v), row(2, v) };
+	}
+	inline Mat3 operator*(const Mat3 &other) const {
+		Mat3 out;
+
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				Wide sum = 0;
+
+				for (int k = 0; k < 3; k++)
+					sum += Wide(values[i][k]) * other.values[k][j];
+
+				out.values[i][j] = narrow<int16_t>(narrow<int32_t>(sum) >> 12);
+			}
+		}
+
+		out._padding[0] = 0;
+		out._padding[1] = 0;
+		return out;
+	}
+
+	template<int F, typename T>
+	inline Fixed<F, T> row(int index, const Vec3<Fixed<F, T>> &v) const {
+		Wide sum = 0
+			+ Wide(values[index][0]) * v.x.raw
+			+ Wide(values[index][1]) * v.y.raw
+			+ Wide(values[index][2]) * v.z.raw;
+
+		return Fixed<F, T>::fromRaw(narrow<T>(narrow<int32_t>(sum) >> 12));
+	}
+
+	inline const GTEMatrix *toGTE(void) const {
+		return reinterpret_cast<const GTEMatrix *>(this);
+	}
+};
+
+static_assert(sizeof(Mat3) == sizeof(GTEMatrix), "Mat3 must match GTEMatrix");
+
+/* GTE-resident operands */
+
+namespace gte {
+
+// Tag types standing in for values that are already loaded into GTE
+// registers. They carry no data; overload resolution on them is what selects
+// the GTE command at compile time.
+template<uint32_t MX> struct MatrixOperand {};
+template<uint32_t V>  struct VectorOperand {};
+struct DiagonalOperand {}; // RT11, RT22, RT33 (used by OP)
+
+static constexpr MatrixOperand<GTE_MX_RT>  rotation   = {};
+static constexpr MatrixOperand<GTE_MX_LLM> light      = {};
+static constexpr MatrixOperand<GTE_MX_LCM> lightColor = {};
+static constexpr VectorOperand<GTE_V_V0>   v0         = {};
+static constexpr VectorOperand<GTE_V_V1>   v1         = {};
+static constexpr VectorOperand<GTE_V_V2>   v2         = {};
+static constexpr VectorOperand<GTE_V_IR>   ir         = {};
+static constexpr DiagonalOperand           diagonal   = {};
+
+static inline void checkFlags(void) {
+#ifndef NDEBUG
+	uint32_t flags = gte_getFlags();
+
+	assert(
+		!(flags & (
+			GTE_FLAG_IR1_SATURATED | GTE_FLAG_IR2_SATURATED |
+			GTE_FLAG_IR3_SATURATED | GTE_FLAG_MAC1_OVERFLOW |
+			GTE_FLAG_MAC2_OVERFLOW | GTE_FLAG_MAC3_OVERFLOW
+		)) && "GTE overflow"
+	);
+#endif
+}
+
+static inline Vec3q readIR(void) {
+	return {
+		Q12::fromRaw(gte_getIR1()),
+		Q12::fromRaw(gte_getIR2()),
+		Q12::fromRaw(gte_getIR3())
+	};
+}
+static inline void loadIR(const Vec3q &v) {
+	gte_setIR1(v.x.raw);
+	gte_setIR2(v.y.raw);
+	gte_setIR3(v.z.raw);
+}
+static inline void loadRotation(const Mat3 &m) {
+	gte_loadRotationMatrix(m.toGTE());
+}
+static inline void loadDiagonal(const Vec3q &v) {
+	// Note that this overwrites the current rotation matrix, as OP takes its
+	// first operand from the RT diagonal.
+	gte_setRotationMatrix(
+		narrow<int16_t>(v.x.raw), 0, 0,
+		0, narrow<int16_t>(v.y.raw), 0,
+		0, 0, narrow<int16_t>(v.z.raw)
+	);
+}
+
+// Matrix * vector with both operands in GTE registers: a single MVMVA.
+template<uint32_t MX, uint32_t V>
+static inline Vec3q operator*(MatrixOperand<MX>, VectorOperand<V>) {
+	gte_command(GTE_CMD_MVMVA | GTE_SF | MX | V | GTE_CV_NONE);
+	checkFlags();
+	return readIR();
+}
+
+// Matrix * vector with only the matrix in GTE registers: upload the vector to
+// IR1-3 first, then issue MVMVA.
+template<uint32_t MX>
+static inline Vec3q operator*(MatrixOperand<MX> m, const Vec3q &v) {
+	loadIR(v);
+	return m * ir;
+}
+
+// Cross product of the RT diagonal and IR1-3: a single OP.
+static inline Vec3q cross(DiagonalOperand, VectorOperand<GTE_V_IR>) {
+	gte_command(GTE_CMD_OP | GTE_SF);
+	checkFlags();
+	return readIR();
+}
+static inline Vec3q cross(const Vec3q &a, const Vec3q &b) {
+	loadDiagonal(a);
+	loadIR(b);
+	return cross(diagonal, ir);
+}
+
+}
+
+}
@@ -17,6 +17,7 @@
 #include <stdint.h>
 #include "font.h"
 #include "gpu.h"
+#include "packet.hpp"
 
 static const SpriteInfo fontSprites[] = {
 	{ .x =  6, .y =  0, .width = 2, .height = 9 }, // !
@@ -116,64 +117,69 @@ static const SpriteInfo fontSprites[] = {
 	{ .x = 90, .y = 45, .width = 6, .height = 9 }  // Invalid character
 };
 
+const SpriteInfo *layoutCharacter(char ch, int lineX, int *x, int *y) {
+	// Check if the character is "special" and shall be handled without
+	// drawing any sprite, or if it's invalid and should be rendered as a box
+	// with a question mark (character code 127).
+	switch (ch) {
+		case '\t':
+			*x += FONT_TAB_WIDTH - 1; //[Possible bug]
+			// When adding tab while aligned with tab width,
+			// The text does not add more space
+			*x -= *x % FONT_TAB_WIDTH;
+			return 0;
+
+		case '\n':
+			*x  = lineX;
+			*y += FONT_LINE_HEIGHT;
+			return 0;
+
+		case ' ':
+			*x += FONT_SPACE_WIDTH;
+			return 0;
+
+		case '\x80' ... '\xff':
+			ch = '\x7f';
+			break;
+	}
+
+	// If the character was not a tab, newline or space, fetch its respective
+	// entry from the sprite coordinate table. The caller draws it at the
+	// current position, which is then moved past it.
+	const SpriteInfo *sprite = &fontSprites[ch - FONT_FIRST_TABLE_CHAR];
+
+	*x += sprite->width;
+	return sprite;
+}
+
 void printString(
 	DMAChain *chain, const TextureInfo *font, int x, int y, const char *str
 ) {
 	int currentX = x, currentY = y;
 
-	uint32_t *ptr;
-
 	// Iterate over every character in the string.
 	for (; *str; str++) {
-		char ch = *str;
-
-		// Check if the character is "special" and shall be handled without
-		// drawing any sprite, or if it's invalid and should be rendered as a
-		// box with a question mark (character code 127).
-		switch (ch) {
-			case '\t':
-				currentX += FONT_TAB_WIDTH - 1; //[Possible bug]
-				// When adding tab while aligned with tab width,
-				// The text does not add more space
-				currentX -= currentX % FONT_TAB_WIDTH;
-				continue;
+		int spriteX = currentX, spriteY = currentY;
 
-			case '\n':
-				currentX  = x;
-				currentY += FONT_LINE_HEIGHT;
-				continue;
+		const SpriteInfo *sprite =
+			layoutCharacter(*str, x, &currentX, &currentY);
 
-			case ' ':
-				currentX += FONT_SPACE_WIDTH;
-				continue;
-
-			case '\x80' ... '\xff':
-				ch = '\x7f';
-				break;
-		}
-
-		// If the character was not a tab, newline or space, fetch its
-		// respective entry from the sprite coordinate table.
-		const SpriteInfo *sprite = &fontSprites[ch - FONT_FIRST_TABLE_CHAR];
+		if (!sprite)
+			continue;
 
 		// Draw the character, summing the UV coordinates of the spritesheet in
 		// VRAM to those of the sprite itself within the sheet. Enable blending
 		// to make sure any semitransparent pixels in the font get rendered
 		// correctly.
-		ptr    = allocatePacket(chain, 0, 4);
-		ptr[0] = gp0_rectangle(true, true, true);
-		ptr[1] = gp0_xy(currentX, currentY);
-		ptr[2] = gp0_uv(font->u + sprite->x, font->v + sprite->y, font->clut);
-		ptr[3] = gp0_xy(sprite->width, sprite->height);
-
-		// Move onto the next character.
-		currentX += sprite->width;
+		auto *glyph = packet::emplace<packet::Sprite<true, true>>(chain, 0);
+		glyph->xy   = gp0_xy(spriteX, spriteY);
+		glyph->uv   = gp0_uv(font->u + sprite->x, font->v + sprite->y, font->clut);
+		glyph->wh   = gp0_xy(sprite->width, sprite->height);
 	}
 
 	// Start by sending a texpage command to tell the GPU to use the font's
 	// spritesheet. Note that the texpage command before a drawing command can
 	// be omitted when reusing the same texture, so sending it here just once is
 	// enough.
-	ptr    = allocatePacket(chain, 0, 1);
-	ptr[0] = gp0_texpage(font->page, false, false);
+	packet::emplace<packet::Texpage>(chain, 0)->set(font->page, false, false);
 }
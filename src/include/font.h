@@ -32,6 +32,11 @@ typedef struct {
 extern "C" {
 #endif
 
+// Works out where a character goes. Returns the sprite to draw at (*x, *y)
+// before moving the position past it, or null for whitespace, which only moves
+// the position. lineX is where a newline goes back to.
+const SpriteInfo *layoutCharacter(char ch, int lineX, int *x, int *y);
+
 void printString(
 	DMAChain *chain, const TextureInfo *font, int x, int y, const char *str
 );
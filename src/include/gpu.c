@@ -16,12 +16,16 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "arena.h"
+#include "cache.h"
 #include "gpu.h"
+#include "hal.h"
 #include "ps1/gpucmd.h"
 #include "ps1/registers.h"
 
-void setupGPU(GP1VideoMode mode, int width, int height){
+COLD void setupGPU(GP1VideoMode mode, int width, int height){
     int x=0x760;
     int y= (mode == GP1_MODE_PAL) ? 0xa3 : 0x88;
 
@@ -37,12 +41,12 @@ void setupGPU(GP1VideoMode mode, int width, int height){
 
     // Hand the parameters to the GPU via "GP1 commands".
     // We will be using GP1 commands to talk to the GPU directly
-    GPU_GP1 = gp1_resetGPU();
-    GPU_GP1 = gp1_fbRangeH(x - offsetX, x + offsetX); // Set the Horizontal range of the framebuffer
-    GPU_GP1 = gp1_fbRangeV(y - offsetY, y + offsetY); // Set the Vertical range of the framebuffer
-    GPU_GP1 = gp1_fbMode( // Set up some other variables for this framebuffer.
+    hal_writeGP1(gp1_resetGPU());
+    hal_writeGP1(gp1_fbRangeH(x - offsetX, x + offsetX)); // Set the Horizontal range of the framebuffer
+    hal_writeGP1(gp1_fbRangeV(y - offsetY, y + offsetY)); // Set the Vertical range of the framebuffer
+    hal_writeGP1(gp1_fbMode( // Set up some other variables for this framebuffer.
         horizontalRes, verticalRes, mode, false, GP1_COLOR_16BPP
-    );
+    ));
 }
 
 void waitForGP0Ready(void){
@@ -51,14 +55,14 @@ void waitForGP0Ready(void){
     // GP0, on the other hand is for actually rendering things
     // This function will block until the GPU reports that GP0 is ready to receive an instruction
     // The status register that tells us this is mapped to the same location as GP1, except only when reading
-    while(!(GPU_GP1 & GP1_STAT_CMD_READY)){
+    while(!(hal_readGPUStat() & GP1_STAT_CMD_READY)){
         __asm__ volatile(""); // Do absolutely nothing
     }
 }
 
 void waitForDMADone(){
     // Wait until the GPU's DMA unit has finished sending data and is ready.
-    while (DMA_CHCR(DMA_GPU) & DMA_CHCR_ENABLE){
+    while (hal_isDMABusy(DMA_GPU)){
         __asm__ volatile("");
     }
 }
@@ -67,10 +71,10 @@ void waitForVSync(void){
     // The GPU doesn't directly say when its done rendering a frame, but it does tell the "interrupt controller".
     // We can read the contents of the interrupt controller's flags and see if the vblank flag is set.
     // if it is, we can reset (acknowledge) it so it can be set again by the GPU after the next frame.
-    while(!(IRQ_STAT & (1 << IRQ_VSYNC))){
+    while(!hal_isIRQPending(IRQ_VSYNC)){
         __asm__ volatile("");
     }
-    IRQ_STAT = ~(1 << IRQ_VSYNC);
+    hal_acknowledgeIRQ(IRQ_VSYNC);
 }
 
 void sendLinkedList(const void *data){
@@ -78,18 +82,17 @@ void sendLinkedList(const void *data){
 
     // Make sure the pointer is aligned to 32 bits (4 bytes).
     // The DMA engine cannot read unaligned data.
-    assert(!((uint32_t) data % 4));
+    assert(!((uintptr_t) data % 4));
 
     // Give DMA a pointer to the beginning of the data and tell it to send it in linked list mode.
     // The DMA unit will start parsing a chain of "packets" from RAM.
     // Each packet is made up of a 32-bit header followed by zero or more 32-bit GP0 commands.
-    DMA_MADR(DMA_GPU) = (uint32_t) data;
-    DMA_CHCR(DMA_GPU) = DMA_CHCR_WRITE | DMA_CHCR_MODE_LIST | DMA_CHCR_ENABLE;
+    hal_startDMA(DMA_GPU, data, 0, DMA_CHCR_WRITE | DMA_CHCR_MODE_LIST | DMA_CHCR_ENABLE);
 }
 
-void sendVRAMData(const void *data, int x, int y, int w, int h){
+COLD void sendVRAMData(const void *data, int x, int y, int w, int h){
     waitForDMADone();
-    assert(!((uint32_t) data % 4));
+    assert(!((uintptr_t) data % 4));
 
     // How many 32-bit words need to be sent to send the whole texture?
     // If more than 16 words, split the transfer into sets of 16 words.
@@ -109,14 +112,15 @@ void sendVRAMData(const void *data, int x, int y, int w, int h){
     
     // Put the GPU into VRAM upload mode.
     waitForGP0Ready();
-    GPU_GP0 = gp0_vramWrite();
-    GPU_GP0 = gp0_xy(x,y);
-    GPU_GP0 = gp0_xy(w, h);
+    hal_writeGP0(gp0_vramWrite());
+    hal_writeGP0(gp0_xy(x,y));
+    hal_writeGP0(gp0_xy(w, h));
 
     // Give DMA a pointer to the data and tell it to send the data in slice (chunked) mode.
-    DMA_MADR(DMA_GPU) = (uint32_t) data;
-    DMA_BCR (DMA_GPU) = chunkSize | (numChunks << 16);
-    DMA_CHCR(DMA_GPU) = DMA_CHCR_WRITE | DMA_CHCR_MODE_SLICE | DMA_CHCR_ENABLE;
+    hal_startDMA(
+        DMA_GPU, data, chunkSize | (numChunks << 16),
+        DMA_CHCR_WRITE | DMA_CHCR_MODE_SLICE | DMA_CHCR_ENABLE
+    );
 
 }
 
@@ -125,23 +129,280 @@ void clearOrderingTable(uint32_t *table, int numEntries) {
 	// The table is always reversed and generated "backwards" (the last item in
 	// the table is the first one that will be written), so we must give DMA a
 	// pointer to the end of the table rather than its beginning.
-	DMA_MADR(DMA_OTC) = (uint32_t) &table[numEntries - 1];
-	DMA_BCR (DMA_OTC) = numEntries;
-	DMA_CHCR(DMA_OTC) = 0
-		| DMA_CHCR_READ | DMA_CHCR_REVERSE | DMA_CHCR_MODE_BURST
-		| DMA_CHCR_ENABLE | DMA_CHCR_TRIGGER;
+	hal_startDMA(
+		DMA_OTC, &table[numEntries - 1], numEntries, 0
+			| DMA_CHCR_READ | DMA_CHCR_REVERSE | DMA_CHCR_MODE_BURST
+			| DMA_CHCR_ENABLE | DMA_CHCR_TRIGGER
+	);
 
 	// Wait for DMA to finish generating the table.
-	while (DMA_CHCR(DMA_OTC) & DMA_CHCR_ENABLE)
+	while (hal_isDMABusy(DMA_OTC))
 		__asm__ volatile("");
 }
 
+// The link words ending each band but the nearest go in front of the packets.
+static int _getLinkWords(const ChainConfig *config){
+    return (config->bandCount > 1) ? (config->bandCount - 1) : 0;
+}
+
+// Returns how much memory initChain() needs for the given configuration. The
+// ordering table, packet buffer and frame arena all live in this one block.
+COLD size_t getChainMemorySize(const ChainConfig *config){
+    size_t dataWords = config->packetWords + _getLinkWords(config);
+
+    return 0
+        + sizeof(uint32_t) * ORDERING_TABLE_SIZE
+        + ((sizeof(uint32_t) * dataWords + 7) & ~7)
+        + ((config->arenaSize + 7) & ~7);
+}
+
+// Lowest ordering table index in a band. Passing bandCount gives the end of
+// the table.
+static inline int _getBandStart(const DMAChain *chain, int band){
+    return (band * ORDERING_TABLE_SIZE) / chain->bandCount;
+}
+
+static inline uint32_t *_getFirstPacket(const DMAChain *chain){
+    return chain->data + chain->bandCount - 1;
+}
+
+// Points the lowest entry of every band not sent yet at the band's link word,
+// and the link word on to the next band down. The table must have just been
+// cleared. The chain can still be sent in one go, as if it had no bands.
+static void _linkBands(DMAChain *chain){
+    uint32_t *table = chain->orderingTable;
+
+    for(int band = 1; band <= chain->nextBand; band++){
+        int      start = _getBandStart(chain, band);
+        uint32_t *link = &chain->data[band - 1];
+
+        *link        = gp0_tag(0, &table[start - 1]);
+        table[start] = gp0_tag(0, link);
+    }
+}
+
+// Links the band that ended the last transfer back up to the rest of the
+// chain. DMA must have finished reading it.
+static void _restoreStoppedLink(DMAChain *chain){
+    uint32_t *link = chain->stoppedLink;
+
+    if(!link){
+        return;
+    }
+
+    int start = _getBandStart(chain, (link - chain->data) + 1);
+
+    *link              = gp0_tag(0, &chain->orderingTable[start - 1]);
+    chain->stoppedLink = 0;
+}
+
+// Sends every band from the farthest one not sent yet down to the given one,
+// by ending the transfer at the lowest band's link word. DMA must be idle.
+static void _sendBands(DMAChain *chain, int lowestBand){
+    int top = _getBandStart(chain, chain->nextBand + 1);
+
+    if(lowestBand > 0){
+        chain->stoppedLink  = &chain->data[lowestBand - 1];
+        *chain->stoppedLink = gp0_endTag(0);
+    }
+
+    chain->nextBand   = lowestBand - 1;
+    chain->openZIndex = _getBandStart(chain, lowestBand);
+
+    sendLinkedList(&(chain->orderingTable)[top - 1]);
+}
+
+// Sets up a chain inside a block of memory provided by the caller, so the
+// buffers can be sized at startup (and budgeted per level) rather than being
+// fixed at compile time.
+COLD void initChain(DMAChain *chain, const ChainConfig *config, void *memory){
+    assert(!((uintptr_t) memory % 8));
+    assert(config->reserveWords < config->packetWords);
+    assert(config->bandCount <= CHAIN_MAX_BANDS);
+
+    uint32_t *ptr = (uint32_t *) memory;
+
+    chain->orderingTable = ptr;
+    ptr += ORDERING_TABLE_SIZE;
+    chain->data    = ptr;
+    chain->dataEnd = ptr + _getLinkWords(config) + config->packetWords;
+
+    // The arena goes after the packet buffer, aligned to 8 bytes.
+    initArena(
+        &chain->arena, (void *) (((uintptr_t) chain->dataEnd + 7) & ~7),
+        config->arenaSize
+    );
+
+    chain->overflowPolicy = config->overflowPolicy;
+    chain->reserveWords   = config->reserveWords;
+
+    // Flushing doesn't need any headroom, so it only kicks in once the buffer
+    // is actually full.
+    if(chain->overflowPolicy == CHAIN_OVERFLOW_DROP_FAR){
+        chain->softLimit = chain->dataEnd - chain->reserveWords;
+    } else {
+        chain->softLimit = chain->dataEnd;
+    }
+
+    chain->stats.frameWords     = 0;
+    chain->stats.peakWords      = 0;
+    chain->stats.droppedPackets = 0;
+    chain->stats.flushes        = 0;
+    chain->stats.streamedBands  = 0;
+
+    chain->bandCount   = _getLinkWords(config) + 1;
+    chain->nextBand    = chain->bandCount - 1;
+    chain->openZIndex  = ORDERING_TABLE_SIZE;
+    chain->stoppedLink = 0;
+
+    chain->nextPacket     = _getFirstPacket(chain);
+    chain->flushedWords   = 0;
+    chain->droppedPackets = 0;
+    chain->flushes        = 0;
+    chain->streamedBands  = 0;
+}
+
+// Gets a chain ready to be filled in again. This must only be done once the GPU
+// has finished drawing it, as it frees every packet in the chain as well as
+// everything allocated from its frame arena. The statistics of the frame that
+// was previously built with the chain are saved first.
+void resetChain(DMAChain *chain){
+    ChainStats *stats = &chain->stats;
+
+    stats->frameWords     = getChainWords(chain);
+    stats->droppedPackets = chain->droppedPackets;
+    stats->flushes        = chain->flushes;
+    stats->streamedBands  = chain->streamedBands;
+    if(stats->frameWords > stats->peakWords){
+        stats->peakWords = stats->frameWords;
+    }
+
+    clearOrderingTable(chain->orderingTable, ORDERING_TABLE_SIZE);
+    chain->nextBand    = chain->bandCount - 1;
+    chain->openZIndex  = ORDERING_TABLE_SIZE;
+    chain->stoppedLink = 0;
+    _linkBands(chain);
+
+    chain->nextPacket     = _getFirstPacket(chain);
+    chain->flushedWords   = 0;
+    chain->droppedPackets = 0;
+    chain->flushes        = 0;
+    chain->streamedBands  = 0;
+    resetArena(&chain->arena);
+}
+
+// Words of packets queued in the frame so far, including any that have been
+// flushed. The link words ending each band aren't counted.
+uint32_t getChainWords(const DMAChain *chain){
+    return chain->flushedWords + (chain->nextPacket - _getFirstPacket(chain));
+}
+
+// Sends whatever has been queued in the chain so far and empties it, without
+// touching the frame arena. GPU state such as the drawing area carries over
+// into whatever is queued next. Bands that have already been sent are left
+// alone.
+void flushChain(DMAChain *chain){
+    // Wait for the previous chain to be sent, as DMA can only do one at a time.
+    waitForDMADone();
+    waitForGP0Ready();
+    _restoreStoppedLink(chain);
+    sendLinkedList(&(chain->orderingTable)[chain->openZIndex - 1]);
+
+    // The packets can't be overwritten until DMA has read all of them.
+    waitForDMADone();
+
+    chain->flushedWords += chain->nextPacket - _getFirstPacket(chain);
+    chain->flushes++;
+
+    clearOrderingTable(chain->orderingTable, chain->openZIndex);
+    _linkBands(chain);
+    chain->nextPacket = _getFirstPacket(chain);
+}
+
+// Sends every band lying entirely farther back than the given Z index, i.e.
+// every band nothing more is going to be queued in, so the GPU can start
+// drawing them while the rest of the chain is built. If DMA is still busy
+// sending the last bands, they're left for a later call instead, so this never
+// waits. Does nothing if the chain isn't split into bands.
+//
+// The chain must be drawing to a framebuffer that isn't currently on screen.
+// Anything queued in a band after it has been sent is moved to the farthest
+// band still open.
+void submitChainBands(DMAChain *chain, int nearestZIndex){
+    int band = chain->nextBand;
+
+    while((band >= 0) && (_getBandStart(chain, band) > nearestZIndex)){
+        band--;
+    }
+
+    if((band == chain->nextBand) || hal_isDMABusy(DMA_GPU)){
+        return;
+    }
+
+    _restoreStoppedLink(chain);
+    chain->streamedBands += chain->nextBand - band;
+    _sendBands(chain, band + 1);
+}
+
+// Sends everything in the chain that hasn't been sent yet, which for a chain
+// without bands is the whole of it. Nothing can be queued afterwards until the
+// chain is reset.
+void finishChain(DMAChain *chain){
+    waitForDMADone();
+    _restoreStoppedLink(chain);
+
+    if(chain->nextBand >= 0){
+        _sendBands(chain, 0);
+    }
+}
+
+// Waits for any bands being sent and links them back up to the rest of the
+// chain, so the whole of it can be walked from the end of the ordering table
+// again (e.g. to capture it).
+void relinkChainBands(DMAChain *chain){
+    waitForDMADone();
+    _restoreStoppedLink(chain);
+}
+
+// Dropped packets are written here instead, so callers don't need to check
+// whether allocatePacket() succeeded. 256 words fits the largest possible packet.
+static uint32_t _overflowPacket[256];
+
+// Slow path of allocatePacket(), taken once the buffer is past its soft limit.
+static COLD uint32_t *_allocatePacketOverflow(DMAChain *chain, int zIndex, int numWords){
+    uint32_t *ptr = chain->nextPacket;
+
+    if(chain->overflowPolicy == CHAIN_OVERFLOW_FLUSH){
+        if((ptr + numWords) > chain->dataEnd){
+            flushChain(chain);
+            ptr = chain->nextPacket;
+        }
+    } else {
+        // Scale the farthest accepted bucket with the space left in the
+        // reserve, so the cutoff moves closer as the buffer fills up.
+        int remaining = chain->dataEnd - (ptr + numWords);
+        int maxZIndex = ORDERING_TABLE_SIZE;
+
+        if(chain->reserveWords){
+            maxZIndex = (remaining * ORDERING_TABLE_SIZE) / (int) chain->reserveWords;
+        }
+
+        if((remaining < 0) || (zIndex > maxZIndex)){
+            chain->droppedPackets++;
+            return 0;
+        }
+    }
+
+    chain->nextPacket = ptr + numWords;
+    return ptr;
+}
+
 // As we're using an ordering table, allocatePacket() now takes the packet's Z
 // index (i.e. the index of the "bucket" to link it to) as an argument. The
 // table is reversed, so packets with higher Z values will be drawn first and
 // between two packets with the same Z index the most recently added one will
 // take precedence.
-uint32_t *allocatePacket(DMAChain *chain, int zIndex, int numCommands) {
+HOT uint32_t *allocatePacket(DMAChain *chain, int zIndex, int numCommands) {
 	uint32_t *ptr      = chain->nextPacket;
 	chain->nextPacket += numCommands + 1;
 
@@ -149,19 +410,33 @@ uint32_t *allocatePacket(DMAChain *chain, int zIndex, int numCommands) {
 	assert(zIndex >= 0);
     assert((zIndex < ORDERING_TABLE_SIZE));
 
+	// Bands that have already been sent can't take any more packets, so
+	// anything that would go in one is drawn behind what's left instead.
+	if(zIndex >= chain->openZIndex){
+		zIndex = chain->openZIndex - 1;
+	}
+
+	// Running out of space is handled according to the chain's overflow policy.
+	if(chain->nextPacket > chain->softLimit){
+		chain->nextPacket = ptr;
+		ptr = _allocatePacketOverflow(chain, zIndex, numCommands + 1);
+
+		if(!ptr){
+			return &_overflowPacket[1];
+		}
+	}
+
 	// Splice the new packet into the ordering table by:
 	// - taking the address the ordering table entry currently points to;
 	// - replacing that address with a pointer to the packet;
 	// - linking the packet to the old address.
-	*ptr = gp0_tag(numCommands, (void *) chain->orderingTable[zIndex]);
+	*ptr = gp0_tag(numCommands, (void *) (uintptr_t) chain->orderingTable[zIndex]);
 	chain->orderingTable[zIndex] = gp0_tag(0, ptr);
 
-	assert(chain->nextPacket < &(chain->data)[CHAIN_BUFFER_SIZE]);
-
 	return &ptr[1];
 }
 
-void uploadTexture(
+COLD void uploadTexture(
     TextureInfo *info, const void *data, int x, int y, int w, int h
 ){
     // Make sure the size is valid as the GPU doesn't support textures larger than 256x256
@@ -189,7 +464,7 @@ void uploadTexture(
     info->h = (uint16_t) h;
 }
 
-void uploadIndexedTexture(
+COLD void uploadIndexedTexture(
     TextureInfo *info, const void *image, int x, int y, int w, int h,
     const void *palette, int paletteX, int paletteY, GP0ColorDepth colorDepth
     ){
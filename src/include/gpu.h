@@ -16,17 +16,78 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
+#include "arena.h"
 #include "ps1/gpucmd.h"
 
 #define DMA_MAX_CHUNK_SIZE 16
-#define CHAIN_BUFFER_SIZE 32768
 #define ORDERING_TABLE_SIZE 720
 
+// Default sizes for each chain's buffers. These are only used to fill in a
+// ChainConfig; the actual sizes are picked at startup.
+#define CHAIN_BUFFER_SIZE 32768
+#define FRAME_ARENA_SIZE 16384
+
+// Most depth bands a chain's ordering table can be split into.
+#define CHAIN_MAX_BANDS 16
+
+// What allocatePacket() does once the packet buffer runs out of space.
+typedef enum {
+    // Once the buffer is nearly full, start dropping the farthest packets, pulling
+    // the cutoff closer as the remaining space shrinks. Nearby geometry and the
+    // HUD keep working while the background thins out.
+    CHAIN_OVERFLOW_DROP_FAR = 0,
+    // Send everything queued so far to the GPU, wait for it to be read and
+    // start over with an empty buffer. Sorting between the parts is lost, and the
+    // chain must be drawing to a framebuffer that isn't currently on screen.
+    CHAIN_OVERFLOW_FLUSH    = 1
+} ChainOverflowPolicy;
+
+typedef struct{
+    size_t packetWords;  // Size of the packet buffer, in 32-bit words
+    size_t arenaSize;    // Size of the frame arena, in bytes
+    size_t reserveWords; // How much of the buffer CHAIN_OVERFLOW_DROP_FAR keeps for nearer packets
+    ChainOverflowPolicy overflowPolicy;
+    int bandCount;       // Depth bands to stream the chain in (see submitChainBands()), 0 or 1 for none
+}ChainConfig;
+
+// Usage of the last frame built with the chain, plus the highest ever seen.
 typedef struct{
-    uint32_t data[CHAIN_BUFFER_SIZE];
-    uint32_t orderingTable[ORDERING_TABLE_SIZE];
+    uint32_t frameWords;     // Words of packets queued, including flushed ones
+    uint32_t peakWords;
+    uint32_t droppedPackets;
+    uint32_t flushes;
+    uint32_t streamedBands;  // Bands sent before the chain was finished
+}ChainStats;
+
+typedef struct{
+    uint32_t *data, *dataEnd;
+    uint32_t *orderingTable;
     uint32_t *nextPacket;
+
+    // allocatePacket() only has to think about overflows past this point.
+    uint32_t *softLimit;
+    size_t reserveWords;
+    ChainOverflowPolicy overflowPolicy;
+
+    // The ordering table can be split into bands of equal depth, each sent to
+    // the GPU as soon as nothing more will be queued in it. Bands are sent far
+    // to near and band 0 is the nearest. Each band but the nearest ends in a
+    // link word at the start of the packet buffer, which stops DMA at the end
+    // of the band while it's being sent.
+    int bandCount;
+    int nextBand;          // Farthest band not sent yet
+    int openZIndex;        // Packets can't be queued this far back or farther
+    uint32_t *stoppedLink; // Link word currently ending a transfer, if any
+
+    // Counters for the frame currently being built.
+    uint32_t flushedWords, droppedPackets, flushes, streamedBands;
+    ChainStats stats;
+
+    // Scratch memory for anything else the frame needs. It is reset along with
+    // the chain, so data the GPU reads while drawing stays valid until then.
+    Arena arena;
 } DMAChain;
 
 typedef struct {
@@ -47,6 +108,15 @@ void waitForVSync(void);
 void sendLinkedList(const void *data);
 void sendVRAMData(const void *data, int x, int y, int w, int h);
 void clearOrderingTable(uint32_t *table, int numEntries);
+
+size_t getChainMemorySize(const ChainConfig *config);
+void initChain(DMAChain *chain, const ChainConfig *config, void *memory);
+void resetChain(DMAChain *chain);
+void flushChain(DMAChain *chain);
+void submitChainBands(DMAChain *chain, int nearestZIndex);
+void finishChain(DMAChain *chain);
+void relinkChainBands(DMAChain *chain);
+uint32_t getChainWords(const DMAChain *chain);
 uint32_t *allocatePacket(DMAChain *chain, int zIndex, int numCommands);
 
 void uploadTexture(
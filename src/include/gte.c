@@ -14,12 +14,16 @@
  * PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include "cache.h"
 #include "gpu.h"
 #include "gte.h"
 #include "trig.h"
 
 
-void setupGTE(int width, int height){
+// Projection plane distance set by setupGTE().
+static int _fieldOfView;
+
+COLD void setupGTE(int width, int height){
     // Enable the GTE (coprocessor 2)
     cop0_setSR(cop0_getSR() | COP0_SR_CU2);
 
@@ -27,11 +31,12 @@ void setupGTE(int width, int height){
     // Also set the FOV
     gte_setXYOrigin(width / 2, height / 2);
     gte_setFieldOfView(width);
+    _fieldOfView = width;
 
     gte_setZScaleFactor((ONE * ORDERING_TABLE_SIZE) / 0x7fff);
 }
 
-void multiplyCurrentMatrixByVectors(GTEMatrix *output) {
+HOT void multiplyCurrentMatrixByVectors(GTEMatrix *output) {
     gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_RT | GTE_V_V0 | GTE_CV_NONE);
 	output->values[0][0] = gte_getIR1();
 	output->values[1][0] = gte_getIR2();
@@ -48,7 +53,7 @@ void multiplyCurrentMatrixByVectors(GTEMatrix *output) {
 	output->values[2][2] = gte_getIR3();
 }
 
-void rotateCurrentMatrix(int roll, int yaw, int pitch){
+HOT void rotateCurrentMatrix(int roll, int yaw, int pitch){
     GTEMatrix multiplied;
     int s, c;
 
@@ -95,15 +100,25 @@ void updateTranslationMatrix(int32_t x, int32_t y, int32_t z){
     int32_t ty = y;
     int32_t tz = z;
 
-    #define GTE_SET(reg, input) \
-     __asm__ volatile("mtc2 %0, $%1\n" :: "r"(input), "i"(reg))
-    GTE_SET(GTE_IR1, tx);
-    GTE_SET(GTE_IR2, ty);
-    GTE_SET(GTE_IR3, tz);
+    gte_setIR1(tx);
+    gte_setIR2(ty);
+    gte_setIR3(tz);
 	gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_RT | GTE_V_IR | GTE_CV_NONE);
     
 	tx = gte_getIR1();
     ty = gte_getIR2();
     tz = gte_getIR3();
 	gte_setTranslationVector(tx, ty, tz);
-}
\ No newline at end of file
+}
+
+COLD void setDepthCueRange(int nearZ, int farZ){
+    // RTPS computes IR0 = ((H * 0x10000 / SZ) * DQA + DQB) >> 12, so solve for
+    // DQA and DQB using the two distances.
+    int nearQuotient = (_fieldOfView * 0x10000) / nearZ;
+    int farQuotient  = (_fieldOfView * 0x10000) / farZ;
+
+    int scale = -(ONE * ONE) / (nearQuotient - farQuotient);
+    int base  = -nearQuotient * scale;
+
+    gte_setDepthCueFactor(base, scale);
+}
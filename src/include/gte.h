@@ -19,7 +19,20 @@
 
 #define ONE (1<<12)
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 void setupGTE(int width, int height);
 void multiplyCurrentMatrixByVectors(GTEMatrix *output);
 void rotateCurrentMatrix(int roll, int yaw, int pitch);
-void updateTranslationMatrix(int32_t x, int32_t y, int32_t z);
\ No newline at end of file
+void updateTranslationMatrix(int32_t x, int32_t y, int32_t z);
+
+// Sets the depth cueing factor RTPS and RTPT leave in IR0 to go from 0 at nearZ
+// to ONE at farZ, as used by DPCS and the other depth cueing commands. Must be
+// called after setupGTE().
+void setDepthCueRange(int nearZ, int farZ);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,93 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ps1/registers.h"
+
+// Hardware abstraction layer. Everything the renderer needs from the GPU, DMA
+// and interrupt controller goes through these functions rather than touching
+// the registers directly, so the same code can also be built for a PC (with
+// PS1_HOST defined) and run against the software backend in src/host/. On the
+// PS1 they are just inlined register accesses.
+//
+// The GTE and COP0 are abstracted one level lower, in ps1/cop0gte.h, and the
+// timers through initTimer() and getTicks() in timer.h.
+
+#ifdef PS1_HOST
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void hal_writeGP0(uint32_t value);
+void hal_writeGP1(uint32_t value);
+uint32_t hal_readGPUStat(void);
+
+void hal_startDMA(DMAChannel channel, const void *address, uint32_t bcr, uint32_t chcr);
+bool hal_isDMABusy(DMAChannel channel);
+
+bool hal_isIRQPending(IRQChannel channel);
+void hal_acknowledgeIRQ(IRQChannel channel);
+
+uint32_t hal_cop0Get(int reg);
+void hal_cop0Set(int reg, uint32_t value);
+uint32_t hal_gteGetData(int reg);
+void hal_gteSetData(int reg, uint32_t value);
+uint32_t hal_gteGetControl(int reg);
+void hal_gteSetControl(int reg, uint32_t value);
+void hal_gteCommand(uint32_t command);
+
+#ifdef __cplusplus
+}
+#endif
+
+#else
+
+static inline void hal_writeGP0(uint32_t value) {
+	GPU_GP0 = value;
+}
+static inline void hal_writeGP1(uint32_t value) {
+	GPU_GP1 = value;
+}
+static inline uint32_t hal_readGPUStat(void) {
+	return GPU_GP1;
+}
+
+// The address is only written to MADR, so the caller must make sure anything
+// it points to is in main RAM.
+static inline void hal_startDMA(
+	DMAChannel channel, const void *address, uint32_t bcr, uint32_t chcr
+) {
+	DMA_MADR(channel) = (uint32_t) address;
+	DMA_BCR (channel) = bcr;
+	DMA_CHCR(channel) = chcr;
+}
+static inline bool hal_isDMABusy(DMAChannel channel) {
+	return (DMA_CHCR(channel) & DMA_CHCR_ENABLE) ? true : false;
+}
+
+static inline bool hal_isIRQPending(IRQChannel channel) {
+	return (IRQ_STAT & (1 << channel)) ? true : false;
+}
+static inline void hal_acknowledgeIRQ(IRQChannel channel) {
+	IRQ_STAT = ~(1 << channel);
+}
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "cache.h"
+#include "irq.h"
+#include "ps1/cop0gte.h"
+#include "ps1/registers.h"
+
+// The CPU jumps to this address whenever an exception or interrupt occurs.
+// There's only room for a few instructions here, so we copy a small stub that
+// jumps to the real handler in exception.s.
+#define EXCEPTION_VECTOR 0x80000080
+
+extern const uint32_t _exceptionVector[], _exceptionVectorEnd[];
+void _flushCache(void);
+
+static IRQHandler _irqHandlers[IRQ_CHANNEL_COUNT];
+
+COLD void installExceptionHandler(void){
+    disableInterrupts();
+
+    // Mask and acknowledge everything the BIOS may have left enabled.
+    IRQ_MASK = 0;
+    IRQ_STAT = 0;
+
+    // Copy the stub over the BIOS's own one. The old handler may still be in
+    // the instruction cache, so we have to flush it (this is the last time
+    // we'll ever call into the BIOS).
+    volatile uint32_t *vector = (volatile uint32_t *) EXCEPTION_VECTOR;
+
+    for(const uint32_t *ptr = _exceptionVector; ptr < _exceptionVectorEnd; ptr++){
+        *(vector++) = *ptr;
+    }
+    _flushCache();
+}
+
+void setInterruptHandler(IRQChannel channel, IRQHandler handler){
+    bool enabled = disableInterrupts();
+
+    _irqHandlers[channel] = handler;
+
+    if(handler){
+        IRQ_STAT  = ~(1 << channel);
+        IRQ_MASK |= 1 << channel;
+    } else {
+        IRQ_MASK &= ~(1 << channel);
+    }
+
+    restoreInterrupts(enabled);
+}
+
+// Called by _exceptionHandler in exception.s with all scratch registers saved.
+// The return value is the address execution will resume from.
+HOT uint32_t _handleException(uint32_t epc, uint32_t cause){
+    if((cause & COP0_CAUSE_EXC_BITMASK) != COP0_CAUSE_EXC_INT){
+        // Anything that isn't an interrupt (bus errors, break instructions
+        // from -mdivide-breaks, etc.) is a crash, so report it and stop.
+#ifndef NDEBUG
+        resetSerialOutput();
+        printf("Exception: cause=%08x epc=%08x\n", cause, epc);
+#endif
+        for(;;){
+            __asm__ volatile("");
+        }
+    }
+
+    // If the interrupt arrived while a GTE command was being issued, the
+    // command has already been executed and EPC points to it. Skip over it so
+    // it doesn't run twice.
+    if(((*(const uint32_t *) epc) >> 25) == 0x25){
+        epc += 4;
+    }
+
+    // Keep dispatching until no unmasked IRQ is left pending. IRQ_STAT is
+    // re-read after each handler as handlers may acknowledge other channels.
+    while(IRQ_STAT & IRQ_MASK){
+        for(int channel = 0; channel < IRQ_CHANNEL_COUNT; channel++){
+            uint32_t bit = 1 << channel;
+
+            if(!(IRQ_STAT & IRQ_MASK & bit)){
+                continue;
+            }
+
+            IRQ_STAT = ~bit;
+
+            if(_irqHandlers[channel]){
+                _irqHandlers[channel]();
+            }
+        }
+    }
+
+    return epc;
+}
@@ -0,0 +1,61 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ps1/cop0gte.h"
+#include "ps1/registers.h"
+
+#define IRQ_CHANNEL_COUNT 11
+
+typedef void (*IRQHandler)(void);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Replaces the BIOS exception handler with our own. Once this has been called
+// the BIOS can no longer be used, but we never call into it anyway.
+void installExceptionHandler(void);
+
+// Registers a handler for an IRQ channel and unmasks it in IRQ_MASK. Passing a
+// null handler masks the channel again. Handlers run with interrupts disabled
+// and the IRQ_STAT bit already acknowledged; they must not use the GTE.
+void setInterruptHandler(IRQChannel channel, IRQHandler handler);
+
+#ifdef __cplusplus
+}
+#endif
+
+// Returns whether interrupts were enabled, so nested critical sections can
+// restore the previous state.
+static inline bool disableInterrupts(void) {
+	uint32_t sr = cop0_getSR();
+
+	cop0_setSR(sr & ~COP0_SR_IEc);
+	return (sr & COP0_SR_IEc) ? true : false;
+}
+
+static inline void enableInterrupts(void) {
+	cop0_setSR(cop0_getSR() | COP0_SR_IEc | COP0_SR_Im2);
+}
+
+static inline void restoreInterrupts(bool enabled) {
+	if (enabled)
+		enableInterrupts();
+}
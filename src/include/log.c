@@ -0,0 +1,140 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "cache.h"
+#include "irq.h"
+#include "log.h"
+#include "ps1/registers.h"
+
+#define LOG_BUFFER_MASK (LOG_BUFFER_SIZE - 1)
+
+// The interrupt handler only ever moves _tail forward and everything else only
+// touches the buffer with interrupts disabled.
+static char _buffer[LOG_BUFFER_SIZE];
+static volatile uint32_t _head = 0, _tail = 0;
+
+static LogOverflowPolicy _policy;
+static LogStats          _stats;
+
+static HOT void _logTXHandler(void){
+    // Fill the serial port's FIFO. It holds so little that this usually only
+    // sends one or two bytes, and the interrupt fires again once they're gone.
+    while((_head != _tail) && (SIO_STAT(1) & SIO_STAT_TX_NOT_FULL)){
+        SIO_DATA(1) = _buffer[_tail];
+        _tail       = (_tail + 1) & LOG_BUFFER_MASK;
+    }
+
+    // There's no point in being told the port is ready once there's nothing
+    // left to send. _logPutchar() re-enables this when it queues more.
+    if(_head == _tail){
+        SIO_CTRL(1) &= ~SIO_CTRL_TX_IRQ_ENABLE;
+    }
+
+    SIO_CTRL(1) |= SIO_CTRL_ACKNOWLEDGE;
+}
+
+static HOT void _logPutchar(char ch){
+    bool     enabled = disableInterrupts();
+    uint32_t next    = (_head + 1) & LOG_BUFFER_MASK;
+
+    if(next == _tail){
+        _stats.droppedBytes++;
+
+        if(_policy == LOG_DROP_NEWEST){
+            restoreInterrupts(enabled);
+            return;
+        }
+
+        _tail = (_tail + 1) & LOG_BUFFER_MASK;
+    }
+
+    _buffer[_head] = ch;
+    _head          = next;
+    _stats.queuedBytes++;
+
+    uint16_t usage = (_head - _tail) & LOG_BUFFER_MASK;
+
+    if(usage > _stats.peakUsage){
+        _stats.peakUsage = usage;
+    }
+
+    // If the port is already idle, this makes the interrupt fire straight away.
+    SIO_CTRL(1) |= SIO_CTRL_TX_IRQ_ENABLE;
+    restoreInterrupts(enabled);
+}
+
+COLD void initLogBuffer(LogOverflowPolicy policy){
+    _head   = 0;
+    _tail   = 0;
+    _policy = policy;
+    resetLogStats();
+
+    SIO_CTRL(1) &= ~SIO_CTRL_TX_IRQ_ENABLE;
+    SIO_CTRL(1) |= SIO_CTRL_ACKNOWLEDGE;
+
+    setInterruptHandler(IRQ_SIO1, &_logTXHandler);
+    setSerialOutputHandlers(&_logPutchar, &flushLogBuffer);
+}
+
+COLD void stopLogBuffer(void){
+    resetSerialOutput();
+    setInterruptHandler(IRQ_SIO1, 0);
+}
+
+void flushLogBuffer(void){
+    bool enabled = disableInterrupts();
+
+    while(_head != _tail){
+        // Same as _putcharBlocking(): the port won't send anything while CTS
+        // is deasserted, so give up on the rest rather than hang.
+        if(!(SIO_STAT(1) & SIO_STAT_CTS)){
+            _stats.droppedBytes += (_head - _tail) & LOG_BUFFER_MASK;
+            _tail                = _head;
+            break;
+        }
+        if(SIO_STAT(1) & SIO_STAT_TX_NOT_FULL){
+            SIO_DATA(1) = _buffer[_tail];
+            _tail       = (_tail + 1) & LOG_BUFFER_MASK;
+        }
+    }
+
+    SIO_CTRL(1) &= ~SIO_CTRL_TX_IRQ_ENABLE;
+    SIO_CTRL(1) |= SIO_CTRL_ACKNOWLEDGE;
+    restoreInterrupts(enabled);
+}
+
+void getLogStats(LogStats *stats){
+    bool enabled = disableInterrupts();
+
+    *stats       = _stats;
+    stats->usage = (_head - _tail) & LOG_BUFFER_MASK;
+
+    restoreInterrupts(enabled);
+}
+
+void resetLogStats(void){
+    bool enabled = disableInterrupts();
+
+    _stats.queuedBytes  = 0;
+    _stats.droppedBytes = 0;
+    _stats.peakUsage    = (_head - _tail) & LOG_BUFFER_MASK;
+
+    restoreInterrupts(enabled);
+}
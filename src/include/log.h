@@ -0,0 +1,106 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Buffered serial logging. Once initLogBuffer() has been called, putchar(),
+// puts() and printf() only copy text into a ring buffer, which the SIO1
+// interrupt drains in the background. If the buffer fills up, bytes are
+// dropped (and counted) instead of stalling the frame.
+//
+// The serial port has a tiny FIFO, so the interrupt fires roughly once per
+// byte sent. At 115200 baud that's ~11500 IRQs per second while there's text
+// waiting, and none at all once the buffer is empty.
+
+// Must be a power of two.
+#define LOG_BUFFER_SIZE 4096
+
+// Messages below the level set at compile time are removed entirely, along
+// with their arguments, which are never evaluated. By default release builds
+// only keep warnings and errors.
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#ifdef NDEBUG
+#define LOG_LEVEL LOG_LEVEL_WARN
+#else
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, ...) printf("error: " fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) ((void) 0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) printf("warning: " fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) ((void) 0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) ((void) 0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) printf("debug: " fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) ((void) 0)
+#endif
+
+typedef enum{
+    LOG_DROP_NEWEST = 0, // Keep what's already queued, so lines stay intact
+    LOG_DROP_OLDEST = 1  // Keep the most recent output
+}LogOverflowPolicy;
+
+typedef struct{
+    uint32_t queuedBytes;  // Bytes accepted into the buffer
+    uint32_t droppedBytes; // Bytes lost because the buffer was full
+    uint16_t peakUsage;    // Most bytes ever waiting at once
+    uint16_t usage;
+}LogStats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Starts routing stdio output through the ring buffer. initSerialIO() must have
+// been called first. Output is written directly to the serial port (and
+// waited for) again after stopLogBuffer() or if the program crashes.
+void initLogBuffer(LogOverflowPolicy policy);
+void stopLogBuffer(void);
+
+// Sends everything in the buffer, waiting for the serial port rather than the
+// interrupt, so it also works with interrupts disabled. Anything that writes
+// to SIO1 directly (such as capture.h) must call this first.
+void flushLogBuffer(void);
+
+void getLogStats(LogStats *stats);
+void resetLogStats(void);
+
+#ifdef __cplusplus
+}
+#endif
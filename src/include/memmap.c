@@ -0,0 +1,176 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "arena.h"
+#include "cache.h"
+#include "irq.h"
+#include "log.h"
+#include "memmap.h"
+
+// The first 4 KB of kernel RAM hold the exception vector we install and the
+// BIOS's function tables, so they are never given away.
+#define KERNEL_RAM_RESERVED 0x1000
+
+#define STACK_PAINT_PATTERN 0x57ac57ac
+
+// Defined by the linker script. As with the ones in crt0.c, only their
+// addresses are meaningful.
+extern char _kernelRamStart[], _kernelRamEnd[], _ramSize[];
+extern char _textStart[], _textEnd[], _bssStart[], _bssEnd[];
+extern char _heapStart[], _heapEnd[];
+extern char _stackBottom[], _stackTop[];
+
+static const char *const _regionNames[MEM_REGION_COUNT] = {
+    "kernel",
+    "text",
+    "data",
+    "bss",
+    "heap",
+    "stack"
+};
+
+static Arena *_kernelArena = 0;
+
+static bool _isOnStack(uintptr_t address){
+    return (address > (uintptr_t) _stackBottom) && (address <= (uintptr_t) _stackTop);
+}
+
+COLD void initMemoryMap(void){
+    uintptr_t sp = (uintptr_t) __builtin_frame_address(0);
+
+    // If whatever loaded us ignored the stack pointer in the executable's
+    // header, we're running on someone else's stack and can't measure it.
+    if(!_isOnStack(sp)){
+        return;
+    }
+
+    // IRQ handlers borrow the current stack, so they can't be allowed to
+    // push anything while we're painting below it.
+    bool enabled = disableInterrupts();
+
+    for(uint32_t *ptr = (uint32_t *) _stackBottom; ptr < (uint32_t *) (sp & ~3); ptr++){
+        *ptr = STACK_PAINT_PATTERN;
+    }
+
+    restoreInterrupts(enabled);
+}
+
+static size_t _getStackUsage(void){
+    const uint32_t *ptr = (const uint32_t *) _stackBottom;
+    const uint32_t *top = (const uint32_t *) _stackTop;
+
+    while((ptr < top) && (*ptr == STACK_PAINT_PATTERN)){
+        ptr++;
+    }
+
+    return (uintptr_t) top - (uintptr_t) ptr;
+}
+
+void getMemoryRegion(MemoryRegionID id, MemoryRegion *region){
+    switch(id){
+        case MEM_REGION_KERNEL:
+            region->start = (uintptr_t) _kernelRamStart;
+            region->end   = (uintptr_t) _kernelRamEnd;
+            region->used  = _kernelArena ? (KERNEL_RAM_RESERVED + _kernelArena->peak) : (region->end - region->start);
+            break;
+
+        case MEM_REGION_TEXT:
+            region->start = (uintptr_t) _textStart;
+            region->end   = (uintptr_t) _textEnd;
+            region->used  = region->end - region->start;
+            break;
+
+        case MEM_REGION_DATA:
+            region->start = (uintptr_t) _textEnd;
+            region->end   = (uintptr_t) _bssStart;
+            region->used  = region->end - region->start;
+            break;
+
+        case MEM_REGION_BSS:
+            region->start = (uintptr_t) _bssStart;
+            region->end   = (uintptr_t) _bssEnd;
+            region->used  = region->end - region->start;
+            break;
+
+        case MEM_REGION_HEAP:
+            region->start = (uintptr_t) _heapStart;
+            region->end   = (uintptr_t) _heapEnd;
+            region->used  = (uintptr_t) sbrk(0) - region->start;
+            break;
+
+        case MEM_REGION_STACK:
+            region->start = (uintptr_t) _stackBottom;
+            region->end   = (uintptr_t) _stackTop;
+            region->used  = _isOnStack((uintptr_t) __builtin_frame_address(0)) ? _getStackUsage() : 0;
+            break;
+
+        default:
+            region->start = 0;
+            region->end   = 0;
+            region->used  = 0;
+            break;
+    }
+}
+
+const char *getMemoryRegionName(MemoryRegionID id){
+    return (id < MEM_REGION_COUNT) ? _regionNames[id] : "?";
+}
+
+COLD bool reclaimKernelRam(Arena *arena){
+#ifdef RECLAIM_KERNEL_RAM
+    uint8_t *start = (uint8_t *) _kernelRamStart + KERNEL_RAM_RESERVED;
+
+    initArena(arena, start, (uint8_t *) _kernelRamEnd - start);
+    _kernelArena = arena;
+    return true;
+#else
+    return false;
+#endif
+}
+
+COLD void printMemoryMap(void){
+    size_t ramSize   = (size_t) _ramSize;
+    size_t freeBytes = 0;
+
+    printf("memory map: %d KB RAM\n", (int)(ramSize / 1024));
+    printf("%-6s %-8s %-8s %8s %8s\n", "region", "start", "end", "size", "used");
+
+    for(int i = 0; i < MEM_REGION_COUNT; i++){
+        MemoryRegion region;
+        getMemoryRegion((MemoryRegionID) i, &region);
+
+        size_t size = region.end - region.start;
+
+        printf("%-6s %08x %08x %8d %8d\n",
+            getMemoryRegionName((MemoryRegionID) i), region.start, region.end, (int)size, (int)region.used
+        );
+
+        if(size > region.used){
+            freeBytes += size - region.used;
+        }
+    }
+
+    if(!_isOnStack((uintptr_t) __builtin_frame_address(0))){
+        LOG_WARN("not running on the configured stack\n");
+    }
+    printf("%d bytes free (%d%%)\n", (int)freeBytes, (int)((uint64_t)freeBytes * 100 / ramSize));
+}
@@ -0,0 +1,65 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+// The layout of RAM is decided by the linker script, based on the PSX_* options
+// in CMakeLists.txt. These are the regions it ends up divided into, in address
+// order when the stack is at the top of RAM (the default).
+typedef enum{
+    MEM_REGION_KERNEL, // Left to the BIOS unless reclaimed
+    MEM_REGION_TEXT,   // Code and read-only data
+    MEM_REGION_DATA,   // Initialized variables and constructor tables
+    MEM_REGION_BSS,
+    MEM_REGION_HEAP,
+    MEM_REGION_STACK,
+    MEM_REGION_COUNT
+}MemoryRegionID;
+
+typedef struct{
+    uintptr_t start, end;
+    size_t used; // For the stack this is the deepest it has been so far
+}MemoryRegion;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fills the unused part of the stack with a known pattern, so its high water
+// mark can be measured later. Call it as early as possible in main().
+void initMemoryMap(void);
+
+void getMemoryRegion(MemoryRegionID id, MemoryRegion *region);
+const char *getMemoryRegionName(MemoryRegionID id);
+
+// Hands the part of kernel RAM the BIOS uses for its own variables over to an
+// arena. This is only safe once installExceptionHandler() has been called and
+// the BIOS won't be called again, and only available when the executable is
+// built with PSX_RECLAIM_KERNEL_RAM. Returns false otherwise.
+bool reclaimKernelRam(Arena *arena);
+
+// Prints the start, end, size and usage of each region.
+void printMemoryMap(void);
+
+#ifdef __cplusplus
+}
+#endif
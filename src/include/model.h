@@ -0,0 +1,40 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ps1/cop0gte.h"
+
+typedef struct{
+    uint16_t u, v;
+}UV;
+
+typedef struct{
+    uint16_t vertices[3];
+    UV UVs[3];
+} Tri_Textured;
+
+// Points at a model's vertex and face arrays, so the renderer doesn't need to
+// know how big they are (each model header declares its own fixed-size struct).
+typedef struct{
+    size_t faceCount;
+    const GTEVector16 *verts;
+    const Tri_Textured *faces;
+    const GTEVector16 *normals; // One per face, only needed for lighting (can be null)
+}Model;
@@ -0,0 +1,232 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Header-only GP0 packet builders.
+ *
+ * Each primitive type lays out one GP0 command exactly the way the GPU reads
+ * it, so its size is known at compile time and always matches the number of
+ * words allocated for it. emplace<T>() allocates a packet of that size on a
+ * chain and returns it as a T, e.g.
+ *
+ *    auto *tri = packet::emplace<packet::TexturedTriangle<>>(chain, zIndex);
+ *    tri->setColor(gp0_rgb(128, 128, 128));
+ *    tri->xy0 = gte_getSXY0();
+ *    tri->uv0 = gp0_uv(u, v, clut);
+ *    ...
+ *
+ * Command words are constants (the gp0_*() functions in ps1/gpucmd.h are
+ * constexpr in C++), so setting one costs nothing more than the OR with the
+ * colour. Everything compiles down to the same stores as filling in the packet
+ * by hand.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "gpu.h"
+#include "ps1/gpucmd.h"
+
+namespace packet {
+
+/* Polygons */
+
+// The command byte shares its word with the colour (or the first vertex's
+// colour for Gouraud shaded primitives), which setColor() fills in.
+template<bool BLEND = false> struct FlatTriangle {
+	static constexpr uint32_t COMMAND = gp0_shadedTriangle(false, false, BLEND);
+
+	uint32_t color;
+	uint32_t xy0, xy1, xy2;
+
+	inline void setColor(uint32_t value) {
+		color = value | COMMAND;
+	}
+};
+
+template<bool BLEND = false> struct GouraudTriangle {
+	static constexpr uint32_t COMMAND = gp0_shadedTriangle(true, false, BLEND);
+
+	uint32_t color0, xy0;
+	uint32_t color1, xy1;
+	uint32_t color2, xy2;
+
+	inline void setColor(uint32_t value0, uint32_t value1, uint32_t value2) {
+		color0 = value0 | COMMAND;
+		color1 = value1;
+		color2 = value2;
+	}
+};
+
+// The first UV word also holds the CLUT and the second one the texture page.
+// RAW skips modulating the texture by the colour.
+template<bool BLEND = false, bool RAW = false> struct TexturedTriangle {
+	static constexpr uint32_t COMMAND = RAW
+		? gp0_triangle(true, BLEND)
+		: gp0_shadedTriangle(false, true, BLEND);
+
+	uint32_t color;
+	uint32_t xy0, uv0;
+	uint32_t xy1, uv1;
+	uint32_t xy2, uv2;
+
+	inline void setColor(uint32_t value) {
+		color = value | COMMAND;
+	}
+};
+
+// Quads are drawn as the triangles (0, 1, 2) and (1, 2, 3), so the last two
+// vertices go the opposite way round to the first two.
+template<bool BLEND = false> struct FlatQuad {
+	static constexpr uint32_t COMMAND = gp0_shadedQuad(false, false, BLEND);
+
+	uint32_t color;
+	uint32_t xy0, xy1, xy2, xy3;
+
+	inline void setColor(uint32_t value) {
+		color = value | COMMAND;
+	}
+};
+
+template<bool BLEND = false> struct GouraudQuad {
+	static constexpr uint32_t COMMAND = gp0_shadedQuad(true, false, BLEND);
+
+	uint32_t color0, xy0;
+	uint32_t color1, xy1;
+	uint32_t color2, xy2;
+	uint32_t color3, xy3;
+
+	inline void setColor(
+		uint32_t value0, uint32_t value1, uint32_t value2, uint32_t value3
+	) {
+		color0 = value0 | COMMAND;
+		color1 = value1;
+		color2 = value2;
+		color3 = value3;
+	}
+};
+
+template<bool BLEND = false, bool RAW = false> struct TexturedQuad {
+	static constexpr uint32_t COMMAND = RAW
+		? gp0_quad(true, BLEND)
+		: gp0_shadedQuad(false, true, BLEND);
+
+	uint32_t color;
+	uint32_t xy0, uv0;
+	uint32_t xy1, uv1;
+	uint32_t xy2, uv2;
+	uint32_t xy3, uv3;
+
+	inline void setColor(uint32_t value) {
+		color = value | COMMAND;
+	}
+};
+
+/* Rectangles */
+
+// A solid rectangle of any size. wh is the size, packed with gp0_xy().
+template<bool BLEND = false> struct Rectangle {
+	static constexpr uint32_t COMMAND = gp0_rectangle(false, false, BLEND);
+
+	uint32_t color;
+	uint32_t xy, wh;
+
+	inline void setColor(uint32_t value) {
+		color = value | COMMAND;
+	}
+};
+
+// A textured rectangle, drawn using the current texture page (see Texpage).
+// The UV word also holds the CLUT.
+template<bool BLEND = false, bool RAW = false> struct Sprite {
+	static constexpr uint32_t COMMAND = gp0_rectangle(true, RAW, BLEND);
+
+	uint32_t color;
+	uint32_t xy, uv, wh;
+
+	inline void setColor(uint32_t value) {
+		color = value | COMMAND;
+	}
+};
+
+// Fills an area of VRAM, ignoring the drawing area and offset. The position
+// is rounded down and the width up to a multiple of 16 pixels.
+struct Fill {
+	static constexpr uint32_t COMMAND = gp0_vramFill();
+
+	uint32_t color;
+	uint32_t xy, wh;
+
+	inline void setColor(uint32_t value) {
+		color = value | COMMAND;
+	}
+};
+
+/* Attributes */
+
+// Selects the texture page used by sprites and untextured primitives, and sets
+// the dithering and drawing to the displayed area flags. Textured polygons
+// carry their own page instead.
+struct Texpage {
+	static constexpr uint32_t COMMAND = gp0_texpage(0, false, false);
+
+	uint32_t attr;
+
+	inline void set(uint16_t page, bool dither, bool unlockFB) {
+		attr = gp0_texpage(page, dither, unlockFB);
+	}
+};
+
+// Sets up drawing to an area of VRAM: the texture page and dithering as with
+// Texpage, followed by the drawing area's corners (both inclusive) and the
+// offset added to every vertex, which is the area's top left corner.
+struct DrawingEnvironment {
+	static constexpr uint32_t COMMAND = gp0_texpage(0, false, false);
+
+	uint32_t attr;
+	uint32_t topLeft, bottomRight, origin;
+
+	inline void setTexpage(uint16_t page, bool dither, bool unlockFB) {
+		attr = gp0_texpage(page, dither, unlockFB);
+	}
+	inline void setArea(int left, int top, int right, int bottom) {
+		topLeft     = gp0_fbOffset1(left, top);
+		bottomRight = gp0_fbOffset2(right, bottom);
+		origin      = gp0_fbOrigin(left, top);
+	}
+};
+
+/* Allocation */
+
+// Size of a packet type, in words, not counting the tag.
+template<typename T> static constexpr int WORDS = sizeof(T) / 4;
+
+// Allocates a packet for the primitive on the chain (see allocatePacket()) and
+// writes the command into its first word, so a packet that is never given a
+// colour still draws in black rather than being misread. Setting the colour
+// straight afterwards replaces that store rather than adding to it.
+template<typename T> static inline T *emplace(DMAChain *chain, int zIndex) {
+	static_assert((sizeof(T) % 4) == 0, "packet types must be made of whole words");
+	static_assert(WORDS<T> <= 0xff, "packets can't be longer than 255 words");
+
+	T *packet = reinterpret_cast<T *>(allocatePacket(chain, zIndex, WORDS<T>));
+
+	*reinterpret_cast<uint32_t *>(packet) = T::COMMAND;
+	return packet;
+}
+
+}
@@ -0,0 +1,79 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pool.h"
+#include "log.h"
+
+void initPool(Pool *pool, void *buffer, size_t objectSize, int capacity){
+    // Each free slot has to be able to hold the pointer to the next one.
+    assert(objectSize >= sizeof(void *));
+    assert(capacity <= UINT16_MAX);
+
+    pool->base       = (uint8_t *) buffer;
+    pool->objectSize = objectSize;
+    pool->capacity   = capacity;
+    pool->used       = 0;
+    pool->peak       = 0;
+    pool->overflows  = 0;
+
+    // Link all the slots together, in order, so the first allocations are
+    // next to each other in memory.
+    pool->freeList = 0;
+
+    for(int i = capacity - 1; i >= 0; i--){
+        void **slot = (void **) &pool->base[i * objectSize];
+
+        *slot          = pool->freeList;
+        pool->freeList = slot;
+    }
+}
+
+void *poolAlloc(Pool *pool){
+    void **slot = (void **) pool->freeList;
+
+    if(!slot){
+        if(!(pool->overflows++)){
+            LOG_WARN("pool overflow (%d objects)\n", (int) pool->capacity);
+        }
+        return 0;
+    }
+
+    pool->freeList = *slot;
+    pool->used++;
+    if(pool->used > pool->peak){
+        pool->peak = pool->used;
+    }
+
+    return slot;
+}
+
+void poolFree(Pool *pool, void *object){
+    if(!object){
+        return;
+    }
+
+    // Make sure the object actually came from this pool.
+    assert((uint8_t *) object >= pool->base);
+    assert((uint8_t *) object < &pool->base[pool->capacity * pool->objectSize]);
+    assert(!(((uint8_t *) object - pool->base) % pool->objectSize));
+
+    *((void **) object) = pool->freeList;
+    pool->freeList      = object;
+    pool->used--;
+}
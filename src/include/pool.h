@@ -0,0 +1,61 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Allocator for lots of objects of the same size (particles, entities, etc.).
+// Free slots are kept in a singly linked list threaded through the slots
+// themselves, so allocating and freeing are both a couple of loads and stores.
+typedef struct{
+    uint8_t *base;
+    void *freeList;
+    size_t objectSize;
+    uint16_t capacity;
+    uint16_t used;
+    uint16_t peak;      // Highest value used has reached since initPool()
+    uint32_t overflows; // Number of allocations attempted while full
+}Pool;
+
+// Defines a pool with its own static storage, along with typed wrappers for
+// it. For example, DEFINE_POOL(particles, Particle, 64) creates
+// particlesInit(), particlesAlloc() and particlesFree(Particle *).
+#define DEFINE_POOL(name, type, count) \
+    static type name##Storage[count]; \
+    static Pool name; \
+    static inline void name##Init(void) { \
+        initPool(&name, name##Storage, sizeof(type), (count)); \
+    } \
+    static inline type *name##Alloc(void) { \
+        return (type *) poolAlloc(&name); \
+    } \
+    static inline void name##Free(type *object) { \
+        poolFree(&name, object); \
+    }
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void initPool(Pool *pool, void *buffer, size_t objectSize, int capacity);
+void *poolAlloc(Pool *pool);
+void poolFree(Pool *pool, void *object);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,196 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "cache.h"
+#include "gpu.h"
+#include "hal.h"
+#include "irq.h"
+#include "present.h"
+#include "timer.h"
+#include "ps1/gpucmd.h"
+#include "ps1/registers.h"
+
+// A frame can be queued while up to two buffers' worth of older frames are
+// still waiting to be shown, so timestamps are kept for twice as many frames.
+#define TIMESTAMP_SLOTS (PRESENT_MAX_BUFFERS * 2)
+
+static PresentBuffer _buffers[PRESENT_MAX_BUFFERS];
+static uint32_t      _timestamps[TIMESTAMP_SLOTS];
+static int           _bufferCount;
+
+// Frames are numbered from 0 and go through each of these counters in order:
+// queued by the CPU, sent to the GPU, drawn, then shown. Frame n uses buffer
+// (n % _bufferCount). The counters only ever go up, so comparing them by
+// subtracting keeps working after they wrap.
+static volatile uint32_t _queued, _sent, _drawn, _shown;
+
+static volatile uint32_t _latency;
+static volatile bool     _latencyValid;
+
+static volatile uint32_t _vblanks, _heldFields, _cpuStalls;
+
+// Only one chain is ever being drawn, so one send time is enough.
+static volatile uint32_t _sendTime, _drawTicks;
+
+// Sends the oldest queued frame once the GPU is idle and the frame's buffer is
+// free. The buffer is still in use if it's on screen (frame _shown - 1) or if
+// it holds a drawn frame waiting to be shown, so at most _bufferCount - 2
+// frames can be drawn ahead of the one on screen. Must be called with
+// interrupts disabled.
+static void _sendNextFrame(void){
+    uint32_t frame = _sent;
+
+    if((frame == _queued) || (frame != _drawn)){
+        return;
+    }
+    if((frame - _shown) >= (uint32_t) (_bufferCount - 1)){
+        return;
+    }
+
+    _sent     = frame + 1;
+    _sendTime = getTicks();
+    finishChain(_buffers[frame % _bufferCount].chain);
+}
+
+// Raised by the GP0 IRQ command at the end of each chain, once everything
+// before it has been drawn.
+static void _gpuHandler(void){
+    hal_writeGP1(gp1_acknowledge());
+
+    if(_drawn != _sent){
+        _drawTicks += getTicks() - _sendTime;
+        _drawn++;
+    }
+    _sendNextFrame();
+}
+
+static void _vblankHandler(void){
+    _vblanks++;
+
+    // Nothing has been shown yet, so there's no frame to hold.
+    if(_shown == _drawn){
+        if(_shown){
+            _heldFields++;
+        }
+        return;
+    }
+
+    uint32_t frame     = _shown;
+    uint32_t timestamp = _timestamps[frame % (_bufferCount * 2)];
+
+    const PresentBuffer *buffer = &_buffers[frame % _bufferCount];
+
+    hal_writeGP1(gp1_fbOffset(buffer->x, buffer->y));
+
+    if(timestamp){
+        _latency      = getTicks() - timestamp;
+        _latencyValid = true;
+    }
+
+    // The buffer that was on screen is free now, which may let the next frame
+    // be sent.
+    _shown = frame + 1;
+    _sendNextFrame();
+}
+
+COLD void initPresentQueue(const PresentBuffer *buffers, int count){
+    assert((count >= 2) && (count <= PRESENT_MAX_BUFFERS));
+
+    for(int i = 0; i < count; i++){
+        assert(buffers[i].chain->bandCount <= 1);
+        assert(buffers[i].chain->overflowPolicy != CHAIN_OVERFLOW_FLUSH);
+
+        _buffers[i] = buffers[i];
+    }
+
+    _bufferCount  = count;
+    _queued       = 0;
+    _sent         = 0;
+    _drawn        = 0;
+    _shown        = 0;
+    _latencyValid = false;
+    _vblanks      = 0;
+    _heldFields   = 0;
+    _cpuStalls    = 0;
+    _drawTicks    = 0;
+
+    hal_writeGP1(gp1_acknowledge());
+    setInterruptHandler(IRQ_GPU,   &_gpuHandler);
+    setInterruptHandler(IRQ_VSYNC, &_vblankHandler);
+}
+
+const PresentBuffer *beginPresentFrame(void){
+    uint32_t frame = _queued;
+
+    // The chain can't be reset until the frame that last used it has been
+    // drawn. With three buffers this only happens once the CPU is two whole
+    // frames ahead of the GPU.
+    if((frame - _drawn) >= (uint32_t) _bufferCount){
+        _cpuStalls++;
+
+        while((frame - _drawn) >= (uint32_t) _bufferCount){
+            __asm__ volatile("");
+        }
+    }
+
+    const PresentBuffer *buffer = &_buffers[frame % _bufferCount];
+
+    resetChain(buffer->chain);
+
+    // The first packet in the nearest bucket is the last one the GPU reads, so
+    // the IRQ goes off once the whole frame has been drawn.
+    uint32_t *ptr = allocatePacket(buffer->chain, 0, 1);
+    ptr[0] = gp0_irq();
+
+    return buffer;
+}
+
+void queuePresentFrame(uint32_t timestamp){
+    bool enabled = disableInterrupts();
+
+    _timestamps[_queued % (_bufferCount * 2)] = timestamp;
+    _queued++;
+    _sendNextFrame();
+
+    restoreInterrupts(enabled);
+}
+
+bool getPresentLatency(uint32_t *ticks){
+    bool enabled = disableInterrupts();
+    bool valid   = _latencyValid;
+
+    *ticks        = _latency;
+    _latencyValid = false;
+
+    restoreInterrupts(enabled);
+    return valid;
+}
+
+void getPresentStats(PresentStats *stats){
+    bool enabled = disableInterrupts();
+
+    stats->vblanks         = _vblanks;
+    stats->presentedFrames = _shown;
+    stats->heldFields      = _heldFields;
+    stats->cpuStalls       = _cpuStalls;
+    stats->drawnFrames     = _drawn;
+    stats->drawTicks       = _drawTicks;
+
+    restoreInterrupts(enabled);
+}
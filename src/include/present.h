@@ -0,0 +1,76 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gpu.h"
+
+#define PRESENT_MAX_BUFFERS 3
+
+// A framebuffer and the chain that draws into it. Frames go through the
+// buffers in turn.
+typedef struct{
+    DMAChain *chain;
+    int x, y; // Top left corner of the framebuffer in VRAM
+}PresentBuffer;
+
+// Counters since initPresentQueue(). Every VBlank either shows a new frame or
+// holds the one already on screen for another field; a game that can't keep
+// up with the refresh rate ends up holding every other field, i.e. running at
+// half rate.
+typedef struct{
+    uint32_t vblanks;
+    uint32_t presentedFrames;
+    uint32_t heldFields;
+    uint32_t cpuStalls; // Frames beginPresentFrame() had to wait for a free chain
+
+    // Frames the GPU has finished drawing, and the ticks it spent on them in
+    // total, from each chain being sent to its GP0(1Fh) IRQ going off.
+    uint32_t drawnFrames;
+    uint32_t drawTicks;
+}PresentStats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Takes over the VBlank and GPU interrupts and starts presenting frames queued
+// with queuePresentFrame(). From here on the chains are sent to the GPU by the
+// queue, so nothing else can use GPU DMA or wait for VSync with waitForVSync().
+// Chains can't be split into bands or use CHAIN_OVERFLOW_FLUSH.
+void initPresentQueue(const PresentBuffer *buffers, int count);
+
+// Waits until the next buffer's chain is no longer being drawn from, resets it
+// and returns the buffer. The chain already holds one packet, which tells the
+// queue when the GPU has finished drawing the frame.
+const PresentBuffer *beginPresentFrame(void);
+
+// Queues the frame started by beginPresentFrame() to be drawn as soon as the
+// GPU is free and its framebuffer is off screen, then shown at the first VBlank
+// after it's drawn. The timestamp (from getTicks()) is what the frame's latency
+// is measured from, or 0 to leave it out.
+void queuePresentFrame(uint32_t timestamp);
+
+// Returns true if a frame has been shown since the last call, along with how
+// many ticks after its timestamp it was shown.
+bool getPresentLatency(uint32_t *ticks);
+void getPresentStats(PresentStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,83 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "cache.h"
+#include "profiler.h"
+#include "timer.h"
+
+static ProfilerStat _stats[PROF_COUNTER_COUNT];
+
+static const char *const _names[PROF_COUNTER_COUNT] = {
+    "frame",
+    "input",
+    "geometry",
+    "hud",
+    "gpu wait",
+    "vsync wait",
+    "latency"
+};
+
+void resetProfiler(void){
+    for(int i = 0; i < PROF_COUNTER_COUNT; i++){
+        ProfilerStat *stat = &_stats[i];
+
+        stat->last    = 0;
+        stat->min     = UINT32_MAX;
+        stat->max     = 0;
+        stat->total   = 0;
+        stat->samples = 0;
+    }
+}
+
+HOT void profilerBegin(ProfilerCounter counter){
+    _stats[counter].start = getTicks();
+}
+
+HOT void profilerEnd(ProfilerCounter counter){
+    profilerRecord(counter, getTicks() - _stats[counter].start);
+}
+
+HOT void profilerRecord(ProfilerCounter counter, uint32_t ticks){
+    ProfilerStat *stat = &_stats[counter];
+
+    stat->last = ticks;
+    if(ticks < stat->min) stat->min = ticks;
+    if(ticks > stat->max) stat->max = ticks;
+
+    // Start over once the total gets close to overflowing, which takes a few
+    // minutes for a counter recorded every frame.
+    if((stat->total + ticks) < stat->total){
+        stat->total   = 0;
+        stat->samples = 0;
+    }
+    stat->total += ticks;
+    stat->samples++;
+}
+
+const ProfilerStat *getProfilerStat(ProfilerCounter counter){
+    return &_stats[counter];
+}
+
+const char *getProfilerName(ProfilerCounter counter){
+    return _names[counter];
+}
+
+uint32_t getProfilerAverage(ProfilerCounter counter){
+    const ProfilerStat *stat = &_stats[counter];
+
+    return stat->samples ? (stat->total / stat->samples) : 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Simple section timer based on getTicks(). Each counter keeps the last, min,
+// max and average duration of whatever was recorded into it since the last
+// call to resetProfiler().
+typedef enum {
+    PROF_FRAME      = 0, // Start of one frame to the start of the next
+    PROF_INPUT      = 1, // Reading the controller and updating the camera
+    PROF_GEOMETRY   = 2, // Transforming the model and building its packets
+    PROF_HUD        = 3, // Building the text overlay
+    PROF_GPU_WAIT   = 4, // Waiting for the GPU to finish the previous frame
+    PROF_VSYNC_WAIT = 5, // Waiting for VBlank
+    PROF_LATENCY    = 6, // Controller sample to the VBlank that displays it
+    PROF_COUNTER_COUNT
+} ProfilerCounter;
+
+typedef struct{
+    uint32_t last, min, max;
+    uint32_t total, samples;
+    uint32_t start; // Set by profilerBegin()
+}ProfilerStat;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void resetProfiler(void);
+void profilerBegin(ProfilerCounter counter);
+void profilerEnd(ProfilerCounter counter);
+void profilerRecord(ProfilerCounter counter, uint32_t ticks);
+
+const ProfilerStat *getProfilerStat(ProfilerCounter counter);
+const char *getProfilerName(ProfilerCounter counter);
+uint32_t getProfilerAverage(ProfilerCounter counter);
+
+#ifdef __cplusplus
+}
+#endif
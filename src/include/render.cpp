@@ -0,0 +1,634 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "cache.h"
+#include "gpu.h"
+#include "gte.h"
+#include "model.h"
+#include "packet.hpp"
+#include "render.h"
+#include "ps1/cop0gte.h"
+#include "ps1/gpucmd.h"
+
+// 6 select colours for rendering polys in "coloured" mode
+static const uint32_t colors[6] = {
+    0x0000FF,
+    0x00FF00,
+    0xFF0000,
+    0x00FFFF,
+    0xFF00FF,
+    0xFFFF00
+};
+
+// Vertex colours for RENDER_GOURAUD, picked by vertex index so that faces
+// sharing a vertex also share its colour.
+static const uint32_t vertexColors[8] = {
+    0x0000FF,
+    0x0080FF,
+    0x00FF00,
+    0x80FF00,
+    0xFF0000,
+    0xFF0080,
+    0xFFFF00,
+    0x00FFFF
+};
+
+static const char *const modeNames[RENDER_MODE_COUNT] = {
+    "flat",
+    "textured",
+    "gouraud",
+    "lit",
+    "fogged"
+};
+
+// Ambient light for RENDER_LIT and the distances RENDER_FOGGED fades between.
+// Models are drawn in world space, so the lights don't need to follow the
+// camera.
+#define LIGHT_AMBIENT (ONE / 4)
+#define FOG_NEAR_Z    2000
+#define FOG_FAR_Z     20000
+
+// A face that has been transformed and passed culling, waiting to be queued.
+// Only the packet for the kernel's mode is used; flat, lit and fogged faces all
+// use the flat one.
+typedef struct{
+    int zIndex;
+
+    union{
+        packet::FlatTriangle<>     flat;
+        packet::GouraudTriangle<>  gouraud;
+        packet::TexturedTriangle<> textured;
+    };
+}PendingFace;
+
+static inline void __attribute__((always_inline)) _queueFace(
+    DMAChain *chain, const PendingFace *face, RenderMode mode
+){
+    switch(mode){
+        case RENDER_TEXTURED:
+            *packet::emplace<packet::TexturedTriangle<>>(chain, face->zIndex) = face->textured;
+            break;
+
+        case RENDER_GOURAUD:
+            *packet::emplace<packet::GouraudTriangle<>>(chain, face->zIndex) = face->gouraud;
+            break;
+
+        default:
+            *packet::emplace<packet::FlatTriangle<>>(chain, face->zIndex) = face->flat;
+            break;
+    }
+}
+
+// The GTE runs alongside the CPU, which only waits for it when reading a result
+// or issuing a command before the previous one is done. RTPT takes 23 cycles and
+// NCLIP 8, so rather than taking each face from start to finish (and stalling on
+// every command), the loop is software pipelined across three faces: while face N
+// is being transformed, the CPU looks up face N+1's vertices and writes out face
+// N-1's packet, which was read out of the GTE on the previous iteration. Face N's
+// packet words are worked out while NCLIP runs.
+//
+// Packets are still allocated in face order, so the chain ends up exactly the
+// same as if each face had been queued straight away.
+//
+// The mode is always a constant, as this is only called by the kernels below.
+// Once inlined into them, everything the mode doesn't need is left out.
+static inline int __attribute__((always_inline)) _renderFaces(
+    DMAChain *chain, const Model *model, const TextureInfo *texture,
+    RenderMode mode
+){
+    // Keep track of how many polygons are being drawn.
+    int polyCount = 0;
+
+    const GTEVector16  *verts  = model->verts;
+    const GTEVector16  *normal = model->normals;
+    const Tri_Textured *tri    = model->faces;
+    const Tri_Textured *end    = &model->faces[model->faceCount];
+
+    if(tri == end){
+        return 0;
+    }
+
+    // Texture attributes don't change from face to face, so they're only looked
+    // up once.
+    unsigned int texU = 0, texV = 0;
+    uint16_t clut = 0, page = 0;
+
+    if(mode == RENDER_TEXTURED){
+        texU = texture->u;
+        texV = texture->v;
+        clut = texture->clut;
+        page = texture->page;
+    }
+
+    // Index into colors[], i.e. the face's index modulo 6.
+    int colorIndex = 0;
+
+    PendingFace pending;
+    bool hasPending = false;
+
+    // Start transforming the first face before entering the loop.
+    gte_loadV0(&verts[tri->vertices[0]]);
+    gte_loadV1(&verts[tri->vertices[1]]);
+    gte_loadV2(&verts[tri->vertices[2]]);
+    gte_command(GTE_CMD_RTPT | GTE_SF);
+
+    for(; tri < end; tri++){
+        // RTPT is busy with this face. Look up the next face's vertices...
+        const Tri_Textured *next = tri + 1;
+        const GTEVector16 *next0 = 0, *next1 = 0, *next2 = 0;
+
+        if(next < end){
+            next0 = &verts[next->vertices[0]];
+            next1 = &verts[next->vertices[1]];
+            next2 = &verts[next->vertices[2]];
+        }
+
+        // ...and queue the previous face.
+        if(hasPending){
+            _queueFace(chain, &pending, mode);
+            hasPending = false;
+        }
+
+        // Perform "Normal Clipping" on the transformed verts, which waits for
+        // RTPT to finish, and build this face's packet while it runs. The
+        // screen coordinates are filled in later.
+        gte_command(GTE_CMD_NCLIP);
+
+        PendingFace face;
+
+        switch(mode){
+            case RENDER_TEXTURED:
+                face.textured.setColor(0x808080);
+                face.textured.uv0 = gp0_uv(texU + tri->UVs[0].u, texV + tri->UVs[0].v, clut);
+                face.textured.uv1 = gp0_uv(texU + tri->UVs[1].u, texV + tri->UVs[1].v, page);
+                face.textured.uv2 = gp0_uv(texU + tri->UVs[2].u, texV + tri->UVs[2].v, 0);
+                break;
+
+            case RENDER_GOURAUD:
+                face.gouraud.setColor(
+                    vertexColors[tri->vertices[0] % 8],
+                    vertexColors[tri->vertices[1] % 8],
+                    vertexColors[tri->vertices[2] % 8]
+                );
+                break;
+
+            default:
+                // Lit and fogged faces have their colour passed through the
+                // GTE, which copies the command byte over as it is.
+                face.flat.setColor(colors[colorIndex]);
+                break;
+        }
+        if(mode != RENDER_TEXTURED && mode != RENDER_GOURAUD){
+            if(++colorIndex == 6){
+                colorIndex = 0;
+            }
+        }
+
+        // If the face is facing away from us, don't bother rendering it.
+        if(gte_getMAC0() > 0){
+            // Calculate the average Z value of all 3 verts.
+            gte_command(GTE_CMD_AVSZ3 | GTE_SF);
+            face.zIndex = gte_getOTZ();
+
+            // Clip faces that are too far from the camera, and ones whose average
+            // is behind it unless one of the corners is in view.
+            if(
+                (face.zIndex < ORDERING_TABLE_SIZE) &&
+                ((face.zIndex > 0) || (gte_getSZ0() + gte_getSZ1() + gte_getSZ2()))
+            ){
+                // Read the results out now, as the next RTPT overwrites them.
+                switch(mode){
+                    case RENDER_TEXTURED:
+                        face.textured.xy0 = gte_getSXY0();
+                        face.textured.xy1 = gte_getSXY1();
+                        face.textured.xy2 = gte_getSXY2();
+                        break;
+
+                    case RENDER_GOURAUD:
+                        face.gouraud.xy0 = gte_getSXY0();
+                        face.gouraud.xy1 = gte_getSXY1();
+                        face.gouraud.xy2 = gte_getSXY2();
+                        break;
+
+                    default:
+                        face.flat.xy0 = gte_getSXY0();
+                        face.flat.xy1 = gte_getSXY1();
+                        face.flat.xy2 = gte_getSXY2();
+                        break;
+                }
+
+                // Lighting is done with the face's normal in place of V0, which
+                // has already been transformed. Fog uses the depth cueing factor
+                // RTPT left in IR0 for the last vertex.
+                if(mode == RENDER_LIT){
+                    gte_loadV0(normal);
+                    gte_setRGBC(face.flat.color);
+                    gte_command(GTE_CMD_NCCS | GTE_SF | GTE_LM);
+                    face.flat.color = gte_getRGB2();
+                }else if(mode == RENDER_FOGGED){
+                    gte_setRGBC(face.flat.color);
+                    gte_command(GTE_CMD_DPCS | GTE_SF);
+                    face.flat.color = gte_getRGB2();
+                }
+
+                pending    = face;
+                hasPending = true;
+                polyCount++;
+            }
+        }
+        if(mode == RENDER_LIT){
+            normal++;
+        }
+
+        // Start transforming the next face.
+        if(next < end){
+            gte_loadV0(next0);
+            gte_loadV1(next1);
+            gte_loadV2(next2);
+            gte_command(GTE_CMD_RTPT | GTE_SF);
+        }
+    }
+
+    if(hasPending){
+        _queueFace(chain, &pending, mode);
+    }
+
+    return polyCount;
+}
+
+// Only the flat and textured kernels are HOT. The others only run when picked
+// from the menu, and all five together would take up much of the instruction
+// cache budget.
+#define RENDER_KERNEL(name, mode, attribute) \
+    static attribute int name(DMAChain *chain, const Model *model, const TextureInfo *texture){ \
+        return _renderFaces(chain, model, texture, mode); \
+    }
+
+RENDER_KERNEL(_renderFlat,     RENDER_FLAT,     HOT)
+RENDER_KERNEL(_renderTextured, RENDER_TEXTURED, HOT)
+RENDER_KERNEL(_renderGouraud,  RENDER_GOURAUD,  )
+RENDER_KERNEL(_renderLit,      RENDER_LIT,      )
+RENDER_KERNEL(_renderFogged,   RENDER_FOGGED,   )
+
+#undef RENDER_KERNEL
+
+static const RenderKernel kernels[RENDER_MODE_COUNT] = {
+    &_renderFlat,
+    &_renderTextured,
+    &_renderGouraud,
+    &_renderLit,
+    &_renderFogged
+};
+
+RenderKernel getRenderKernel(RenderMode mode){
+    return kernels[mode];
+}
+
+const char *getRenderModeName(RenderMode mode){
+    return modeNames[mode];
+}
+
+void queueFrameSetup(
+    DMAChain *chain, int x, int y, int width, int height, uint32_t clearColor
+){
+    // Packets in the same bucket run in the opposite order to the one they are
+    // queued in, so the fill goes first.
+    auto *fill = packet::emplace<packet::Fill>(chain, ORDERING_TABLE_SIZE - 1);
+    fill->setColor(clearColor);
+    fill->xy = gp0_xy(x, y);
+    fill->wh = gp0_xy(width, height);
+
+    auto *env = packet::emplace<packet::DrawingEnvironment>(chain, ORDERING_TABLE_SIZE - 1);
+    env->setTexpage(0, true, false);
+    env->setArea(x, y, x + width - 1, y + height - 2);
+}
+
+int renderModel(DMAChain *chain, const Model *model, const TextureInfo *texture){
+    if(texture){
+        return _renderTextured(chain, model, texture);
+    }else{
+        return _renderFlat(chain, model, texture);
+    }
+}
+
+COLD void setupRenderLighting(void){
+    // One white light shining down and slightly forwards, and a dimmer blue one
+    // from the side. Each row of the light matrix is the direction a light comes
+    // from, and each column of the colour matrix is that light's colour.
+    gte_setLightMatrix(
+          0, -ONE * 3 / 4, -ONE / 2,
+        ONE * 3 / 4,    0,        0,
+          0,            0,        0
+    );
+    gte_setLightColorMatrix(
+        ONE, ONE / 4, 0,
+        ONE, ONE / 4, 0,
+        ONE, ONE / 2, 0
+    );
+    gte_setBackgroundColor(LIGHT_AMBIENT, LIGHT_AMBIENT, LIGHT_AMBIENT);
+
+    // Fade to the same grey the screen is cleared to. The far colour has 4
+    // fractional bits.
+    gte_setFarColor(64 << 4, 64 << 4, 64 << 4);
+    setDepthCueRange(FOG_NEAR_Z, FOG_FAR_Z);
+}
+
+// Integer square root, one bit at a time. Rounds down.
+static uint32_t _squareRoot(uint32_t square){
+    uint32_t root = 0;
+
+    for(uint32_t bit = 1u << 30; bit; bit >>= 2){
+        if(square >= (root + bit)){
+            square -= root + bit;
+            root    = (root >> 1) + bit;
+        }else{
+            root >>= 1;
+        }
+    }
+
+    return root;
+}
+
+// Shifts the vector down until each component fits in 15 bits, then scales it
+// to be ONE unit long.
+static void _normalize(int32_t x, int32_t y, int32_t z, GTEVector16 *output){
+    while(
+        (x > 0x7fff) || (x < -0x7fff) ||
+        (y > 0x7fff) || (y < -0x7fff) ||
+        (z > 0x7fff) || (z < -0x7fff)
+    ){
+        x >>= 1;
+        y >>= 1;
+        z >>= 1;
+    }
+
+    uint32_t length = _squareRoot(
+        (uint32_t) (x * x) + (uint32_t) (y * y) + (uint32_t) (z * z)
+    );
+
+    if(!length){
+        output->x = 0;
+        output->y = 0;
+        output->z = 0;
+        return;
+    }
+
+    output->x = (x * ONE) / (int32_t) length;
+    output->y = (y * ONE) / (int32_t) length;
+    output->z = (z * ONE) / (int32_t) length;
+}
+
+COLD void computeFaceNormals(const Model *model, GTEVector16 *output){
+    for(size_t i = 0; i < model->faceCount; i++){
+        const Tri_Textured *tri = &model->faces[i];
+        const GTEVector16  *v0  = &model->verts[tri->vertices[0]];
+        const GTEVector16  *v1  = &model->verts[tri->vertices[1]];
+        const GTEVector16  *v2  = &model->verts[tri->vertices[2]];
+
+        // NCLIP treats clockwise faces as facing the camera, so the normal
+        // pointing out of the front is (v2 - v0) x (v1 - v0).
+        int32_t ax = v2->x - v0->x, ay = v2->y - v0->y, az = v2->z - v0->z;
+        int32_t bx = v1->x - v0->x, by = v1->y - v0->y, bz = v1->z - v0->z;
+
+        _normalize(
+            (ay * bz) - (az * by),
+            (az * bx) - (ax * bz),
+            (ax * by) - (ay * bx),
+            &output[i]
+        );
+    }
+}
+
+// Returns which grid cell the middle of the face lies in. The bounds are those
+// of every face's vertex sum, i.e. three times its middle.
+static int _getFaceCell(
+    const Model *model, const Tri_Textured *tri, int gridSize,
+    int minX, int minZ, int width, int depth
+){
+    const GTEVector16 *v0 = &model->verts[tri->vertices[0]];
+    const GTEVector16 *v1 = &model->verts[tri->vertices[1]];
+    const GTEVector16 *v2 = &model->verts[tri->vertices[2]];
+
+    int x = ((v0->x + v1->x + v2->x - minX) * gridSize) / width;
+    int z = ((v0->z + v1->z + v2->z - minZ) * gridSize) / depth;
+
+    return (z * gridSize) + x;
+}
+
+COLD int buildModelClusters(
+    const Model *model, int gridSize, ModelCluster *clusters,
+    Tri_Textured *faces, GTEVector16 *normals
+){
+    assert((gridSize > 0) && ((gridSize * gridSize) <= RENDER_MAX_CLUSTERS));
+
+    if(!model->faceCount){
+        return 0;
+    }
+
+    // Find the area the faces' middles are spread over.
+    int minX = 0x7fffffff, maxX = -0x7fffffff;
+    int minZ = 0x7fffffff, maxZ = -0x7fffffff;
+
+    for(size_t i = 0; i < model->faceCount; i++){
+        const Tri_Textured *tri = &model->faces[i];
+        int x = 0, z = 0;
+
+        for(int j = 0; j < 3; j++){
+            x += model->verts[tri->vertices[j]].x;
+            z += model->verts[tri->vertices[j]].z;
+        }
+
+        if(x < minX) minX = x;
+        if(x > maxX) maxX = x;
+        if(z < minZ) minZ = z;
+        if(z > maxZ) maxZ = z;
+    }
+
+    int width = maxX - minX + 1;
+    int depth = maxZ - minZ + 1;
+
+    // Count the faces in each cell, then copy them out grouped by cell.
+    int cellStarts[RENDER_MAX_CLUSTERS + 1] = { 0 };
+    int cellEnds[RENDER_MAX_CLUSTERS];
+    int cellCount = gridSize * gridSize;
+
+    for(size_t i = 0; i < model->faceCount; i++){
+        int cell = _getFaceCell(
+            model, &model->faces[i], gridSize, minX, minZ, width, depth
+        );
+        cellStarts[cell + 1]++;
+    }
+    for(int i = 0; i < cellCount; i++){
+        cellStarts[i + 1] += cellStarts[i];
+        cellEnds[i]        = cellStarts[i];
+    }
+
+    for(size_t i = 0; i < model->faceCount; i++){
+        int cell = _getFaceCell(
+            model, &model->faces[i], gridSize, minX, minZ, width, depth
+        );
+        int index = cellEnds[cell]++;
+
+        faces[index] = model->faces[i];
+        if(model->normals){
+            normals[index] = model->normals[i];
+        }
+    }
+
+    // Fit a sphere around each cluster's vertices, skipping empty cells.
+    int clusterCount = 0;
+
+    for(int i = 0; i < cellCount; i++){
+        int start = cellStarts[i];
+        int count = cellStarts[i + 1] - start;
+
+        if(!count){
+            continue;
+        }
+
+        ModelCluster *cluster = &clusters[clusterCount++];
+
+        cluster->model.faceCount = count;
+        cluster->model.verts     = model->verts;
+        cluster->model.faces     = &faces[start];
+        cluster->model.normals   = model->normals ? &normals[start] : 0;
+
+        int lower[3] = {  0x7fff,  0x7fff,  0x7fff };
+        int upper[3] = { -0x8000, -0x8000, -0x8000 };
+
+        for(int j = 0; j < count; j++){
+            for(int k = 0; k < 3; k++){
+                const GTEVector16 *v = &model->verts[faces[start + j].vertices[k]];
+
+                if(v->x < lower[0]) lower[0] = v->x;
+                if(v->x > upper[0]) upper[0] = v->x;
+                if(v->y < lower[1]) lower[1] = v->y;
+                if(v->y > upper[1]) upper[1] = v->y;
+                if(v->z < lower[2]) lower[2] = v->z;
+                if(v->z > upper[2]) upper[2] = v->z;
+            }
+        }
+
+        cluster->center.x = (lower[0] + upper[0]) / 2;
+        cluster->center.y = (lower[1] + upper[1]) / 2;
+        cluster->center.z = (lower[2] + upper[2]) / 2;
+
+        uint32_t radiusSquared = 0;
+
+        for(int j = 0; j < count; j++){
+            for(int k = 0; k < 3; k++){
+                const GTEVector16 *v = &model->verts[faces[start + j].vertices[k]];
+
+                int dx = v->x - cluster->center.x;
+                int dy = v->y - cluster->center.y;
+                int dz = v->z - cluster->center.z;
+
+                uint32_t distance = (uint32_t) (dx * dx) + (uint32_t) (dy * dy) + (uint32_t) (dz * dz);
+
+                if(distance > radiusSquared){
+                    radiusSquared = distance;
+                }
+            }
+        }
+
+        // Round up, then leave some room for the rotation matrix not being
+        // exactly orthonormal and for the GTE's rounding.
+        int radius = _squareRoot(radiusSquared) + 1;
+
+        cluster->radius = radius + (radius >> 6) + 2;
+    }
+
+    return clusterCount;
+}
+
+// The scale setupGTE() gives AVSZ3, so this returns the Z index the kernels
+// work out for a face with all of its vertices at the given depth. Like SZ, the
+// depth is saturated to 16 bits.
+#define Z_SCALE_FACTOR ((ONE * ORDERING_TABLE_SIZE) / 0x7fff)
+
+static inline int _getZIndex(int z){
+    if(z > 0xffff){
+        z = 0xffff;
+    }
+
+    return (Z_SCALE_FACTOR * 3 * z) >> 12;
+}
+
+typedef struct{
+    int zIndex; // Farthest Z index any of the cluster's faces can have
+    const ModelCluster *cluster;
+}ClusterDepth;
+
+int renderClusters(
+    DMAChain *chain, RenderKernel kernel, const ModelCluster *clusters,
+    int clusterCount, const TextureInfo *texture
+){
+    ClusterDepth order[RENDER_MAX_CLUSTERS];
+    int count = 0;
+
+    assert(clusterCount <= RENDER_MAX_CLUSTERS);
+
+    for(int i = 0; i < clusterCount; i++){
+        const ModelCluster *cluster = &clusters[i];
+
+        // Only the depth of the sphere's centre is needed, which MVMVA works
+        // out without the perspective division RTPS would do.
+        gte_loadV0(&cluster->center);
+        gte_command(GTE_CMD_MVMVA | GTE_SF | GTE_MX_RT | GTE_V_V0 | GTE_CV_TR);
+
+        int z     = gte_getMAC3();
+        int nearZ = z - cluster->radius;
+        int farZ  = z + cluster->radius;
+
+        // The kernels would cull every face of a cluster that's entirely behind
+        // the camera or past the far end of the ordering table.
+        if((farZ <= 0) || (_getZIndex(nearZ) >= ORDERING_TABLE_SIZE)){
+            continue;
+        }
+
+        int zIndex = _getZIndex(farZ);
+
+        if(zIndex >= ORDERING_TABLE_SIZE){
+            zIndex = ORDERING_TABLE_SIZE - 1;
+        }
+
+        // Insertion sort, farthest first. Clusters at the same depth stay in
+        // the order they were given in.
+        int j = count++;
+
+        for(; (j > 0) && (order[j - 1].zIndex < zIndex); j--){
+            order[j] = order[j - 1];
+        }
+        order[j].zIndex  = zIndex;
+        order[j].cluster = cluster;
+    }
+
+    int polyCount = 0;
+
+    for(int i = 0; i < count; i++){
+        polyCount += kernel(chain, &order[i].cluster->model, texture);
+
+        // Nothing else will be queued any farther back than the next cluster
+        // can reach.
+        submitChainBands(chain, ((i + 1) < count) ? order[i + 1].zIndex : 0);
+    }
+
+    return polyCount;
+}
@@ -0,0 +1,106 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+#include <stdint.h>
+#include "gpu.h"
+#include "model.h"
+
+// Each mode has its own copy of the face loop (a "kernel"), containing only the
+// GTE commands and packet words that mode needs.
+typedef enum {
+    RENDER_FLAT     = 0, // One colour per face, from a fixed palette
+    RENDER_TEXTURED = 1, // Textured with the given texture, unlit
+    RENDER_GOURAUD  = 2, // One palette colour per vertex, blended across the face
+    RENDER_LIT      = 3, // Face colours lit using the model's face normals
+    RENDER_FOGGED   = 4, // Face colours faded towards the far colour with distance
+    RENDER_MODE_COUNT
+} RenderMode;
+
+// Transforms every face of the model using the GTE's current rotation and
+// translation, culls the ones facing away from the camera or outside the
+// ordering table, and queues the rest on the chain. The texture is only used by
+// RENDER_TEXTURED.
+// Returns how many polygons were queued.
+typedef int (*RenderKernel)(DMAChain *chain, const Model *model, const TextureInfo *texture);
+
+// Most clusters buildModelClusters() can split a model into.
+#define RENDER_MAX_CLUSTERS 64
+
+// A group of neighbouring faces, along with a sphere containing all of their
+// vertices. This is enough to tell roughly how far away the whole group is
+// without transforming any of it.
+typedef struct{
+    Model model; // The cluster's faces, sharing the vertices of the model they came from
+    GTEVector16 center;
+    int radius;
+}ModelCluster;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns the kernel for the given mode, meant to be looked up once per frame
+// rather than checking the mode for every face.
+RenderKernel getRenderKernel(RenderMode mode);
+const char *getRenderModeName(RenderMode mode);
+
+// Queues what every frame starts with at the far end of the chain's ordering
+// table, so it runs before anything else: setting the drawing area and offset
+// to the width by height buffer at (x, y), then filling the buffer with the
+// given colour. The drawing area leaves out the buffer's last line, which is
+// only ever cleared.
+void queueFrameSetup(
+    DMAChain *chain, int x, int y, int width, int height, uint32_t clearColor
+);
+
+// Draws the model textured with the given texture, or in flat colours if it's
+// null.
+int renderModel(DMAChain *chain, const Model *model, const TextureInfo *texture);
+
+// Splits the model's faces into clusters by where they lie on a grid of
+// gridSize by gridSize cells, across the X/Z plane. The faces (and normals, if
+// the model has any) are copied into the given arrays in cluster order, which
+// must each have room for all of the model's.
+// Returns how many clusters there are, at most RENDER_MAX_CLUSTERS.
+int buildModelClusters(
+    const Model *model, int gridSize, ModelCluster *clusters,
+    Tri_Textured *faces, GTEVector16 *normals
+);
+
+// Draws the clusters with the given kernel, from the farthest to the nearest,
+// handing each band of the chain's ordering table over to the GPU as soon as no
+// cluster left to draw can reach into it (see submitChainBands()). Clusters
+// entirely behind the camera or past the far end of the ordering table are
+// skipped. Only the nearest band is left open afterwards.
+// Returns how many polygons were queued.
+int renderClusters(
+    DMAChain *chain, RenderKernel kernel, const ModelCluster *clusters,
+    int clusterCount, const TextureInfo *texture
+);
+
+// Sets up the GTE's light matrices and depth cueing for RENDER_LIT and
+// RENDER_FOGGED. Must be called after setupGTE().
+void setupRenderLighting(void);
+
+// Fills in one normal per face, each ONE unit long, for RENDER_LIT. Faces are
+// assumed to be wound the way NCLIP expects front faces to be.
+void computeFaceNormals(const Model *model, GTEVector16 *output);
+
+#ifdef __cplusplus
+}
+#endif
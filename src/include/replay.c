@@ -0,0 +1,143 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cache.h"
+#include "camera.h"
+#include "capture.h"
+#include "controller.h"
+#include "replay.h"
+
+void initInputRecorder(InputRecorder *recorder, InputTick *buffer, size_t capacity){
+    recorder->mode     = INPUT_MODE_LIVE;
+    recorder->ticks    = 0;
+    recorder->position = 0;
+    recorder->buffer   = buffer;
+    recorder->capacity = buffer ? capacity : 0;
+
+    recorder->header.magic     = INPUT_RECORDING_MAGIC;
+    recorder->header.version   = INPUT_RECORDING_VERSION;
+    recorder->header.tickSize  = sizeof(InputTick);
+    recorder->header.tickCount = 0;
+}
+
+void startInputRecording(InputRecorder *recorder, const Camera *camera, uint32_t flags){
+    if(!recorder->capacity){
+        return;
+    }
+
+    recorder->mode  = INPUT_MODE_RECORDING;
+    recorder->ticks = recorder->buffer;
+
+    recorder->header.magic     = INPUT_RECORDING_MAGIC;
+    recorder->header.version   = INPUT_RECORDING_VERSION;
+    recorder->header.tickSize  = sizeof(InputTick);
+    recorder->header.tickCount = 0;
+    recorder->header.flags     = flags;
+    recorder->header.camera    = *camera;
+}
+
+void stopInputRecording(InputRecorder *recorder){
+    if(recorder->mode == INPUT_MODE_RECORDING){
+        recorder->mode = INPUT_MODE_LIVE;
+    }
+}
+
+bool startInputReplay(
+    InputRecorder *recorder, const void *recording, Camera *camera, uint32_t *flags
+){
+    if(recording){
+        const InputRecordingHeader *header = (const InputRecordingHeader *) recording;
+
+        // Recordings made by a build with a different Camera or ControllerInfo
+        // layout can't be replayed.
+        if(
+            (header->magic != INPUT_RECORDING_MAGIC) ||
+            (header->version != INPUT_RECORDING_VERSION) ||
+            (header->tickSize != sizeof(InputTick))
+        ){
+            return false;
+        }
+
+        recorder->header = *header;
+        recorder->ticks  = (const InputTick *) &header[1];
+    }
+
+    if(!recorder->ticks || !recorder->header.tickCount){
+        return false;
+    }
+
+    recorder->mode     = INPUT_MODE_REPLAYING;
+    recorder->position = 0;
+
+    *camera = recorder->header.camera;
+    if(flags){
+        *flags = recorder->header.flags;
+    }
+
+    return true;
+}
+
+bool recordInputTick(InputRecorder *recorder, const ControllerInfo *pad, bool connected){
+    if(recorder->mode != INPUT_MODE_RECORDING){
+        return false;
+    }
+    if(recorder->header.tickCount >= recorder->capacity){
+        recorder->mode = INPUT_MODE_LIVE;
+        return false;
+    }
+
+    InputTick *tick = &recorder->buffer[recorder->header.tickCount++];
+
+    tick->pad       = *pad;
+    tick->connected = connected;
+    return true;
+}
+
+bool replayInputTick(InputRecorder *recorder, ControllerInfo *pad, bool *connected){
+    if(recorder->mode != INPUT_MODE_REPLAYING){
+        return false;
+    }
+    if(recorder->position >= recorder->header.tickCount){
+        recorder->mode = INPUT_MODE_LIVE;
+        return false;
+    }
+
+    const InputTick *tick = &recorder->ticks[recorder->position++];
+
+    *pad       = tick->pad;
+    *connected = tick->connected;
+    return true;
+}
+
+COLD void sendInputRecording(const InputRecorder *recorder){
+    const InputRecordingHeader *header = &recorder->header;
+
+    if(!recorder->ticks){
+        return;
+    }
+
+    uint32_t crc = 0;
+
+    sendCaptureBlock(CAPTURE_BLOCK_INPUT_BEGIN, header, sizeof(InputRecordingHeader));
+    crc = sendCaptureBuffer(
+        CAPTURE_BLOCK_INPUT, recorder->ticks, header->tickCount * sizeof(InputTick), crc
+    );
+    sendCaptureBlock(CAPTURE_BLOCK_END, &crc, 4);
+}
@@ -0,0 +1,100 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "camera.h"
+#include "controller.h"
+
+// Serial commands for starting/stopping a recording (which is sent back once
+// stopped) and replaying the last one.
+#define INPUT_RECORD_SERIAL_COMMAND 'R'
+#define INPUT_REPLAY_SERIAL_COMMAND 'P'
+
+#define INPUT_RECORDING_MAGIC   0x54504e49 // "INPT"
+#define INPUT_RECORDING_VERSION 1
+
+// The controller state used by one simulation step.
+typedef struct{
+    ControllerInfo pad;
+    uint16_t connected;
+}InputTick;
+
+// A recording is this header followed by tickCount InputTicks. It is sent
+// over serial in this form, and can be embedded into an executable as is.
+typedef struct{
+    uint32_t magic;
+    uint16_t version, tickSize;
+    uint32_t tickCount;
+    uint32_t flags;  // Whatever else the application needs restored, e.g. render settings
+    Camera   camera; // Camera state when the recording was started
+}InputRecordingHeader;
+
+typedef enum{
+    INPUT_MODE_LIVE      = 0,
+    INPUT_MODE_RECORDING = 1,
+    INPUT_MODE_REPLAYING = 2
+}InputMode;
+
+typedef struct{
+    InputMode mode;
+
+    // The recording made last, or the one being replayed.
+    InputRecordingHeader header;
+    const InputTick *ticks;
+    uint32_t position;
+
+    InputTick *buffer;
+    size_t capacity;
+}InputRecorder;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The buffer holds up to capacity ticks. It can be null if only embedded
+// recordings are going to be replayed.
+void initInputRecorder(InputRecorder *recorder, InputTick *buffer, size_t capacity);
+
+void startInputRecording(InputRecorder *recorder, const Camera *camera, uint32_t flags);
+void stopInputRecording(InputRecorder *recorder);
+
+// Replays the given recording, or the last one made if null. The camera and
+// flags are set to what they were when it was recorded. Returns false if the
+// recording is invalid or empty.
+bool startInputReplay(
+    InputRecorder *recorder, const void *recording, Camera *camera, uint32_t *flags
+);
+
+// Called once per simulation step while recording. Recording stops on its own
+// once the buffer is full, in which case false is returned.
+bool recordInputTick(InputRecorder *recorder, const ControllerInfo *pad, bool connected);
+
+// Called once per simulation step while replaying, instead of reading the
+// controller. Returns false and goes back to live input once the recording
+// runs out.
+bool replayInputTick(InputRecorder *recorder, ControllerInfo *pad, bool *connected);
+
+// Sends the last recording over SIO1 in the format used by capture.h.
+void sendInputRecording(const InputRecorder *recorder);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,176 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "cache.h"
+#include "capture.h"
+#include "irq.h"
+#include "memmap.h"
+#include "sampler.h"
+#include "ps1/cop0gte.h"
+#include "ps1/registers.h"
+
+// End of the executable code, defined in executable.ld. MEM_REGION_TEXT also
+// includes .rodata, which the program counter never points into.
+extern char _codeEnd[];
+
+// Number of samples sent per serial block.
+#define RECORDS_PER_BLOCK ((CAPTURE_BLOCK_SIZE) / 8)
+
+static uint16_t *_histogram = 0;
+static uint32_t  _bucketCount;
+static uintptr_t _textStart, _textEnd;
+static int       _rate;
+static bool      _running = false;
+
+static volatile uint32_t _totalSamples, _outsideSamples;
+
+static HOT void _samplerHandler(void){
+    // Interrupts aren't re-enabled until the exception handler returns, so EPC
+    // still holds the address of the code we interrupted.
+    uintptr_t address = (uintptr_t) cop0_getEPC();
+
+    _totalSamples++;
+
+    if((address < _textStart) || (address >= _textEnd)){
+        _outsideSamples++;
+        return;
+    }
+
+    uint16_t *bucket = &_histogram[(address - _textStart) >> SAMPLER_BUCKET_SHIFT];
+
+    // Saturate rather than wrap around, which would make hot spots vanish.
+    if(*bucket != UINT16_MAX){
+        (*bucket)++;
+    }
+}
+
+COLD bool initSampler(int rate){
+    MemoryRegion text;
+    getMemoryRegion(MEM_REGION_TEXT, &text);
+
+    assert(rate >= SAMPLER_MIN_RATE);
+
+    _textStart   = text.start;
+    _textEnd     = (uintptr_t) _codeEnd;
+    _bucketCount = ((_textEnd - _textStart) >> SAMPLER_BUCKET_SHIFT) + 1;
+    _rate        = rate;
+    _histogram   = malloc(_bucketCount * sizeof(uint16_t));
+
+    if(!_histogram){
+        return false;
+    }
+
+    resetSampler();
+
+    // Count at the system clock and fire every time the reload value is hit.
+    TIMER_CTRL(1)   = 0;
+    TIMER_RELOAD(1) = F_CPU / rate;
+    return true;
+}
+
+void startSampler(void){
+    if(!_histogram || _running){
+        return;
+    }
+
+    TIMER_CTRL(1) = 0
+        | TIMER_CTRL_RELOAD
+        | TIMER_CTRL_IRQ_ON_RELOAD
+        | TIMER_CTRL_IRQ_REPEAT;
+
+    setInterruptHandler(IRQ_TIMER1, &_samplerHandler);
+    _running = true;
+}
+
+void stopSampler(void){
+    if(!_running){
+        return;
+    }
+
+    setInterruptHandler(IRQ_TIMER1, 0);
+    TIMER_CTRL(1) = 0;
+    _running = false;
+}
+
+void resetSampler(void){
+    bool enabled = disableInterrupts();
+
+    for(uint32_t i = 0; i < _bucketCount; i++){
+        _histogram[i] = 0;
+    }
+    _totalSamples   = 0;
+    _outsideSamples = 0;
+
+    restoreInterrupts(enabled);
+}
+
+COLD void sendSamplerHistogram(void){
+    if(!_histogram){
+        return;
+    }
+
+    bool wasRunning = _running;
+    stopSampler();
+
+    SamplerHeader header = {
+        .version        = SAMPLER_VERSION,
+        .bucketShift    = SAMPLER_BUCKET_SHIFT,
+        .rate           = _rate,
+        .textStart      = _textStart,
+        .textEnd        = _textEnd,
+        .totalSamples   = _totalSamples,
+        .outsideSamples = _outsideSamples
+    };
+
+    sendCaptureBlock(CAPTURE_BLOCK_SAMPLES_BEGIN, &header, sizeof(header));
+
+    // Most of the histogram is empty, so only the buckets that were hit are
+    // sent, a block's worth at a time.
+    uint32_t records[RECORDS_PER_BLOCK * 2];
+    uint32_t crc   = 0;
+    int      count = 0;
+
+    for(uint32_t i = 0; i < _bucketCount; i++){
+        if(!_histogram[i]){
+            continue;
+        }
+
+        records[count * 2 + 0] = _textStart + (i << SAMPLER_BUCKET_SHIFT);
+        records[count * 2 + 1] = _histogram[i];
+
+        if(++count == RECORDS_PER_BLOCK){
+            sendCaptureBlock(CAPTURE_BLOCK_SAMPLES, records, count * 8);
+            crc   = updateCaptureCRC(crc, records, count * 8);
+            count = 0;
+        }
+    }
+    if(count){
+        sendCaptureBlock(CAPTURE_BLOCK_SAMPLES, records, count * 8);
+        crc = updateCaptureCRC(crc, records, count * 8);
+    }
+
+    sendCaptureBlock(CAPTURE_BLOCK_END, &crc, 4);
+
+    if(wasRunning){
+        startSampler();
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ps1/registers.h"
+
+// Statistical profiler. Root counter 1 interrupts the CPU at a fixed rate and
+// the address that was interrupted is counted in a histogram covering the
+// executable's code, which can then be sent over serial and mapped back to
+// functions and lines by tools/sampleProfile.py.
+//
+// Interrupts are disabled while other IRQ handlers run and in critical
+// sections, so time spent there is attributed to the instruction that
+// re-enables them.
+
+// The default rate is deliberately not a multiple of the frame rate, so
+// samples don't keep landing on the same point of each frame.
+#define SAMPLER_DEFAULT_RATE 997
+#define SAMPLER_MIN_RATE     ((F_CPU / 0x10000) + 1)
+
+// Each bucket covers (1 << SAMPLER_BUCKET_SHIFT) bytes, i.e. one instruction.
+#define SAMPLER_BUCKET_SHIFT 2
+
+#define SAMPLER_SERIAL_COMMAND 'S'
+#define SAMPLER_VERSION        1
+
+// Sent at the start of a dump. It is followed by pairs of 32-bit words, each
+// holding the address of a bucket and its sample count, for every non-empty
+// bucket.
+typedef struct{
+    uint16_t version, bucketShift;
+    uint32_t rate;
+    uint32_t textStart, textEnd;
+    uint32_t totalSamples;
+    uint32_t outsideSamples; // Samples that landed outside the histogram
+}SamplerHeader;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Allocates the histogram on the heap and sets up (but doesn't start) the
+// timer. The rate is in samples per second. Returns false if there isn't
+// enough memory.
+bool initSampler(int rate);
+
+void startSampler(void);
+void stopSampler(void);
+void resetSampler(void);
+
+// Sends the histogram over SIO1 in the format used by capture.h. The sampler
+// is paused while this runs, so the serial port doesn't show up in the
+// results.
+void sendSamplerHistogram(void);
+
+#ifdef __cplusplus
+}
+#endif
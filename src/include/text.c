@@ -0,0 +1,291 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cache.h"
+#include "font.h"
+#include "gpu.h"
+#include "text.h"
+#include "ps1/gpucmd.h"
+
+// Each glyph is a textured rectangle packet: a tag followed by 4 commands.
+#define GLYPH_WORDS 5
+
+// Every buffer starts with a texpage packet and ends with an empty packet
+// whose tag is pointed at the ordering table entry the layer is linked to.
+#define TEXPAGE_WORDS    2
+#define TERMINATOR_WORDS 1
+
+static int _getBufferWords(int maxFields, int maxGlyphs){
+    return TEXPAGE_WORDS + maxFields + (maxGlyphs * GLYPH_WORDS) + TERMINATOR_WORDS;
+}
+
+size_t getTextLayerMemorySize(int maxFields, int maxGlyphs, int bufferCount){
+    return 0
+        + sizeof(uint32_t) * _getBufferWords(maxFields, maxGlyphs) * bufferCount
+        + sizeof(TextField) * maxFields
+        + maxGlyphs + maxFields;
+}
+
+COLD void initTextLayer(TextLayer *layer, const TextureInfo *font, int maxFields, int maxGlyphs, int bufferCount, void *memory){
+    assert((bufferCount > 0) && (bufferCount <= TEXT_LAYER_MAX_BUFFERS));
+
+    int bufferWords = _getBufferWords(maxFields, maxGlyphs);
+
+    uint32_t *ptr = (uint32_t *) memory;
+
+    for(int i = 0; i < bufferCount; i++){
+        layer->packets[i] = ptr;
+        ptr += bufferWords;
+
+        // The texpage packet links straight to the terminator until fields are
+        // added after it.
+        layer->packets[i][0] = gp0_tag(1, &layer->packets[i][TEXPAGE_WORDS]);
+        layer->packets[i][1] = gp0_texpage(font->page, false, false);
+    }
+
+    layer->fields = (TextField *) ptr;
+    layer->text   = (char *) &layer->fields[maxFields];
+
+    layer->font        = font;
+    layer->fieldCount  = 0;
+    layer->maxFields   = maxFields;
+    layer->usedWords   = TEXPAGE_WORDS;
+    layer->usedChars   = 0;
+    layer->maxGlyphs   = maxGlyphs;
+    layer->bufferCount = bufferCount;
+    layer->nextBuffer  = 0;
+}
+
+int addTextField(TextLayer *layer, int x, int y, int maxLength){
+    // Each field's text takes up a null terminator on top of its glyphs.
+    int usedGlyphs = layer->usedChars - layer->fieldCount;
+
+    if((layer->fieldCount >= layer->maxFields) || ((usedGlyphs + maxLength) > layer->maxGlyphs)){
+        return -1;
+    }
+
+    int        index = layer->fieldCount++;
+    TextField *field = &layer->fields[index];
+
+    field->x          = x;
+    field->y          = y;
+    field->maxLength  = maxLength;
+    field->textOffset = layer->usedChars;
+    field->offset     = layer->usedWords;
+
+    layer->text[field->textOffset] = 0;
+    layer->usedChars += maxLength + 1;
+    layer->usedWords += 1 + (maxLength * GLYPH_WORDS);
+
+    // Fields are laid out back to back, so each glyph slot's packet naturally
+    // links to the one after it, and the field's last slot links to whatever
+    // comes after the field. The first word is an empty packet the previous
+    // field links to, which skips the slots entirely while there's no text.
+    for(int i = 0; i < layer->bufferCount; i++){
+        uint32_t *head = &layer->packets[i][field->offset];
+        uint32_t *slot = &head[1];
+
+        for(int j = 0; j < maxLength; j++, slot += GLYPH_WORDS){
+            slot[0] = gp0_tag(4, &slot[GLYPH_WORDS]);
+            slot[1] = gp0_rectangle(true, true, true);
+        }
+
+        head[0] = gp0_tag(0, slot);
+
+        field->glyphCount[i] = 0;
+        field->dirtyFrom[i]  = TEXT_FIELD_CLEAN;
+    }
+
+    return index;
+}
+
+int addStaticText(TextLayer *layer, int x, int y, const char *str){
+    int length = 0;
+
+    while(str[length]){
+        length++;
+    }
+
+    int field = addTextField(layer, x, y, length);
+
+    if(field >= 0){
+        setTextField(layer, field, str);
+    }
+
+    return field;
+}
+
+void setTextField(TextLayer *layer, int field, const char *str){
+    TextField *info = &layer->fields[field];
+    char      *text = &layer->text[info->textOffset];
+    int        i    = 0;
+
+    // Find the first character that differs, if any.
+    while((i < info->maxLength) && str[i] && (str[i] == text[i])){
+        i++;
+    }
+    if(((i == info->maxLength) || !str[i]) && !text[i]){
+        return;
+    }
+
+    int first = i;
+
+    for(; (i < info->maxLength) && str[i]; i++){
+        text[i] = str[i];
+    }
+    text[i] = 0;
+
+    for(int j = 0; j < layer->bufferCount; j++){
+        if(first < info->dirtyFrom[j]){
+            info->dirtyFrom[j] = first;
+        }
+    }
+}
+
+void moveTextField(TextLayer *layer, int field, int x, int y){
+    TextField *info = &layer->fields[field];
+
+    if((info->x == x) && (info->y == y)){
+        return;
+    }
+
+    info->x = x;
+    info->y = y;
+
+    for(int i = 0; i < layer->bufferCount; i++){
+        info->dirtyFrom[i] = 0;
+    }
+}
+
+static void _rebuildField(TextLayer *layer, TextField *field, int buffer){
+    const TextureInfo *font = layer->font;
+    const char        *text = &layer->text[field->textOffset];
+
+    uint32_t *head  = &layer->packets[buffer][field->offset];
+    uint32_t *slots = &head[1];
+    uint32_t *next  = &slots[field->maxLength * GLYPH_WORDS];
+
+    int from  = field->dirtyFrom[buffer];
+    int x     = field->x, y = field->y;
+    int count = 0;
+
+    // Characters before the first change still have to be laid out to find
+    // out where the changed ones go, but their packets are left alone.
+    for(int i = 0; text[i]; i++){
+        int spriteX = x, spriteY = y;
+
+        const SpriteInfo *sprite = layoutCharacter(text[i], field->x, &x, &y);
+
+        if(!sprite){
+            continue;
+        }
+
+        if(i >= from){
+            uint32_t *ptr = &slots[count * GLYPH_WORDS];
+
+            ptr[2] = gp0_xy(spriteX, spriteY);
+            ptr[3] = gp0_uv(font->u + sprite->x, font->v + sprite->y, font->clut);
+            ptr[4] = gp0_xy(sprite->width, sprite->height);
+        }
+        count++;
+    }
+
+    // Restore the link of the slot that used to be last, then make the new
+    // last slot skip over the unused ones.
+    int oldCount = field->glyphCount[buffer];
+
+    if(oldCount){
+        slots[(oldCount - 1) * GLYPH_WORDS] = gp0_tag(4, &slots[oldCount * GLYPH_WORDS]);
+    }
+    if(count){
+        slots[(count - 1) * GLYPH_WORDS] = gp0_tag(4, next);
+    }
+    head[0] = gp0_tag(0, count ? slots : next);
+
+    field->glyphCount[buffer] = count;
+    field->dirtyFrom[buffer]  = TEXT_FIELD_CLEAN;
+}
+
+void linkTextLayer(TextLayer *layer, DMAChain *chain, int zIndex){
+    int buffer = layer->nextBuffer;
+
+    layer->nextBuffer = (buffer + 1) % layer->bufferCount;
+
+    for(int i = 0; i < layer->fieldCount; i++){
+        TextField *field = &layer->fields[i];
+
+        if(field->dirtyFrom[buffer] != TEXT_FIELD_CLEAN){
+            _rebuildField(layer, field, buffer);
+        }
+    }
+
+    // Splice the whole list in front of whatever the entry pointed to, the
+    // same way allocatePacket() does with a single packet. The entry is
+    // already a tag with no commands, so it can be copied as it is.
+    uint32_t *packets = layer->packets[buffer];
+
+    // Unlike allocatePacket(), this doesn't move the list out of bands that
+    // have already been sent (see submitChainBands()).
+    assert(zIndex < chain->openZIndex);
+
+    packets[layer->usedWords]     = chain->orderingTable[zIndex];
+    chain->orderingTable[zIndex] = gp0_tag(0, packets);
+}
+
+void drawTextLayer(const TextLayer *layer, DMAChain *chain){
+    for(int i = 0; i < layer->fieldCount; i++){
+        const TextField *field = &layer->fields[i];
+
+        printString(chain, layer->font, field->x, field->y, &layer->text[field->textOffset]);
+    }
+}
+
+// Division by a constant is turned into a multiplication by GCC, so this never
+// has to wait on the CPU's divider.
+char *formatInt(char *output, int32_t value){
+    uint32_t magnitude = value;
+
+    if(value < 0){
+        *(output++) = '-';
+        magnitude   = -magnitude;
+    }
+
+    char digits[FORMAT_INT_MAX_LENGTH];
+    int  count = 0;
+
+    do{
+        digits[count++] = '0' + (magnitude % 10);
+        magnitude      /= 10;
+    }while(magnitude);
+
+    while(count){
+        *(output++) = digits[--count];
+    }
+
+    return output;
+}
+
+char *formatString(char *output, const char *str){
+    while(*str){
+        *(output++) = *(str++);
+    }
+
+    return output;
+}
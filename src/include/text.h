@@ -0,0 +1,101 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "font.h"
+#include "gpu.h"
+
+// Retained text layer. Instead of turning strings into packets every frame
+// like printString() does, each field's glyph packets are built once into
+// memory owned by the layer and linked into a chain's ordering table as a
+// single list. When a field's text changes, only the glyphs from the first
+// changed character onwards are rewritten.
+//
+// The GPU may still be drawing the previous frames' copies of the packets while
+// the next one is being updated, so the layer keeps one copy per chain that
+// can be in flight, up to this many.
+#define TEXT_LAYER_MAX_BUFFERS 3
+
+#define TEXT_FIELD_CLEAN 0xffff
+
+// Largest number of characters formatInt() can write, including the sign.
+#define FORMAT_INT_MAX_LENGTH 11
+
+typedef struct{
+    int16_t  x, y;
+    uint16_t maxLength;  // Characters (and glyph slots) reserved for the field
+    uint16_t textOffset; // Index of the field's text in the layer's string storage
+    uint16_t offset;     // Index of the field's first word in each packet buffer
+
+    // Glyphs currently linked in each copy and the first character each copy
+    // has to rebuild from (TEXT_FIELD_CLEAN if it's up to date).
+    uint16_t glyphCount[TEXT_LAYER_MAX_BUFFERS];
+    uint16_t dirtyFrom[TEXT_LAYER_MAX_BUFFERS];
+}TextField;
+
+typedef struct{
+    const TextureInfo *font;
+
+    uint32_t  *packets[TEXT_LAYER_MAX_BUFFERS];
+    TextField *fields;
+    char      *text;
+
+    int fieldCount, maxFields;
+    int usedWords, usedChars, maxGlyphs;
+    int bufferCount, nextBuffer;
+}TextLayer;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns how much memory initTextLayer() needs to hold the given number of
+// fields and glyphs (i.e. characters) across all of them, with one copy of the
+// packets for each of bufferCount chains.
+size_t getTextLayerMemorySize(int maxFields, int maxGlyphs, int bufferCount);
+void initTextLayer(TextLayer *layer, const TextureInfo *font, int maxFields, int maxGlyphs, int bufferCount, void *memory);
+
+// Reserves room for a field of up to maxLength characters and returns its
+// index, or -1 if the layer is full. Fields start out empty.
+int addTextField(TextLayer *layer, int x, int y, int maxLength);
+// Shorthand for a field that's set once and never changed.
+int addStaticText(TextLayer *layer, int x, int y, const char *str);
+
+// Changes a field's text, truncating it to the field's length. Setting the
+// text it already has costs a string comparison and nothing else.
+void setTextField(TextLayer *layer, int field, const char *str);
+void moveTextField(TextLayer *layer, int field, int x, int y);
+
+// Brings the next copy of the packets up to date and links it into the chain
+// at the given ordering table index. Must be called at most once per frame.
+void linkTextLayer(TextLayer *layer, DMAChain *chain, int zIndex);
+// Draws the layer with printString() at ordering table index 0 instead, so the chain doesn't reference
+// any memory outside its own buffer (e.g. when it's about to be captured).
+void drawTextLayer(const TextLayer *layer, DMAChain *chain);
+
+// Writes a decimal integer without a null terminator and returns a pointer
+// past its last character. Much cheaper than going through sprintf().
+char *formatInt(char *output, int32_t value);
+// Copies a string without its null terminator and returns a pointer past it.
+char *formatString(char *output, const char *str);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,92 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cache.h"
+#include "irq.h"
+#include "timer.h"
+#include "ps1/registers.h"
+
+// Upper 16 bits of the tick count, bumped every time the counter wraps.
+static volatile uint32_t _ticksHigh;
+
+static HOT void _timerOverflowHandler(void){
+    _ticksHigh++;
+}
+
+void initTimer(void){
+    // Let the counter run freely from 0 to 0xffff at sysclk/8, firing an IRQ
+    // every time it wraps around.
+    _ticksHigh = 0;
+
+    TIMER_CTRL(2) = 0
+        | TIMER_CTRL_PRESCALE
+        | TIMER_CTRL_IRQ_ON_OVERFLOW
+        | TIMER_CTRL_IRQ_REPEAT;
+
+    setInterruptHandler(IRQ_TIMER2, &_timerOverflowHandler);
+}
+
+HOT uint32_t getTicks(void){
+    bool enabled = disableInterrupts();
+
+    uint32_t high = _ticksHigh;
+    uint32_t low  = TIMER_VALUE(2);
+
+    // If the counter wrapped after interrupts were disabled, the overflow IRQ
+    // is still pending and hasn't bumped the upper half yet. A low value means
+    // the wrap happened before we read it.
+    if((IRQ_STAT & (1 << IRQ_TIMER2)) && (low < 0x8000)){
+        high++;
+    }
+
+    restoreInterrupts(enabled);
+    return (high << 16) | low;
+}
+
+void initFixedTimestep(FixedTimestep *timestep, int rate){
+    timestep->lastTicks   = getTicks();
+    timestep->accumulator = 0;
+    timestep->stepTicks   = TIMER_TICKS_PER_SECOND / rate;
+}
+
+// Returns how many simulation steps should be run to catch up with real time.
+int advanceFixedTimestep(FixedTimestep *timestep){
+    uint32_t now = getTicks();
+
+    timestep->accumulator += now - timestep->lastTicks;
+    timestep->lastTicks    = now;
+
+    int steps = 0;
+
+    while(timestep->accumulator >= timestep->stepTicks){
+        timestep->accumulator -= timestep->stepTicks;
+
+        if(++steps == FIXED_TIMESTEP_MAX_STEPS){
+            timestep->accumulator = 0;
+            break;
+        }
+    }
+
+    return steps;
+}
+
+// Returns how far we are between the last step and the next one, from 0 to
+// (1 << FIXED_TIMESTEP_ALPHA_SHIFT). Used to interpolate what gets drawn.
+int getFixedTimestepAlpha(const FixedTimestep *timestep){
+    return (timestep->accumulator << FIXED_TIMESTEP_ALPHA_SHIFT) / timestep->stepTicks;
+}
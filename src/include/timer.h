@@ -0,0 +1,60 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "ps1/registers.h"
+
+// Root counter 2 runs at the system clock divided by 8 (~4.23 MHz). Its 16-bit
+// value is extended to 32 bits in software, which wraps after ~17 minutes.
+#define TIMER_TICKS_PER_SECOND (F_CPU / 8)
+
+// Upper limit on the steps advanceFixedTimestep() returns for a single frame.
+// If we fall further behind than this (e.g. after loading something), the
+// extra time is dropped rather than trying to catch up all at once.
+#define FIXED_TIMESTEP_MAX_STEPS   8
+#define FIXED_TIMESTEP_ALPHA_SHIFT 12
+
+// Accumulates real time between frames and hands it out in steps of a fixed
+// length, so the simulation runs at the same speed regardless of frame rate.
+typedef struct{
+    uint32_t lastTicks;
+    uint32_t accumulator;
+    uint32_t stepTicks;
+}FixedTimestep;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void initTimer(void);
+uint32_t getTicks(void);
+
+void initFixedTimestep(FixedTimestep *timestep, int rate);
+int advanceFixedTimestep(FixedTimestep *timestep);
+int getFixedTimestepAlpha(const FixedTimestep *timestep);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline uint32_t ticksToMicroseconds(uint32_t ticks) {
+	return ((uint64_t) ticks * 1000000) / TIMER_TICKS_PER_SECOND;
+}
+static inline uint32_t microsecondsToTicks(uint32_t us) {
+	return ((uint64_t) us * TIMER_TICKS_PER_SECOND) / 1000000;
+}
@@ -19,13 +19,14 @@
  *     https://www.coranac.com/2009/07/sines
  */
 
+#include "cache.h"
 #include "trig.h"
 
 #define A (1 << 12)
 #define B 19900
 #define	C 3516
 
-int isin(int x) {
+HOT int isin(int x) {
 	int c = x << (30 - ISIN_SHIFT);
 	x    -= 1 << ISIN_SHIFT;
 
@@ -40,7 +41,7 @@ int isin(int x) {
 	return (c >= 0) ? y : (-y);
 }
 
-int isin2(int x) {
+HOT int isin2(int x) {
 	int c = x << (30 - ISIN2_SHIFT);
 	x    -= 1 << ISIN2_SHIFT;
 
@@ -0,0 +1,79 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "cache.h"
+#include "log.h"
+#include "vram.h"
+
+// Texture pages are either in the top or the bottom half of VRAM, so a shelf
+// that fits in one half is never allowed to cross into the other.
+#define VRAM_PAGE_HEIGHT 256
+
+static inline int _alignX(int x, int alignX){
+    return ((x + alignX - 1) / alignX) * alignX;
+}
+
+COLD void initVRAMAllocator(VRAMAllocator *vram){
+    vram->shelfCount = 0;
+    vram->nextY      = 0;
+}
+
+COLD bool allocateVRAM(VRAMAllocator *vram, int w, int h, int alignX, int *x, int *y){
+    assert((w > 0) && (h > 0) && (alignX > 0));
+
+    // Use the lowest shelf the area fits in, so small textures and palettes
+    // don't waste the space next to a framebuffer.
+    VRAMShelf *best = 0;
+
+    for(int i = 0; i < vram->shelfCount; i++){
+        VRAMShelf *shelf = &vram->shelves[i];
+
+        if((shelf->height < h) || ((_alignX(shelf->nextX, alignX) + w) > VRAM_WIDTH)){
+            continue;
+        }
+        if(!best || (shelf->height < best->height)){
+            best = shelf;
+        }
+    }
+
+    if(!best){
+        int top = vram->nextY;
+
+        if((h <= VRAM_PAGE_HEIGHT) && (top < VRAM_PAGE_HEIGHT) && ((top + h) > VRAM_PAGE_HEIGHT)){
+            top = VRAM_PAGE_HEIGHT;
+        }
+        if((vram->shelfCount >= VRAM_MAX_SHELVES) || (w > VRAM_WIDTH) || ((top + h) > VRAM_HEIGHT)){
+            LOG_ERROR("no room in VRAM for %dx%d area\n", w, h);
+            return false;
+        }
+
+        best = &vram->shelves[vram->shelfCount++];
+        best->y      = (uint16_t) top;
+        best->height = (uint16_t) h;
+        best->nextX  = 0;
+
+        vram->nextY = top + h;
+    }
+
+    *x = _alignX(best->nextX, alignX);
+    *y = best->y;
+
+    best->nextX = (uint16_t) (*x + w);
+    return true;
+}
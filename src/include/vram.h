@@ -0,0 +1,59 @@
+/*
+ * (C) 2024 Rhys Baker
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define VRAM_WIDTH      1024
+#define VRAM_HEIGHT     512
+#define VRAM_MAX_SHELVES 16
+
+// Texture pages are 64 pixels wide and CLUTs have to start on a multiple of 16
+// pixels, so these are the alignments textures and palettes are allocated with.
+#define VRAM_TEXTURE_ALIGN 64
+#define VRAM_PALETTE_ALIGN 16
+
+// One row of allocations, all starting at the same Y and filled left to right.
+typedef struct{
+    uint16_t y, height;
+    uint16_t nextX;
+}VRAMShelf;
+
+// Hands out areas of VRAM for framebuffers, textures and palettes, so their
+// positions don't have to be worked out by hand whenever one of them changes
+// size or another is added. VRAM is filled in shelves from the top down and is
+// only ever freed all at once by initVRAMAllocator().
+typedef struct{
+    VRAMShelf shelves[VRAM_MAX_SHELVES];
+    int shelfCount;
+    int nextY; // Top of the next shelf to be opened
+}VRAMAllocator;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void initVRAMAllocator(VRAMAllocator *vram);
+
+// Finds room for a w by h area whose left edge is a multiple of alignX pixels
+// and writes its position to x and y. Returns false if VRAM is full.
+bool allocateVRAM(VRAMAllocator *vram, int w, int h, int alignX, int *x, int *y);
+
+#ifdef __cplusplus
+}
+#endif
@@ -29,7 +29,11 @@
 extern "C" {
 #endif
 
-void _assertAbort(const char *file, int line, const char *expr);
+// Marked as cold so GCC moves the code leading up to it out of the way (see
+// src/include/cache.h).
+__attribute__((cold)) void _assertAbort(
+	const char *file, int line, const char *expr
+);
 
 #ifdef __cplusplus
 }
@@ -27,6 +27,7 @@ typedef void (*Function)(void);
 // they are virtual symbols whose location matches their value. The simplest way
 // to turn them into pointers is to declare them as arrays.
 extern char _sdataStart[], _bssStart[], _bssEnd[];
+extern char _heapStart[], _heapEnd[];
 
 extern const Function _preinitArrayStart[], _preinitArrayEnd[];
 extern const Function _initArrayStart[], _initArrayEnd[];
@@ -34,17 +35,18 @@ extern const Function _finiArrayStart[], _finiArrayEnd[];
 
 /* Heap API (used by malloc) */
 
-static uintptr_t _heapEnd   = (uintptr_t) _bssEnd;
-static uintptr_t _heapLimit = 0x80200000; // TODO: add a way to change this
+// The heap's boundaries are set by the linker script (see the PSX_* options in
+// CMakeLists.txt), so it never runs into the stack.
+static uintptr_t _heapBreak = (uintptr_t) _heapStart;
 
 void *sbrk(ptrdiff_t incr) {
-	uintptr_t currentEnd = _heapEnd;
+	uintptr_t currentEnd = _heapBreak;
 	uintptr_t newEnd     = _align(currentEnd + incr, 8);
 
-	if (newEnd >= _heapLimit)
+	if (newEnd > (uintptr_t) _heapEnd)
 		return 0;
 
-	_heapEnd = newEnd;
+	_heapBreak = newEnd;
 	return (void *) currentEnd;
 }
 
@@ -1,5 +1,5 @@
 /*
- * ps1-bare-metal - (C) 2023 spicyjpeg
+ * ps1-bare-metal - (C) 2023 spicyjpeg, (C) 2024 Rhys Baker
  *
  * Permission to use, copy, modify, and/or distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -13,133 +13,348 @@
  * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
  * PERFORMANCE OF THIS SOFTWARE.
  *
- * This code is based on psyqo's malloc implementation, available here:
- * https://github.com/grumpycoders/pcsx-redux/blob/main/src/mips/psyqo/src/alloc.c
+ * This is a two-level segregated fit (TLSF) allocator, as described in
+ * "TLSF: a New Dynamic Memory Allocator for Real-Time Systems" (Masmano et al.,
+ * 2004). Free blocks are kept in lists indexed by a power-of-two "first level"
+ * and a linear "second level" subdivision of it, with a bitmap for each level,
+ * so finding, splitting and coalescing blocks never requires walking the heap.
  */
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 
 #define _align(x, n) (((x) + ((n) - 1)) & ~((n) - 1))
-#define _updateHeapUsage(incr)
 
-/* Internal state */
+/* Size classes */
+
+// Block payloads are aligned to (and sized in multiples of) 8 bytes. The first
+// level covers sizes from 128 bytes (1 << FL_INDEX_SHIFT) up to 8 MB, each one
+// split into 16 second level lists; everything below 128 bytes goes into first
+// level 0, whose lists are 8 bytes apart.
+#define ALIGN_LOG2     3
+#define SL_INDEX_LOG2  4
+#define SL_INDEX_COUNT (1 << SL_INDEX_LOG2)
+#define FL_INDEX_SHIFT (SL_INDEX_LOG2 + ALIGN_LOG2)
+#define FL_INDEX_MAX   23
+#define FL_INDEX_COUNT (FL_INDEX_MAX - FL_INDEX_SHIFT + 1)
+
+#define SMALL_BLOCK_SIZE (1 << FL_INDEX_SHIFT)
+#define MAX_BLOCK_SIZE   ((1 << FL_INDEX_MAX) - 1)
+
+// The heap is extended in steps of at least this many bytes, to avoid calling
+// sbrk() for every small allocation.
+#define HEAP_GROW_SIZE 0x1000
 
+/* Block headers */
+
+#define BLOCK_FREE (1 << 0)
+#define SIZE_MASK  (~7)
+
+// Every block starts with an 8-byte header. The free list links overlap the
+// payload, so they are only valid while the block is free.
 typedef struct _Block {
-	struct _Block *prev, *next;
+	struct _Block *prevPhys;
+	size_t        size;
 
-	void   *ptr;
-	size_t size;
+	struct _Block *nextFree, *prevFree;
 } Block;
 
-static void  *_mallocStart;
-static Block *_mallocHead, *_mallocTail;
+#define HEADER_SIZE      offsetof(Block, nextFree)
+#define MIN_PAYLOAD_SIZE (sizeof(Block) - HEADER_SIZE)
 
-/* Allocator implementation */
+static inline size_t _getSize(const Block *block) {
+	return block->size & SIZE_MASK;
+}
+static inline bool _isFree(const Block *block) {
+	return block->size & BLOCK_FREE;
+}
+static inline void *_getPayload(Block *block) {
+	return (void *) ((uintptr_t) block + HEADER_SIZE);
+}
+static inline Block *_getBlock(void *ptr) {
+	return (Block *) ((uintptr_t) ptr - HEADER_SIZE);
+}
+static inline Block *_getNextPhys(const Block *block) {
+	return (Block *) ((uintptr_t) block + HEADER_SIZE + _getSize(block));
+}
+
+/* Internal state */
+
+static uint32_t _flBitmap;
+static uint32_t _slBitmap[FL_INDEX_COUNT];
+static Block    *_freeLists[FL_INDEX_COUNT][SL_INDEX_COUNT];
+
+// Zero-sized, permanently allocated block at the top of the heap. It stops
+// coalescing from running off the end, and becomes the header of the next
+// block whenever the heap is grown.
+static Block *_sentinel;
+
+static HeapStats _stats;
+
+/* Bit scanning */
+
+// __builtin_clz() is implemented using the GTE's leading zero counter (see
+// misc.s), so these take constant time.
+static inline int _fls(uint32_t value) {
+	return 31 - __builtin_clz(value);
+}
+static inline int _ffs(uint32_t value) {
+	return _fls(value & -value);
+}
+
+/* Free list management */
+
+static void _mapping(size_t size, int *fl, int *sl) {
+	if (size < SMALL_BLOCK_SIZE) {
+		*fl = 0;
+		*sl = size >> ALIGN_LOG2;
+	} else {
+		int bit = _fls(size);
+
+		*fl = bit - (FL_INDEX_SHIFT - 1);
+		*sl = (size >> (bit - SL_INDEX_LOG2)) ^ SL_INDEX_COUNT;
+	}
+}
+
+static Block *_findSuitableBlock(size_t size, int *fl, int *sl) {
+	// Round the size up to the start of the next list, so any block found in
+	// the lists we search is guaranteed to be large enough.
+	if (size >= SMALL_BLOCK_SIZE)
+		size += (1 << (_fls(size) - SL_INDEX_LOG2)) - 1;
+
+	_mapping(size, fl, sl);
+
+	if (*fl >= FL_INDEX_COUNT)
+		return 0;
+
+	uint32_t slMap = _slBitmap[*fl] & (~0u << *sl);
+
+	if (!slMap) {
+		uint32_t flMap = _flBitmap & (~0u << (*fl + 1));
+
+		if (!flMap)
+			return 0;
+
+		*fl   = _ffs(flMap);
+		slMap = _slBitmap[*fl];
+	}
+
+	*sl = _ffs(slMap);
+	return _freeLists[*fl][*sl];
+}
+
+static void _insertBlock(Block *block) {
+	int fl, sl;
+	_mapping(_getSize(block), &fl, &sl);
+
+	Block *head     = _freeLists[fl][sl];
+	block->nextFree = head;
+	block->prevFree = 0;
+
+	if (head)
+		head->prevFree = block;
+
+	_freeLists[fl][sl] = block;
+	_flBitmap         |= 1 << fl;
+	_slBitmap[fl]     |= 1 << sl;
+
+	_stats.freeBytes += _getSize(block);
+}
 
-static Block *_findBlock(Block *head, size_t size) {
-	Block *prev = head;
+static void _removeBlock(Block *block) {
+	int fl, sl;
+	_mapping(_getSize(block), &fl, &sl);
 
-	for (; prev; prev = prev->next) {
-		if (prev->next) {
-			uintptr_t nextBot = (uintptr_t) prev->next;
-			nextBot          -= (uintptr_t) prev->ptr + prev->size;
+	if (block->nextFree)
+		(block->nextFree)->prevFree = block->prevFree;
 
-			if (nextBot >= size)
-				return prev;
+	if (block->prevFree) {
+		(block->prevFree)->nextFree = block->nextFree;
+	} else {
+		_freeLists[fl][sl] = block->nextFree;
+
+		if (!block->nextFree) {
+			_slBitmap[fl] &= ~(1 << sl);
+
+			if (!_slBitmap[fl])
+				_flBitmap &= ~(1 << fl);
 		}
 	}
 
-	return prev;
+	_stats.freeBytes -= _getSize(block);
 }
 
-void *malloc(size_t size) {
-	if (!size)
+/* Block splitting and merging */
+
+// Trims a block down to the given size, returning whatever is left over as a
+// new free block (or null if the remainder is too small to hold a block).
+static Block *_splitBlock(Block *block, size_t size) {
+	size_t blockSize = _getSize(block);
+
+	if (blockSize < (size + sizeof(Block)))
 		return 0;
 
-	size_t _size = _align(size + sizeof(Block), 8);
+	Block *remainder    = (Block *) ((uintptr_t) _getPayload(block) + size);
+	remainder->prevPhys = block;
+	remainder->size     = (blockSize - size - HEADER_SIZE) | BLOCK_FREE;
 
-	// Nothing's initialized yet? Let's just initialize the bottom of our heap,
-	// flag it as allocated.
-	if (!_mallocHead) {
-		if (!_mallocStart)
-			_mallocStart = sbrk(0);
+	block->size = size | (block->size & BLOCK_FREE);
+	_getNextPhys(remainder)->prevPhys = remainder;
 
-		Block *new = (Block *) sbrk(_size);
-		if (!new)
-			return 0;
+	return remainder;
+}
 
-		void *ptr = (void *) &new[1];
-		new->ptr  = ptr;
-		new->size = _size - sizeof(Block);
-		new->prev = 0;
-		new->next = 0;
+// Absorbs the block physically following this one, which must be free and
+// already removed from its free list.
+static void _absorbNext(Block *block) {
+	Block *next = _getNextPhys(block);
 
-		_mallocHead = new;
-		_mallocTail = new;
+	block->size += HEADER_SIZE + _getSize(next);
+	_getNextPhys(block)->prevPhys = block;
+}
 
-		_updateHeapUsage(size);
-		return ptr;
+static Block *_mergeFreeNeighbors(Block *block) {
+	Block *next = _getNextPhys(block);
+
+	if (_isFree(next)) {
+		_removeBlock(next);
+		_absorbNext(block);
 	}
 
-	// We *may* have the bottom of our heap that has shifted, because of a free.
-	// So let's check first if we have free space there, because I'm nervous
-	// about having an incomplete data structure.
-	if (((uintptr_t) _mallocStart + _size) < ((uintptr_t) _mallocHead)) {
-		Block *new = (Block *) _mallocStart;
+	Block *prev = block->prevPhys;
 
-		void *ptr = (void *) &new[1];
-		new->ptr  = ptr;
-		new->size = _size - sizeof(Block);
-		new->prev = 0;
-		new->next = _mallocHead;
+	if (prev && _isFree(prev)) {
+		_removeBlock(prev);
+		_absorbNext(prev);
+		block = prev;
+	}
 
-		_mallocHead->prev = new;
-		_mallocHead       = new;
+	return block;
+}
 
-		_updateHeapUsage(size);
-		return ptr;
+/* Heap growth */
+
+static bool _initHeap(void) {
+	void *start = sbrk(HEADER_SIZE);
+	if (!start)
+		return false;
+
+	_sentinel           = (Block *) start;
+	_sentinel->prevPhys = 0;
+	_sentinel->size     = 0;
+
+	_stats.heapSize = HEADER_SIZE;
+	return true;
+}
+
+// Extends the heap so that it has a free block of at least the given size at
+// the top, and returns that block without inserting it into any free list.
+static Block *_growHeap(size_t size) {
+	// If the last block is already free, we only need to make up the
+	// difference. It may even be large enough already, as the free list search
+	// skips lists that only *might* contain a suitable block.
+	Block  *last    = _sentinel->prevPhys;
+	size_t lastSize = 0;
+
+	if (last && _isFree(last)) {
+		if (_getSize(last) >= size) {
+			_removeBlock(last);
+			return last;
+		}
+
+		lastSize = _getSize(last) + HEADER_SIZE;
 	}
 
-	// No luck at the beginning of the heap, let's walk the heap to find a fit.
-	Block *prev = _findBlock(_mallocHead, _size);
-	if (prev) {
-		Block *new = (Block *) ((uintptr_t) prev->ptr + prev->size);
+	size_t increment = _align(size + HEADER_SIZE - lastSize, HEAP_GROW_SIZE);
 
-		void *ptr = (void *)((uintptr_t) new + sizeof(Block));
-		new->ptr  = ptr;
-		new->size = _size - sizeof(Block);
-		new->prev = prev;
-		new->next = prev->next;
+	void *top = sbrk(increment);
 
-		(new->next)->prev = new;
-		prev->next        = new;
+	// Only malloc() is supposed to call sbrk(), so the new memory should
+	// always be right after the sentinel.
+	if (!top || (top != (void *) _getNextPhys(_sentinel)))
+		return 0;
 
-		_updateHeapUsage(size);
-		return ptr;
+	// Turn the old sentinel into the new block and put a new one at the top.
+	Block *block = _sentinel;
+	block->size  = (increment - HEADER_SIZE) | BLOCK_FREE;
+
+	_sentinel           = _getNextPhys(block);
+	_sentinel->prevPhys = block;
+	_sentinel->size     = 0;
+
+	_stats.heapSize += increment;
+
+	if (lastSize) {
+		_removeBlock(last);
+		_absorbNext(last);
+		block = last;
 	}
 
-	// Time to extend the size of the heap.
-	Block *new = (Block *) sbrk(_size);
-	if (!new)
+	return block;
+}
+
+/* Allocator implementation */
+
+static size_t _adjustSize(size_t size) {
+	size = _align(size, 1 << ALIGN_LOG2);
+
+	return (size < MIN_PAYLOAD_SIZE) ? MIN_PAYLOAD_SIZE : size;
+}
+
+static void *_useBlock(Block *block, size_t size) {
+	Block *remainder = _splitBlock(block, size);
+
+	if (remainder)
+		_insertBlock(remainder);
+
+	block->size &= ~BLOCK_FREE;
+
+	_stats.usedBytes += _getSize(block);
+	_stats.allocCount++;
+
+	if (_stats.usedBytes > _stats.peakUsedBytes)
+		_stats.peakUsedBytes = _stats.usedBytes;
+
+	return _getPayload(block);
+}
+
+void *malloc(size_t size) {
+	if (!size || (size > MAX_BLOCK_SIZE))
+		return 0;
+	if (!_sentinel && !_initHeap())
 		return 0;
 
-	void *ptr = (void *) &new[1];
-	new->ptr  = ptr;
-	new->size = _size - sizeof(Block);
-	new->prev = _mallocTail;
-	new->next = 0;
+	size = _adjustSize(size);
 
-	_mallocTail->next = new;
-	_mallocTail       = new;
+	int   fl, sl;
+	Block *block = _findSuitableBlock(size, &fl, &sl);
 
-	_updateHeapUsage(size);
-	return ptr;
+	if (block) {
+		_removeBlock(block);
+	} else {
+		block = _growHeap(size);
+
+		if (!block)
+			return 0;
+	}
+
+	return _useBlock(block, size);
 }
 
 void *calloc(size_t num, size_t size) {
-	return malloc(num * size);
+	// A product that wraps around would give a block that's too small.
+	if (size && (num > (SIZE_MAX / size)))
+		return 0;
+
+	size_t total = num * size;
+	void   *ptr  = malloc(total);
+
+	if (ptr)
+		__builtin_memset(ptr, 0, total);
+
+	return ptr;
 }
 
 void *realloc(void *ptr, size_t size) {
@@ -149,36 +364,34 @@ void *realloc(void *ptr, size_t size) {
 	}
 	if (!ptr)
 		return malloc(size);
+	if (size > MAX_BLOCK_SIZE)
+		return 0;
 
-	size_t _size = _align(size + sizeof(Block), 8);
-	Block  *prev = (Block *) ((uintptr_t) ptr - sizeof(Block));
+	Block  *block   = _getBlock(ptr);
+	size_t oldSize  = _getSize(block);
+	size_t newSize  = _adjustSize(size);
+	Block  *next    = _getNextPhys(block);
+
+	// Try to grow into the next block if it's free, so we can avoid copying.
+	if (
+		(newSize > oldSize) && _isFree(next) &&
+		((oldSize + HEADER_SIZE + _getSize(next)) >= newSize)
+	) {
+		_removeBlock(next);
+		_absorbNext(block);
+	}
 
-	// New memory block shorter?
-	if (prev->size >= _size) {
-		_updateHeapUsage(size - prev->size);
-		prev->size = _size;
+	if (_getSize(block) >= newSize) {
+		Block *remainder = _splitBlock(block, newSize);
 
-		if (!prev->next)
-			sbrk((ptr - sbrk(0)) + _size);
+		if (remainder)
+			_insertBlock(_mergeFreeNeighbors(remainder));
 
-		return ptr;
-	}
+		_stats.usedBytes += _getSize(block) - oldSize;
 
-	// New memory block larger; is it the last one?
-	if (!prev->next) {
-		void *new = sbrk(_size - prev->size);
-		if (!new)
-			return 0;
+		if (_stats.usedBytes > _stats.peakUsedBytes)
+			_stats.peakUsedBytes = _stats.usedBytes;
 
-		_updateHeapUsage(size - prev->size);
-		prev->size = _size;
-		return ptr;
-	}
-
-	// Do we have free memory after it?
-	if (((prev->next)->ptr - ptr) > _size) {
-		_updateHeapUsage(size - prev->size);
-		prev->size = _size;
 		return ptr;
 	}
 
@@ -187,52 +400,41 @@ void *realloc(void *ptr, size_t size) {
 	if (!new)
 		return 0;
 
-	__builtin_memcpy(new, ptr, prev->size);
+	__builtin_memcpy(new, ptr, oldSize);
 	free(ptr);
 	return new;
 }
 
 void free(void *ptr) {
-	if (!ptr || !_mallocHead)
+	if (!ptr)
 		return;
 
-	// First block; bumping head ahead.
-	if (ptr == _mallocHead->ptr) {
-		size_t size = _mallocHead->size;
-		size       += (uintptr_t) _mallocHead->ptr - (uintptr_t) _mallocHead;
-		_mallocHead = _mallocHead->next;
-
-		if (_mallocHead) {
-			_mallocHead->prev = 0;
-		} else {
-			_mallocTail = 0;
-			sbrk(-size);
-		}
+	Block *block = _getBlock(ptr);
 
-		_updateHeapUsage(-(_mallocHead->size));
-		return;
-	}
+	_stats.usedBytes -= _getSize(block);
+	_stats.allocCount--;
+
+	block->size |= BLOCK_FREE;
+	_insertBlock(_mergeFreeNeighbors(block));
+}
 
-	// Finding the proper block
-	Block *cur = _mallocHead;
+/* Statistics */
 
-	for (cur = _mallocHead; ptr != cur->ptr; cur = cur->next) {
-		if (!cur->next)
-			return;
-	}
+void getHeapStats(HeapStats *stats) {
+	*stats = _stats;
 
-	if (cur->next) {
-		// In the middle, just unlink it
-		(cur->next)->prev = cur->prev;
-	} else {
-		// At the end, shrink heap
-		void  *top  = sbrk(0);
-		size_t size = (top - (cur->prev)->ptr) - (cur->prev)->size;
-		_mallocTail = cur->prev;
+	// The largest free block is in the highest non-empty list, but that list
+	// may contain blocks of different sizes.
+	stats->largestFreeBlock = 0;
 
-		sbrk(-size);
-	}
+	if (!_flBitmap)
+		return;
+
+	int fl = _fls(_flBitmap);
+	int sl = _fls(_slBitmap[fl]);
 
-	_updateHeapUsage(-(cur->size));
-	(cur->prev)->next = cur->next;
+	for (Block *block = _freeLists[fl][sl]; block; block = block->nextFree) {
+		if (_getSize(block) > stats->largestFreeBlock)
+			stats->largestFreeBlock = _getSize(block);
+	}
 }
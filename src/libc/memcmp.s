@@ -0,0 +1,91 @@
+# (C) 2024 Rhys Baker
+#
+# Permission to use, copy, modify, and/or distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+# REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+# AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+# INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+# OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+# PERFORMANCE OF THIS SOFTWARE.
+
+
+.set noreorder
+
+# Optimized memcmp(). If both buffers have the same alignment, they are compared
+# a word at a time once aligned, only falling back to comparing single bytes to
+# find out which byte in a word differs.
+
+.section .text.memcmp, "ax", @progbits
+.global memcmp
+.type memcmp, @function
+
+memcmp:
+	sltiu $t0, $a2, 16 # if ((count < 16) || ((lhs ^ rhs) % 4)) goto byteCompare
+	bnez  $t0, .LbyteCompare
+	xor   $t0, $a0, $a1
+	andi  $t0, 3
+	bnez  $t0, .LbyteCompare
+	andi  $t1, $a0, 3
+
+	# Compare single bytes until both pointers are aligned.
+	beqz  $t1, .LwordCompare
+	li    $t3, 4
+	subu  $t1, $t3, $t1 # align = 4 - (lhs % 4)
+	subu  $a2, $t1 # count -= align
+	addu  $t2, $a0, $t1 # end = lhs + align
+
+.LheadLoop:
+	lbu   $t0, 0($a0)
+	lbu   $t3, 0($a1)
+	addiu $a0, 1
+	bne   $t0, $t3, .Ldifference
+	addiu $a1, 1
+	bne   $a0, $t2, .LheadLoop
+	nop
+
+.LwordCompare:
+	srl   $t2, $a2, 2 # words = count / 4
+	beqz  $t2, .LbyteCompare
+	andi  $a2, 3 # count %= 4
+
+.LwordLoop:
+	lw    $t0, 0($a0)
+	lw    $t3, 0($a1)
+	addiu $t2, -1
+	bne   $t0, $t3, .LwordDiffers
+	addiu $a0, 4
+	bnez  $t2, .LwordLoop
+	addiu $a1, 4
+
+	b     .LbyteCompare
+	nop
+
+.LwordDiffers:
+	# Go back to the start of the word and find the first byte that differs.
+	addiu $a0, -4
+	li    $a2, 4
+
+.LbyteCompare:
+	beqz  $a2, .Lequal
+	addu  $t2, $a0, $a2 # end = lhs + count
+
+.LbyteLoop:
+	lbu   $t0, 0($a0)
+	lbu   $t3, 0($a1)
+	addiu $a0, 1
+	bne   $t0, $t3, .Ldifference
+	addiu $a1, 1
+	bne   $a0, $t2, .LbyteLoop
+	nop
+
+.Lequal:
+	jr    $ra
+	li    $v0, 0
+
+.Ldifference:
+	jr    $ra
+	subu  $v0, $t0, $t3
@@ -0,0 +1,214 @@
+# (C) 2024 Rhys Baker
+#
+# Permission to use, copy, modify, and/or distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+# REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+# AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+# INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+# OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+# PERFORMANCE OF THIS SOFTWARE.
+
+
+.set noreorder
+
+# Optimized memcpy() and memmove(). If the source and destination have the same
+# alignment, both are aligned by copying the first 1-4 bytes with an unaligned
+# load/store pair and the rest is copied 16 bytes at a time. Otherwise the
+# destination is aligned and the source is read using lwl/lwr pairs. Any bytes
+# left over at the end are copied one at a time.
+
+.section .text.memcpy, "ax", @progbits
+.global memcpy
+.type memcpy, @function
+
+memcpy:
+	# Copies of less than 16 bytes aren't worth aligning, so just do them a
+	# byte at a time.
+	sltiu $t0, $a2, 16
+	bnez  $t0, .LbyteCopy
+	move  $v0, $a0 # returnValue = dest
+
+	xor   $t0, $a0, $a1 # if ((dest ^ src) % 4) goto unalignedCopy
+	andi  $t0, 3
+	bnez  $t0, .LunalignedCopy
+	andi  $t1, $a0, 3
+
+	# Copy the first 1-4 bytes (lwr/swr only touch the bytes up to the end of
+	# the word) and update dest, src and count accordingly.
+	lwr   $t0, 0($a1)
+	addiu $t1, -4 # align = 4 - (dest % 4)
+	addu  $a2, $t1 # count -= align
+	swr   $t0, 0($a0)
+	subu  $a0, $t1 # dest += align
+	subu  $a1, $t1 # src += align
+
+	srl   $t2, $a2, 4 # blocks = count / 16
+	beqz  $t2, .LalignedWords
+	andi  $a2, 15 # count %= 16
+
+.LalignedBlockLoop:
+	lw    $t0, 0x0($a1)
+	lw    $t1, 0x4($a1)
+	lw    $t3, 0x8($a1)
+	lw    $t4, 0xc($a1)
+	addiu $t2, -1
+	sw    $t0, 0x0($a0)
+	sw    $t1, 0x4($a0)
+	sw    $t3, 0x8($a0)
+	sw    $t4, 0xc($a0)
+	addiu $a1, 16
+	bnez  $t2, .LalignedBlockLoop
+	addiu $a0, 16
+
+.LalignedWords:
+	srl   $t2, $a2, 2 # words = count / 4
+	beqz  $t2, .LbyteCopy
+	andi  $a2, 3 # count %= 4
+
+.LalignedWordLoop:
+	lw    $t0, 0($a1)
+	addiu $t2, -1
+	addiu $a1, 4
+	sw    $t0, 0($a0)
+	bnez  $t2, .LalignedWordLoop
+	addiu $a0, 4
+
+.LbyteCopy:
+	beqz  $a2, .Lreturn
+	addu  $t2, $a0, $a2 # end = dest + count
+
+.LbyteLoop:
+	lbu   $t0, 0($a1)
+	addiu $a1, 1
+	addiu $a0, 1
+	bne   $a0, $t2, .LbyteLoop
+	sb    $t0, -1($a0)
+
+.Lreturn:
+	jr    $ra
+	nop
+
+.LunalignedCopy:
+	# Copy single bytes until dest is aligned. src will still be unaligned
+	# afterwards, so it has to be read with lwl/lwr.
+	beqz  $t1, .LunalignedBlocks
+	li    $t3, 4
+	subu  $t1, $t3, $t1 # align = 4 - (dest % 4)
+	subu  $a2, $t1 # count -= align
+	addu  $t2, $a0, $t1 # end = dest + align
+
+.LunalignedHeadLoop:
+	lbu   $t0, 0($a1)
+	addiu $a1, 1
+	addiu $a0, 1
+	bne   $a0, $t2, .LunalignedHeadLoop
+	sb    $t0, -1($a0)
+
+.LunalignedBlocks:
+	srl   $t2, $a2, 4 # blocks = count / 16
+	beqz  $t2, .LunalignedWords
+	andi  $a2, 15 # count %= 16
+
+.LunalignedBlockLoop:
+	lwr   $t0, 0x0($a1)
+	lwl   $t0, 0x3($a1)
+	lwr   $t1, 0x4($a1)
+	lwl   $t1, 0x7($a1)
+	lwr   $t3, 0x8($a1)
+	lwl   $t3, 0xb($a1)
+	lwr   $t4, 0xc($a1)
+	lwl   $t4, 0xf($a1)
+	addiu $t2, -1
+	sw    $t0, 0x0($a0)
+	sw    $t1, 0x4($a0)
+	sw    $t3, 0x8($a0)
+	sw    $t4, 0xc($a0)
+	addiu $a1, 16
+	bnez  $t2, .LunalignedBlockLoop
+	addiu $a0, 16
+
+.LunalignedWords:
+	srl   $t2, $a2, 2 # words = count / 4
+	beqz  $t2, .LbyteCopy
+	andi  $a2, 3 # count %= 4
+
+.LunalignedWordLoop:
+	lwr   $t0, 0($a1)
+	lwl   $t0, 3($a1)
+	addiu $t2, -1
+	addiu $a1, 4
+	sw    $t0, 0($a0)
+	bnez  $t2, .LunalignedWordLoop
+	addiu $a0, 4
+
+	b     .LbyteCopy
+	nop
+
+# memmove() only needs to do anything different if dest overlaps the end of
+# src, in which case it copies backwards. This is only done a word at a time
+# if both pointers have the same alignment.
+
+.section .text.memmove, "ax", @progbits
+.global memmove
+.type memmove, @function
+
+memmove:
+	subu  $t0, $a0, $a1 # if ((dest - src) >= count) goto memcpy
+	sltu  $t0, $t0, $a2
+	beqz  $t0, memcpy
+	move  $v0, $a0 # returnValue = dest
+	beq   $a0, $a1, .LbackwardReturn
+
+	addu  $a0, $a2 # dest += count
+	addu  $a1, $a2 # src += count
+
+	xor   $t0, $a0, $a1 # if ((dest ^ src) % 4) goto backwardBytes
+	andi  $t0, 3
+	bnez  $t0, .LbackwardBytes
+	sltiu $t1, $a2, 16
+	bnez  $t1, .LbackwardBytes
+	andi  $t1, $a0, 3 # align = dest % 4
+
+	# Copy the last few bytes until the end of dest is aligned.
+	beqz  $t1, .LbackwardWords
+	subu  $a2, $t1 # count -= align
+	subu  $t2, $a0, $t1 # end = dest - align
+
+.LbackwardTailLoop:
+	lbu   $t0, -1($a1)
+	addiu $a1, -1
+	addiu $a0, -1
+	bne   $a0, $t2, .LbackwardTailLoop
+	sb    $t0, 0($a0)
+
+.LbackwardWords:
+	srl   $t2, $a2, 2 # words = count / 4
+	beqz  $t2, .LbackwardBytes
+	andi  $a2, 3 # count %= 4
+
+.LbackwardWordLoop:
+	lw    $t0, -4($a1)
+	addiu $t2, -1
+	addiu $a1, -4
+	addiu $a0, -4
+	bnez  $t2, .LbackwardWordLoop
+	sw    $t0, 0($a0)
+
+.LbackwardBytes:
+	beqz  $a2, .LbackwardReturn
+	subu  $t2, $a0, $a2 # end = dest - count
+
+.LbackwardByteLoop:
+	lbu   $t0, -1($a1)
+	addiu $a1, -1
+	addiu $a0, -1
+	bne   $a0, $t2, .LbackwardByteLoop
+	sb    $t0, 0($a0)
+
+.LbackwardReturn:
+	jr    $ra
+	nop
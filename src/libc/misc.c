@@ -19,7 +19,7 @@
 
 /* Serial port stdin/stdout */
 
-void initSerialIO(int baud) {
+__attribute__((cold)) void initSerialIO(int baud) {
 	SIO_CTRL(1) = SIO_CTRL_RESET;
 
 	SIO_MODE(1) = SIO_MODE_BAUD_DIV16 | SIO_MODE_DATA_8 | SIO_MODE_STOP_1;
@@ -27,7 +27,7 @@ void initSerialIO(int baud) {
 	SIO_CTRL(1) = SIO_CTRL_TX_ENABLE | SIO_CTRL_RX_ENABLE | SIO_CTRL_RTS;
 }
 
-void _putchar(char ch) {
+void _putcharBlocking(char ch) {
 	// The serial interface will buffer but not send any data if the CTS input
 	// is not asserted, so we are going to abort if CTS is not set to avoid
 	// waiting forever.
@@ -40,6 +40,30 @@ void _putchar(char ch) {
 		SIO_DATA(1) = ch;
 }
 
+static PutcharHandler _putHandler   = &_putcharBlocking;
+static FlushHandler   _flushHandler = 0;
+
+void setSerialOutputHandlers(
+	PutcharHandler putHandler, FlushHandler flushHandler
+) {
+	_putHandler   = putHandler ? putHandler : &_putcharBlocking;
+	_flushHandler = flushHandler;
+}
+
+void flushSerialOutput(void) {
+	if (_flushHandler)
+		_flushHandler();
+}
+
+void resetSerialOutput(void) {
+	flushSerialOutput();
+	setSerialOutputHandlers(0, 0);
+}
+
+void _putchar(char ch) {
+	_putHandler(ch);
+}
+
 int _getchar(void) {
 	while (!(SIO_STAT(1) & SIO_STAT_RX_NOT_EMPTY))
 		__asm__ volatile("");
@@ -59,8 +83,13 @@ int _puts(const char *str) {
 
 /* Abort functions */
 
-void _assertAbort(const char *file, int line, const char *expr) {
+// Output may be queued behind a handler that relies on interrupts, which might
+// be disabled at this point, so switch back to blocking output first.
+__attribute__((cold)) void _assertAbort(
+	const char *file, int line, const char *expr
+) {
 #ifndef NDEBUG
+	resetSerialOutput();
 	printf("%s:%d: assert(%s)\n", file, line, expr);
 #endif
 
@@ -68,8 +97,9 @@ void _assertAbort(const char *file, int line, const char *expr) {
 		__asm__ volatile("");
 }
 
-void abort(void) {
+__attribute__((cold)) void abort(void) {
 #ifndef NDEBUG
+	resetSerialOutput();
 	puts("abort()");
 #endif
 
@@ -77,8 +107,9 @@ void abort(void) {
 		__asm__ volatile("");
 }
 
-void __cxa_pure_virtual(void) {
+__attribute__((cold)) void __cxa_pure_virtual(void) {
 #ifndef NDEBUG
+	resetSerialOutput();
 	puts("__cxa_pure_virtual()");
 #endif
 
@@ -36,6 +36,36 @@ extern "C" {
  */
 void initSerialIO(int baud);
 
+typedef void (*PutcharHandler)(char ch);
+typedef void (*FlushHandler)(void);
+
+/**
+ * @brief Redirects putchar(), puts() and printf() to the given function, for
+ * instance to queue output in a buffer instead of waiting for the serial port.
+ * The flush function must send everything queued so far, even if interrupts
+ * are disabled. Passing a null put handler restores the default behavior of
+ * writing directly to the serial port.
+ *
+ * @param putHandler
+ * @param flushHandler
+ */
+void setSerialOutputHandlers(
+	PutcharHandler putHandler, FlushHandler flushHandler
+);
+
+/**
+ * @brief Waits for any output queued by the current handler to be sent.
+ */
+void flushSerialOutput(void);
+
+/**
+ * @brief Flushes any queued output and goes back to writing directly to the
+ * serial port. Called before printing anything when the program is about to
+ * halt.
+ */
+void resetSerialOutput(void);
+
+void _putcharBlocking(char ch);
 void _putchar(char ch);
 int _getchar(void);
 int _puts(const char *str);
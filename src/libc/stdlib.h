@@ -19,6 +19,17 @@
 #include <stddef.h>
 #include <stdint.h>
 
+// Non-standard heap usage report filled in by getHeapStats(). All sizes are in
+// bytes and exclude the 8-byte header malloc() places in front of each block.
+typedef struct {
+	size_t heapSize;         // Total memory obtained through sbrk()
+	size_t usedBytes;        // Currently allocated
+	size_t peakUsedBytes;    // Highest value usedBytes has ever reached
+	size_t freeBytes;        // Free, but still part of the heap
+	size_t largestFreeBlock; // Biggest allocation possible without growing
+	size_t allocCount;       // Number of live allocations
+} HeapStats;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -41,6 +52,7 @@ void *malloc(size_t size);
 void *calloc(size_t num, size_t size);
 void *realloc(void *ptr, size_t size);
 void free(void *ptr);
+void getHeapStats(HeapStats *stats);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,83 @@
+# (C) 2024 Rhys Baker
+#
+# Permission to use, copy, modify, and/or distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+# REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+# AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+# INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+# OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+# PERFORMANCE OF THIS SOFTWARE.
+
+
+.set noreorder
+
+# Optimized strcmp(). If both strings have the same alignment, they are compared
+# a word at a time once aligned, using the same zero byte check as strlen().
+# Bytes are compared as unsigned, as required by the C standard.
+
+.section .text.strcmp, "ax", @progbits
+.global strcmp
+.type strcmp, @function
+
+strcmp:
+	xor   $t0, $a0, $a1 # if ((lhs ^ rhs) % 4) goto byteLoop
+	andi  $t0, 3
+	bnez  $t0, .LbyteLoop
+	lui   $t4, 0x0101
+	ori   $t4, 0x0101 # ones = 0x01010101
+	sll   $t5, $t4, 7 # highs = 0x80808080
+
+.LheadLoop:
+	# Compare single bytes until both pointers are aligned.
+	andi  $t0, $a0, 3
+	beqz  $t0, .LwordLoop
+	nop
+	lbu   $t1, 0($a0)
+	lbu   $t2, 0($a1)
+	addiu $a0, 1
+	bne   $t1, $t2, .Ldifference
+	addiu $a1, 1
+	bnez  $t1, .LheadLoop
+	nop
+
+	jr    $ra
+	li    $v0, 0
+
+.LwordLoop:
+	# Keep going as long as the words are equal and neither contains the
+	# terminator. Otherwise, compare the word's bytes one by one.
+	lw    $t1, 0($a0)
+	lw    $t2, 0($a1)
+	subu  $t3, $t1, $t4
+	nor   $t0, $t1, $zero
+	and   $t3, $t0
+	and   $t3, $t5
+	xor   $t0, $t1, $t2
+	or    $t3, $t0
+	bnez  $t3, .LwordEnd
+	addiu $a0, 4
+	b     .LwordLoop
+	addiu $a1, 4
+
+.LwordEnd:
+	addiu $a0, -4
+
+.LbyteLoop:
+	lbu   $t1, 0($a0)
+	lbu   $t2, 0($a1)
+	addiu $a0, 1
+	bne   $t1, $t2, .Ldifference
+	addiu $a1, 1
+	bnez  $t1, .LbyteLoop
+	nop
+
+	jr    $ra
+	li    $v0, 0
+
+.Ldifference:
+	jr    $ra
+	subu  $v0, $t1, $t2
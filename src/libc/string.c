@@ -73,6 +73,7 @@ void *memset(void *dest, int ch, size_t count) {
 }
 #endif
 
+#if 0
 void *memcpy(void *restrict dest, const void *restrict src, size_t count) {
 	uint8_t       *_dest = (uint8_t *) dest;
 	const uint8_t *_src  = (const uint8_t *) src;
@@ -82,6 +83,7 @@ void *memcpy(void *restrict dest, const void *restrict src, size_t count) {
 
 	return dest;
 }
+#endif
 
 void *memccpy(void *restrict dest, const void *restrict src, int ch, size_t count) {
 	uint8_t       *_dest = (uint8_t *) dest;
@@ -98,6 +100,7 @@ void *memccpy(void *restrict dest, const void *restrict src, int ch, size_t coun
 	return 0;
 }
 
+#if 0
 void *memmove(void *dest, const void *src, size_t count) {
 	uint8_t       *_dest = (uint8_t *) dest;
 	const uint8_t *_src  = (const uint8_t *) src;
@@ -120,7 +123,9 @@ void *memmove(void *dest, const void *src, size_t count) {
 
 	return dest;
 }
+#endif
 
+#if 0
 int memcmp(const void *lhs, const void *rhs, size_t count) {
 	const uint8_t *_lhs = (const uint8_t *) lhs;
 	const uint8_t *_rhs = (const uint8_t *) rhs;
@@ -134,6 +139,7 @@ int memcmp(const void *lhs, const void *rhs, size_t count) {
 
 	return 0;
 }
+#endif
 
 void *memchr(const void *ptr, int ch, size_t count) {
 	const uint8_t *_ptr = (const uint8_t *) ptr;
@@ -169,6 +175,7 @@ char *strncpy(char *restrict dest, const char *restrict src, size_t count) {
 	return dest;
 }
 
+#if 0
 int strcmp(const char *lhs, const char *rhs) {
 	for (;;) {
 		char a = *(lhs++), b = *(rhs++);
@@ -179,6 +186,7 @@ int strcmp(const char *lhs, const char *rhs) {
 			return 0;
 	}
 }
+#endif
 
 int strncmp(const char *lhs, const char *rhs, size_t count) {
 	for (; count && *lhs && *rhs; count--) {
@@ -239,6 +247,7 @@ char *strstr(const char *str, const char *substr) {
 	return 0;
 }
 
+#if 0
 size_t strlen(const char *str) {
 	size_t length = 0;
 
@@ -247,6 +256,7 @@ size_t strlen(const char *str) {
 
 	return length;
 }
+#endif
 
 // Non-standard, used internally
 size_t strnlen(const char *str, size_t count) {
@@ -0,0 +1,69 @@
+# (C) 2024 Rhys Baker
+#
+# Permission to use, copy, modify, and/or distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+# REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+# AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+# INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+# OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+# PERFORMANCE OF THIS SOFTWARE.
+
+
+.set noreorder
+
+# Optimized strlen(). Once aligned, the string is scanned a word at a time
+# using the usual (word - 0x01010101) & ~word & 0x80808080 trick, which is
+# non-zero if and only if any of the word's bytes is zero. Reading the rest of
+# the word past the terminator is safe, as it can't cross into another page.
+
+.section .text.strlen, "ax", @progbits
+.global strlen
+.type strlen, @function
+
+strlen:
+	move  $v0, $a0 # ptr = str
+
+.LheadLoop:
+	# Check single bytes until ptr is aligned.
+	andi  $t0, $v0, 3
+	beqz  $t0, .LwordScan
+	lbu   $t1, 0($v0)
+	nop
+	beqz  $t1, .Lreturn
+	nop
+	b     .LheadLoop
+	addiu $v0, 1
+
+.LwordScan:
+	lui   $t2, 0x0101
+	ori   $t2, 0x0101 # ones = 0x01010101
+	sll   $t3, $t2, 7 # highs = 0x80808080
+
+.LwordLoop:
+	lw    $t0, 0($v0)
+	nop
+	subu  $t1, $t0, $t2
+	nor   $t0, $t0, $zero
+	and   $t1, $t0
+	and   $t1, $t3
+	beqz  $t1, .LwordLoop
+	addiu $v0, 4
+
+	# The word we just skipped contains the terminator, find it.
+	addiu $v0, -4
+
+.LtailLoop:
+	lbu   $t1, 0($v0)
+	nop
+	bnez  $t1, .LtailLoop
+	addiu $v0, 1
+
+	addiu $v0, -1
+
+.Lreturn:
+	jr    $ra
+	subu  $v0, $a0 # return ptr - str
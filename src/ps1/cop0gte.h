@@ -18,6 +18,34 @@
 
 #include <stdint.h>
 
+#ifdef PS1_HOST
+
+// When building for a PC, coprocessor accesses are routed to the software
+// implementation in src/host/ instead (see include/hal.h).
+#include "include/hal.h"
+
+#define COP0_GET(reg, output) \
+	((output) = (__typeof__(output)) (uintptr_t) hal_cop0Get(reg))
+#define COP0_SET(reg, input) \
+	hal_cop0Set(reg, (uint32_t) (uintptr_t) (input))
+
+#define GTE_GET(reg, output) \
+	((output) = (__typeof__(output)) hal_gteGetData(reg))
+#define GTE_SET(reg, input) \
+	hal_gteSetData(reg, (uint32_t) (input))
+
+#define GTE_GETC(reg, output) \
+	((output) = (__typeof__(output)) hal_gteGetControl(reg))
+#define GTE_SETC(reg, input) \
+	hal_gteSetControl(reg, (uint32_t) (input))
+
+#define GTE_LOAD(reg, offset, ptr) \
+	hal_gteSetData(reg, *((const uint32_t *) ((const uint8_t *) (ptr) + (offset))))
+#define GTE_STORE(reg, offset, ptr) \
+	(*((uint32_t *) ((uint8_t *) (ptr) + (offset))) = hal_gteGetData(reg))
+
+#else
+
 #define COP0_GET(reg, output) \
 	__asm__ volatile("mfc0 %0, $%1\n" :  "=r"(output) : "i"(reg))
 #define COP0_SET(reg, input) \
@@ -38,6 +66,8 @@
 #define GTE_STORE(reg, offset, ptr) \
 	__asm__ volatile("swc2 $%0, %1(%2)\n" :: "i"(reg), "i"(offset), "r"(ptr) : "memory")
 
+#endif
+
 /* Coprocessor 0 */
 
 typedef enum {
@@ -178,8 +208,12 @@ typedef struct {
 	uint8_t _padding[2];
 } GTEMatrix;
 
+#ifdef PS1_HOST
+#define gte_command(cmd) hal_gteCommand(cmd)
+#else
 #define gte_command(cmd) \
 	__asm__ volatile("nop\n" "nop\n" "cop2 %0\n" :: "i"(cmd))
+#endif
 
 /* GTE control registers */
 
@@ -308,6 +342,11 @@ static inline void gte_setZScaleFactor(unsigned int scale) {
 	GTE_SETC(GTE_ZSF3, z3);
 	GTE_SETC(GTE_ZSF4, z4);
 }
+static inline uint32_t gte_getFlags(void) {
+	uint32_t value;
+	GTE_GETC(GTE_FLAG, value);
+	return value;
+}
 
 /* GTE data registers */
 
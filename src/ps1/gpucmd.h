@@ -20,18 +20,26 @@
 #include <stddef.h>
 #include <stdint.h>
 
+// In C++ these are also constexpr, so they can be used to define constants
+// (see include/packet.hpp). DMA tags contain a pointer, so they can't be.
+#ifdef __cplusplus
+#define DEF16 static constexpr inline uint16_t __attribute__((always_inline))
+#define DEF32 static constexpr inline uint32_t __attribute__((always_inline))
+#else
 #define DEF16 static inline uint16_t __attribute__((always_inline))
 #define DEF32 static inline uint32_t __attribute__((always_inline))
+#endif
+#define DEFTAG static inline uint32_t __attribute__((always_inline))
 
 /* DMA tags */
 
-DEF32 gp0_tag(size_t length, void *next) {
+DEFTAG gp0_tag(size_t length, void *next) {
 	return 0
-		| (((uint32_t) next   & 0xffffff) <<  0)
+		| (((uint32_t) (uintptr_t) next & 0xffffff) <<  0)
 		| (((uint32_t) length & 0x0000ff) << 24);
 }
 
-DEF32 gp0_endTag(size_t length) {
+DEFTAG gp0_endTag(size_t length) {
 	return gp0_tag(length, (void *) 0xffffff);
 }
 
@@ -363,3 +371,4 @@ DEF32 gp1_vramSize(GP1VRAMSize size) {
 
 #undef DEF16
 #undef DEF32
+#undef DEFTAG
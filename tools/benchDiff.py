@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""Benchmark result comparison tool
+
+Compares two serial logs captured from the Bench executable and prints how much
+each case's median cycle count changed. Anything outside the "#bench begin" and
+"#bench end" markers is ignored, so raw logs can be passed in as they are.
+Exits with a non-zero status if any case got slower than the threshold allows.
+Requires no external dependencies.
+"""
+
+__version__ = "0.1.0"
+__author__  = "Rhys Baker"
+
+import sys
+from argparse    import ArgumentParser, FileType, Namespace
+from dataclasses import dataclass
+from typing      import TextIO
+
+## Log parser
+
+BEGIN_MARKER: str = "#bench begin"
+END_MARKER:   str = "#bench end"
+
+@dataclass
+class BenchResult:
+	name:   str
+	runs:   int
+	batch:  int
+	median: int
+	min:    int
+	max:    int
+
+def parseLog(_file: TextIO) -> dict[str, BenchResult]:
+	results: dict[str, BenchResult] = {}
+	inside:  bool                   = False
+
+	for line in _file:
+		line = line.strip()
+
+		# If the log contains more than one run, the last one wins.
+		if line == BEGIN_MARKER:
+			inside = True
+			results.clear()
+			continue
+		if line == END_MARKER:
+			inside = False
+			continue
+		if not inside or not line or line.startswith("name,"):
+			continue
+
+		fields: list[str] = line.split(",")
+
+		try:
+			name, runs, batch, median, _min, _max = fields
+			results[name] = BenchResult(
+				name, int(runs), int(batch), int(median), int(_min), int(_max)
+			)
+		except ValueError:
+			raise RuntimeError(f"invalid result line: {line}")
+
+	return results
+
+## Main
+
+def createParser() -> ArgumentParser:
+	parser = ArgumentParser(
+		description = \
+			"Compares two Bench result logs and reports regressions.",
+		add_help    = False
+	)
+
+	group = parser.add_argument_group("Tool options")
+	group.add_argument(
+		"-h", "--help",
+		action = "help",
+		help   = "Show this help message and exit"
+	)
+
+	group = parser.add_argument_group("Comparison options")
+	group.add_argument(
+		"-t", "--threshold",
+		type    = float,
+		default = 5.0,
+		help    = \
+			"Percentage a median may grow by before it's reported as a "
+			"regression (default 5)",
+		metavar = "percent"
+	)
+
+	group = parser.add_argument_group("File paths")
+	group.add_argument(
+		"baseline",
+		type = FileType("rt"),
+		help = "Path to the log to compare against"
+	)
+	group.add_argument(
+		"current",
+		type = FileType("rt"),
+		help = "Path to the log of the build being tested"
+	)
+
+	return parser
+
+def main():
+	parser: ArgumentParser = createParser()
+	args:   Namespace      = parser.parse_args()
+
+	try:
+		with args.baseline as _file:
+			baseline: dict[str, BenchResult] = parseLog(_file)
+		with args.current as _file:
+			current: dict[str, BenchResult] = parseLog(_file)
+	except RuntimeError as err:
+		parser.error(err.args[0])
+
+	if not baseline or not current:
+		parser.error("no results found in one of the logs")
+
+	regressions: int = 0
+
+	print(f"{'case':24} {'before':>9} {'after':>9} {'change':>8}")
+
+	for name, new in current.items():
+		old: BenchResult | None = baseline.get(name)
+
+		if old is None:
+			print(f"{name:24} {'-':>9} {new.median:9} {'new':>8}")
+			continue
+
+		if old.median:
+			change: float = (new.median - old.median) * 100 / old.median
+		else:
+			change: float = 0.0 if not new.median else 100.0
+
+		flag: str = ""
+
+		if change > args.threshold:
+			flag         = "  REGRESSION"
+			regressions += 1
+
+		print(
+			f"{name:24} {old.median:9} {new.median:9} {change:+7.1f}%{flag}"
+		)
+
+	for name in baseline:
+		if name not in current:
+			print(f"{name:24} {baseline[name].median:9} {'-':>9} {'removed':>8}")
+
+	if regressions:
+		print(f"{regressions} case(s) regressed by more than {args.threshold}%")
+		sys.exit(1)
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,537 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""Frame capture reassembly tool
+
+Extracts the DMA chain captures sent by captureChain() (src/include/capture.c)
+from a serial log, checks their integrity and saves them as chain files that
+gpuCost.py can analyze. A summary of how many packets and words ended up in
+each ordering table bucket is printed for the selected capture. Input
+recordings sent by sendInputRecording() (src/include/replay.c) are extracted
+the same way, and can be embedded into FirstPersonCamera through the
+PSX_INPUT_RECORDING CMake option. Captures can also be requested directly from
+the console if pyserial is installed; reading from a saved log requires no
+external dependencies.
+"""
+
+__version__ = "0.1.0"
+__author__  = "Rhys Baker"
+
+import struct, sys, zlib
+from argparse    import ArgumentParser, FileType, Namespace
+from dataclasses import dataclass, field
+from typing      import BinaryIO, Iterator
+
+## Block parser
+
+# These must match capture.h.
+SYNC:           bytes = b"\xa5\x5a"
+VERSION:        int   = 1
+BLOCK_SIZE:     int   = 1024
+SERIAL_COMMAND: bytes = b"C"
+
+BLOCK_BEGIN:       int = 1
+BLOCK_TABLE:       int = 2
+BLOCK_DATA:        int = 3
+BLOCK_END:         int = 4
+BLOCK_INPUT_BEGIN: int = 5
+BLOCK_INPUT:       int = 6
+
+BLOCK_HEADER_STRUCT: struct.Struct = struct.Struct("< 2s B B H")
+CAPTURE_STRUCT:      struct.Struct = struct.Struct("< 2H 7I 3i 4h")
+INPUT_STRUCT:        struct.Struct = struct.Struct("< I 2H 2I")
+
+# Chain files saved by this tool start with this magic string, followed by
+# the CaptureHeader structure as sent by the console, the ordering table and
+# the packet data.
+CHAIN_FILE_MAGIC: bytes = b"PS1CHAIN"
+
+@dataclass
+class Block:
+	offset:   int # Position in the log
+	type:     int
+	sequence: int
+	payload:  bytes
+
+def parseBlocks(data: bytes) -> Iterator[Block]:
+	"""
+	Finds every block with a valid checksum in the given data. Anything else,
+	such as printf() output, is skipped over.
+	"""
+
+	offset: int = 0
+
+	while (offset := data.find(SYNC, offset)) >= 0:
+		end: int = offset + BLOCK_HEADER_STRUCT.size
+
+		if end > len(data):
+			break
+
+		_, _type, sequence, length = \
+			BLOCK_HEADER_STRUCT.unpack_from(data, offset)
+
+		if (length > BLOCK_SIZE) or ((end + length + 4) > len(data)):
+			offset += 1
+			continue
+
+		crc, = struct.unpack_from("<I", data, end + length)
+
+		if zlib.crc32(data[offset:end + length]) != crc:
+			offset += 1
+			continue
+
+		yield Block(offset, _type, sequence, data[end:end + length])
+		offset = end + length + 4
+
+## Capture reassembly
+
+@dataclass
+class Capture:
+	frame:          int
+	tableAddress:   int
+	tableEntries:   int
+	dataAddress:    int
+	dataWords:      int
+	flushedWords:   int
+	droppedPackets: int
+	camera:         tuple[int, ...]
+	header:         bytes
+
+	table:    bytearray = field(default_factory = bytearray)
+	data:     bytearray = field(default_factory = bytearray)
+	errors:   list[str] = field(default_factory = list)
+	complete: bool      = False
+
+	def getTableWord(self, index: int) -> int:
+		return struct.unpack_from("<I", self.table, index * 4)[0]
+
+	def readWord(self, address: int) -> int:
+		tableOffset: int = address - self.tableAddress
+		dataOffset:  int = address - self.dataAddress
+
+		if 0 <= tableOffset < len(self.table):
+			return struct.unpack_from("<I", self.table, tableOffset)[0]
+		if 0 <= dataOffset < len(self.data):
+			return struct.unpack_from("<I", self.data, dataOffset)[0]
+
+		raise RuntimeError(f"address {address:06x} is outside the capture")
+
+	def save(self, _file: BinaryIO):
+		_file.write(CHAIN_FILE_MAGIC)
+		_file.write(self.header)
+		_file.write(self.table)
+		_file.write(self.data)
+
+@dataclass
+class InputRecording:
+	tickCount: int
+	tickSize:  int
+	header:    bytes
+
+	ticks:    bytearray = field(default_factory = bytearray)
+	errors:   list[str] = field(default_factory = list)
+	complete: bool      = False
+
+	def save(self, _file: BinaryIO):
+		# Saved as is, so the file can be embedded and replayed directly.
+		_file.write(self.header)
+		_file.write(self.ticks)
+
+def _fillBuffer(
+	capture: Capture | InputRecording, buffer: bytearray, payload: bytes,
+	name: str
+):
+	offset, = struct.unpack_from("<I", payload, 0)
+	chunk   = payload[4:]
+
+	if (offset + len(chunk)) > len(buffer):
+		capture.errors.append(f"{name} block at {offset:#x} is out of bounds")
+		return
+
+	buffer[offset:offset + len(chunk)] = chunk
+
+def assembleCaptures(
+	blocks: Iterator[Block]
+) -> list[Capture | InputRecording]:
+	captures: list[Capture | InputRecording] = []
+	current:  Capture | InputRecording | None = None
+	sequence: int                             = 0
+
+	for block in blocks:
+		if block.type == BLOCK_INPUT_BEGIN:
+			if current is not None:
+				current.errors.append("capture was interrupted")
+
+			_, version, tickSize, tickCount, _ = \
+				INPUT_STRUCT.unpack_from(block.payload, 0)
+
+			if version != VERSION:
+				sys.stderr.write(
+					f"warning: skipping input recording with unsupported "
+					f"version {version}\n"
+				)
+				current = None
+				continue
+
+			current  = InputRecording(tickCount, tickSize, block.payload)
+			sequence = block.sequence
+
+			current.ticks = bytearray(tickCount * tickSize)
+			captures.append(current)
+			continue
+		if block.type == BLOCK_BEGIN:
+			if current is not None:
+				current.errors.append("capture was interrupted")
+
+			version, size, frame, tableAddress, tableEntries, dataAddress, \
+				dataWords, flushedWords, droppedPackets, *camera = \
+				CAPTURE_STRUCT.unpack_from(block.payload, 0)
+
+			if version != VERSION:
+				sys.stderr.write(
+					f"warning: skipping capture with unsupported version "
+					f"{version}\n"
+				)
+				current = None
+				continue
+
+			current  = Capture(
+				frame, tableAddress, tableEntries, dataAddress, dataWords,
+				flushedWords, droppedPackets, tuple(camera[0:6]),
+				block.payload[0:size]
+			)
+			sequence = block.sequence
+
+			current.table = bytearray(tableEntries * 4)
+			current.data  = bytearray(dataWords * 4)
+			captures.append(current)
+			continue
+
+		if current is None:
+			continue
+
+		# Blocks with a bad checksum have already been thrown away, so a gap in
+		# the sequence numbers means part of the capture is missing.
+		sequence = (sequence + 1) & 0xff
+
+		if block.sequence != sequence:
+			current.errors.append(
+				f"expected block {sequence}, got {block.sequence}"
+			)
+			sequence = block.sequence
+
+		if isinstance(current, InputRecording):
+			if block.type == BLOCK_INPUT:
+				_fillBuffer(current, current.ticks, block.payload, "input")
+		elif block.type == BLOCK_TABLE:
+			_fillBuffer(current, current.table, block.payload, "table")
+		elif block.type == BLOCK_DATA:
+			_fillBuffer(current, current.data, block.payload, "data")
+
+		if block.type == BLOCK_END:
+			crc, = struct.unpack_from("<I", block.payload, 0)
+
+			if isinstance(current, InputRecording):
+				contents: bytes = current.ticks
+			else:
+				contents: bytes = current.table + current.data
+
+			if zlib.crc32(contents) != crc:
+				current.errors.append("checksum of the reassembled capture is wrong")
+
+			current.complete = True
+			current          = None
+
+	return captures
+
+## Bucket summary
+
+def _getCommandName(command: int) -> str:
+	if 0x20 <= command <= 0x3f:
+		return "poly"
+	if 0x40 <= command <= 0x5f:
+		return "line"
+	if 0x60 <= command <= 0x7f:
+		return "rect"
+	if command == 0x02:
+		return "fill"
+	if 0x80 <= command <= 0xdf:
+		return "vram"
+	if 0xe1 <= command <= 0xe6:
+		return "env"
+
+	return "other"
+
+@dataclass
+class Bucket:
+	index:    int
+	packets:  int            = 0
+	words:    int            = 0
+	commands: dict[str, int] = field(default_factory = dict)
+
+def summarizeBuckets(capture: Capture) -> list[Bucket]:
+	"""
+	Walks each ordering table entry's list of packets. Each bucket's list ends
+	where it links back to the next entry in the table.
+	"""
+
+	buckets:  list[Bucket] = []
+	tableEnd: int          = capture.tableAddress + capture.tableEntries * 4
+
+	for index in range(capture.tableEntries - 1, -1, -1):
+		bucket:  Bucket = Bucket(index)
+		address: int    = capture.getTableWord(index) & 0xffffff
+
+		for _ in range(capture.dataWords + 1):
+			if (address & 0x800000) or \
+				(capture.tableAddress <= address < tableEnd):
+				break
+
+			header: int = capture.readWord(address)
+			length: int = header >> 24
+
+			bucket.packets += 1
+			bucket.words   += length + 1
+
+			# Only the packet's first command is counted; this is enough to
+			# tell geometry and text apart from setup packets.
+			if length:
+				name: str = _getCommandName(capture.readWord(address + 4) >> 24)
+				bucket.commands[name] = bucket.commands.get(name, 0) + 1
+
+			address = header & 0xffffff
+		else:
+			raise RuntimeError(f"bucket {index} contains a loop")
+
+		if bucket.packets:
+			buckets.append(bucket)
+
+	return buckets
+
+def printSummary(capture: Capture, buckets: list[Bucket], showAll: bool):
+	x, y, z, pitch, roll, yaw = capture.camera
+
+	print(
+		f"frame {capture.frame}: {capture.dataWords} words of packets, "
+		f"table at {capture.tableAddress:06x}, data at "
+		f"{capture.dataAddress:06x}"
+	)
+	print(f"camera: pos {x},{y},{z} pitch {pitch} roll {roll} yaw {yaw}")
+
+	if capture.flushedWords:
+		print(
+			f"note: {capture.flushedWords} words were flushed earlier in the "
+			f"frame and are not part of the capture"
+		)
+	if capture.droppedPackets:
+		print(f"note: {capture.droppedPackets} packets were dropped")
+
+	totalPackets: int = sum(bucket.packets for bucket in buckets)
+	totalWords:   int = sum(bucket.words   for bucket in buckets)
+
+	print(
+		f"{len(buckets)} of {capture.tableEntries} buckets used, "
+		f"{totalPackets} packets, {totalWords} words\n"
+	)
+
+	if not buckets:
+		return
+
+	busiest: int = max(bucket.words for bucket in buckets)
+	print(f"{'bucket':>6} {'packets':>7} {'words':>6}  commands")
+
+	for bucket in buckets:
+		# Unless asked for every bucket, only list the ones with at least a
+		# tenth of the busiest one's words.
+		if not showAll and (bucket.words * 10) < busiest:
+			continue
+
+		commands: str = " ".join(
+			f"{name}:{count}" for name, count in sorted(bucket.commands.items())
+		)
+		print(f"{bucket.index:6} {bucket.packets:7} {bucket.words:6}  {commands}")
+
+## Serial port
+
+def requestCapture(
+	port: str, baudRate: int, timeout: float, command: bytes = SERIAL_COMMAND
+) -> bytes:
+	try:
+		import serial
+	except ImportError:
+		raise RuntimeError("pyserial is required to capture from a serial port")
+
+	data: bytearray = bytearray()
+
+	with serial.Serial(port, baudRate, timeout = timeout) as _port:
+		_port.reset_input_buffer()
+		_port.write(command)
+
+		# Read until the end block of the capture has arrived, or the console
+		# goes quiet for longer than the timeout.
+		while chunk := _port.read(4096):
+			data += chunk
+
+			if any(
+				block.type == BLOCK_END for block in parseBlocks(bytes(data))
+			):
+				break
+
+	return bytes(data)
+
+## Main
+
+def createParser() -> ArgumentParser:
+	parser = ArgumentParser(
+		description = \
+			"Reassembles DMA chain captures and input recordings from a serial "
+			"log and summarizes the captures' ordering table usage.",
+		add_help    = False
+	)
+
+	group = parser.add_argument_group("Tool options")
+	group.add_argument(
+		"-h", "--help",
+		action = "help",
+		help   = "Show this help message and exit"
+	)
+
+	group = parser.add_argument_group("Capture options")
+	group.add_argument(
+		"-p", "--port",
+		type    = str,
+		help    = \
+			"Request a capture over the given serial port instead of reading "
+			"a log (requires pyserial)",
+		metavar = "port"
+	)
+	group.add_argument(
+		"-b", "--baud-rate",
+		type    = int,
+		default = 115200,
+		help    = "Serial port baud rate (default 115200)",
+		metavar = "rate"
+	)
+	group.add_argument(
+		"-t", "--timeout",
+		type    = float,
+		default = 10.0,
+		help    = "Give up if no data arrives for this many seconds (default 10)",
+		metavar = "seconds"
+	)
+	group.add_argument(
+		"-i", "--index",
+		type    = int,
+		default = -1,
+		help    = \
+			"Use the given capture if the log contains more than one (default "
+			"last, negative values count from the end)",
+		metavar = "index"
+	)
+	group.add_argument(
+		"-a", "--all-buckets",
+		action = "store_true",
+		help   = "List every non-empty bucket rather than only the busiest ones"
+	)
+
+	group = parser.add_argument_group("File paths")
+	group.add_argument(
+		"-o", "--output",
+		type    = FileType("wb"),
+		help    = "Save the capture as a chain file for gpuCost.py",
+		metavar = "file"
+	)
+	group.add_argument(
+		"-I", "--input",
+		type    = FileType("wb"),
+		help    = \
+			"Save the last input recording in the log to the given file, for "
+			"use with PSX_INPUT_RECORDING",
+		metavar = "file"
+	)
+	group.add_argument(
+		"log",
+		type  = FileType("rb"),
+		nargs = "?",
+		help  = "Serial log to read captures from"
+	)
+
+	return parser
+
+def main():
+	parser: ArgumentParser = createParser()
+	args:   Namespace      = parser.parse_args()
+
+	try:
+		if args.port is not None:
+			data: bytes = \
+				requestCapture(args.port, args.baud_rate, args.timeout)
+		elif args.log is not None:
+			with args.log as _file:
+				data: bytes = _file.read()
+		else:
+			parser.error("either a log file or --port must be given")
+	except (RuntimeError, OSError) as err:
+		parser.error(str(err))
+
+	entries: list[Capture | InputRecording] = \
+		assembleCaptures(parseBlocks(data))
+
+	captures:   list[Capture]        = [
+		entry for entry in entries if isinstance(entry, Capture)
+	]
+	recordings: list[InputRecording] = [
+		entry for entry in entries if isinstance(entry, InputRecording)
+	]
+
+	if not entries:
+		parser.error("no captures or input recordings found")
+
+	failed: bool = False
+
+	for entry in entries:
+		if not entry.complete:
+			entry.errors.append("capture is incomplete")
+
+	if args.input is not None:
+		if not recordings:
+			parser.error("no input recordings found")
+
+		recording: InputRecording = recordings[-1]
+
+		for error in recording.errors:
+			sys.stderr.write(f"warning: input recording: {error}\n")
+
+		print(f"input recording: {recording.tickCount} ticks\n")
+		failed |= bool(recording.errors)
+
+		with args.input as _file:
+			recording.save(_file)
+
+	if not captures:
+		sys.exit(1 if failed else 0)
+
+	try:
+		capture: Capture = captures[args.index]
+	except IndexError:
+		parser.error(f"log only contains {len(captures)} captures")
+
+	for error in capture.errors:
+		sys.stderr.write(f"warning: {error}\n")
+
+	try:
+		buckets: list[Bucket] = summarizeBuckets(capture)
+	except RuntimeError as err:
+		parser.error(str(err))
+
+	printSummary(capture, buckets, args.all_buckets)
+
+	if args.output is not None:
+		with args.output as _file:
+			capture.save(_file)
+
+	if failed or capture.errors:
+		sys.exit(1)
+
+if __name__ == "__main__":
+	main()
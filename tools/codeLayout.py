@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""Instruction cache budget report
+
+Reads the symbol table of an executable built with cmake/executable.ld and
+reports how much space the hot code region (functions marked HOT, see
+src/include/cache.h) takes up compared to the R3000's 4 KB instruction cache,
+along with the largest hot functions and the size of the cold region. Run
+automatically after each build. Requires no external dependencies.
+"""
+
+__version__ = "0.1.0"
+__author__  = "Rhys Baker"
+
+import sys
+from argparse    import ArgumentParser, FileType, Namespace
+from dataclasses import dataclass
+
+from sampleProfile import STT_FUNC, STT_NOTYPE, Symbol, readSymbols
+
+## Layout parser
+
+ICACHE_SIZE: int = 4096
+
+@dataclass
+class Region:
+	start: int
+	end:   int
+
+	functions: list[Symbol]
+
+	def getSize(self) -> int:
+		return self.end - self.start
+
+def getRegion(symbols: list[Symbol], name: str) -> Region:
+	markers: dict[str, int] = {
+		symbol.name: symbol.address for symbol in symbols
+		if symbol._type == STT_NOTYPE
+	}
+
+	try:
+		start: int = markers[f"_{name}TextStart"]
+		end:   int = markers[f"_{name}TextEnd"]
+	except KeyError:
+		raise RuntimeError(
+			f"no {name} code region found, was the executable linked with "
+			f"cmake/executable.ld?"
+		)
+
+	functions: list[Symbol] = [
+		symbol for symbol in symbols
+		if symbol._type == STT_FUNC and start <= symbol.address < end
+	]
+
+	# Functions written in assembly usually have no size, so assume they
+	# extend up to the next one.
+	for index, symbol in enumerate(functions):
+		if not symbol.size:
+			nextAddress: int = \
+				functions[index + 1].address if (index + 1) < len(functions) \
+				else end
+			symbol.size = nextAddress - symbol.address
+
+	functions.sort(key = lambda symbol: -symbol.size)
+	return Region(start, end, functions)
+
+## Main
+
+def createParser() -> ArgumentParser:
+	parser = ArgumentParser(
+		description = \
+			"Reports how much of the instruction cache an executable's hot code "
+			"takes up.",
+		add_help    = False
+	)
+
+	group = parser.add_argument_group("Tool options")
+	group.add_argument(
+		"-h", "--help",
+		action = "help",
+		help   = "Show this help message and exit"
+	)
+
+	group = parser.add_argument_group("Report options")
+	group.add_argument(
+		"-b", "--budget",
+		type    = int,
+		default = ICACHE_SIZE,
+		help    = \
+			f"Size hot code must fit in, in bytes (default {ICACHE_SIZE})",
+		metavar = "bytes"
+	)
+	group.add_argument(
+		"-n", "--top",
+		type    = int,
+		default = 10,
+		help    = "Number of hot functions to list (default 10)",
+		metavar = "count"
+	)
+	group.add_argument(
+		"-s", "--strict",
+		action = "store_true",
+		help   = "Exit with a non-zero status if hot code is over budget"
+	)
+
+	group = parser.add_argument_group("File paths")
+	group.add_argument(
+		"elf",
+		type = FileType("rb"),
+		help = "Executable to check, in ELF format"
+	)
+
+	return parser
+
+def main():
+	parser: ArgumentParser = createParser()
+	args:   Namespace      = parser.parse_args()
+
+	try:
+		with args.elf as _file:
+			symbols: list[Symbol] = \
+				readSymbols(_file, ( STT_NOTYPE, STT_FUNC ))
+
+		hot:  Region = getRegion(symbols, "hot")
+		cold: Region = getRegion(symbols, "cold")
+	except RuntimeError as err:
+		parser.error(str(err))
+
+	hotSize: int = hot.getSize()
+
+	print(
+		f"hot code:  {hotSize:6} / {args.budget} bytes "
+		f"({hotSize * 100 / args.budget:.1f}%), "
+		f"{len(hot.functions)} function(s)"
+	)
+	print(
+		f"cold code: {cold.getSize():6} bytes, {len(cold.functions)} function(s)"
+	)
+
+	for symbol in hot.functions[0:args.top]:
+		print(f"  {symbol.size:6}  {symbol.name}")
+
+	if hotSize > args.budget:
+		sys.stderr.write(
+			f"warning: hot code is {hotSize - args.budget} bytes over budget, "
+			f"some of it will evict the rest from the cache\n"
+		)
+
+		if args.strict:
+			sys.exit(1)
+
+if __name__ == "__main__":
+	main()
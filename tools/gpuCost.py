@@ -0,0 +1,889 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""GPU command stream cost estimator
+
+Decodes a frame's worth of GP0 commands, rasterizes every primitive into a
+model of the PS1's 1024x512 VRAM and estimates how many GPU cycles each one
+takes based on the number of pixels it touches, its texture depth and whether
+it is semi-transparent. Prints the most expensive primitives, how much of the
+frame time the GPU is busy for and can save an overdraw heatmap as a PNG.
+
+Commands can be read from a recording made by the host build (src/host), from
+a chain file saved by captureDump.py or from a memory dump plus the address of
+the first packet. For the last two, the packets' gp0_tag links are followed
+just like the DMA unit does when sendLinkedList() is called. Requires no
+external dependencies.
+"""
+
+__version__ = "0.1.0"
+__author__  = "Rhys Baker"
+
+import struct, sys, zlib
+from argparse    import ArgumentParser, FileType, Namespace
+from dataclasses import dataclass, field
+from typing      import BinaryIO, Iterator, TextIO
+
+## Cost model
+
+# All costs are in GPU clock cycles. These are estimates rather than exact
+# timings, in line with what emulators use for their GPU timing models:
+# pixels are drawn one per cycle, texture lookups and blending with the
+# framebuffer each add to that, and every command has some fixed overhead.
+GPU_CLOCK: dict[str, float] = {
+	"ntsc": 53693175.0,
+	"pal":  53203425.0
+}
+FRAME_RATE: dict[str, float] = {
+	"ntsc": 59.94,
+	"pal":  50.0
+}
+
+PIXEL_CYCLES:       float            = 1.0
+TEXTURE_CYCLES:     dict[int, float] = { 4: 1.0, 8: 1.25, 15: 1.5 }
+SEMI_TRANS_CYCLES:  float            = 0.5
+SETUP_CYCLES:       dict[str, int]   = {
+	"polygon":   64,
+	"line":      16,
+	"rectangle": 16,
+	"transfer":  32,
+	"other":     2
+}
+FILL_CYCLES_BASE:    int = 46
+FILL_CYCLES_PER_ROW: int = 9
+TRANSFER_CYCLES_PER_WORD: float = 1.0
+
+## VRAM model
+
+VRAM_WIDTH:  int = 1024
+VRAM_HEIGHT: int = 512
+
+class OverdrawMap:
+	"""
+	Counts how many times each VRAM pixel is written to. Primitives are added
+	as horizontal spans to a difference array, which is only turned into
+	actual counts once at the end; this keeps large primitives as cheap to
+	add as small ones.
+	"""
+
+	def __init__(self):
+		self.rows: list[list[int]] = [
+			[ 0 ] * (VRAM_WIDTH + 1) for _ in range(VRAM_HEIGHT)
+		]
+
+	def addSpan(self, y: int, x0: int, x1: int):
+		# x1 is inclusive.
+		row: list[int] = self.rows[y]
+
+		row[x0]     += 1
+		row[x1 + 1] -= 1
+
+	def getCounts(self) -> list[list[int]]:
+		counts: list[list[int]] = []
+
+		for row in self.rows:
+			total:  int       = 0
+			output: list[int] = [ 0 ] * VRAM_WIDTH
+
+			for x in range(VRAM_WIDTH):
+				total    += row[x]
+				output[x] = total
+
+			counts.append(output)
+
+		return counts
+
+@dataclass
+class ClipArea:
+	left:   int = 0
+	top:    int = 0
+	right:  int = VRAM_WIDTH  - 1
+	bottom: int = VRAM_HEIGHT - 1
+
+def _rasterizeTriangle(
+	overdraw: OverdrawMap, clip: ClipArea, v0: tuple[int, int],
+	v1: tuple[int, int], v2: tuple[int, int]
+) -> int:
+	(x0, y0), (x1, y1), (x2, y2) = v0, v1, v2
+
+	area: int = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0)
+
+	if not area:
+		return 0
+	if area < 0:
+		x1, y1, x2, y2 = x2, y2, x1, y1
+
+	# The GPU skips polygons that are too large rather than clipping them.
+	xs: tuple[int, ...] = ( x0, x1, x2 )
+	ys: tuple[int, ...] = ( y0, y1, y2 )
+
+	if (max(xs) - min(xs)) >= 1024 or (max(ys) - min(ys)) >= 512:
+		return 0
+
+	# Each edge is turned into a constraint on x for a given row. Pixels
+	# exactly on an edge are only drawn if it's a top or left edge, as the
+	# GPU never draws the right and bottom edges of a polygon.
+	edges: list[tuple[int, int, int, int, bool]] = []
+
+	for ax, ay, bx, by in ( x0, y0, x1, y1 ), ( x1, y1, x2, y2 ), ( x2, y2, x0, y0 ):
+		a:         int  = ay - by
+		inclusive: bool = (a > 0) or ((a == 0) and (bx > ax))
+
+		edges.append(( a, ax, ay, bx - ax, inclusive ))
+
+	top:    int = max(min(ys), clip.top)
+	bottom: int = min(max(ys), clip.bottom)
+	pixels: int = 0
+
+	for y in range(top, bottom + 1):
+		left:  int = max(min(xs), clip.left)
+		right: int = min(max(xs), clip.right)
+
+		for a, ax, ay, dx, inclusive in edges:
+			# Edge function: a * x + b >= 0 (or > 0 if not inclusive)
+			b: int = dx * (y - ay) - a * ax
+
+			if a > 0:
+				left  = max(left, -(b // a) if inclusive else ((-b) // a) + 1)
+			elif a < 0:
+				right = min(right, b // -a if inclusive else -((-b) // -a) - 1)
+			elif (b < 0) or ((b == 0) and not inclusive):
+				left = right + 1
+				break
+
+		if left <= right:
+			overdraw.addSpan(y, left, right)
+			pixels += right - left + 1
+
+	return pixels
+
+def _rasterizeRectangle(
+	overdraw: OverdrawMap, clip: ClipArea, x: int, y: int, w: int, h: int
+) -> int:
+	left:   int = max(x, clip.left)
+	right:  int = min(x + w - 1, clip.right)
+	top:    int = max(y, clip.top)
+	bottom: int = min(y + h - 1, clip.bottom)
+
+	if (left > right) or (top > bottom):
+		return 0
+
+	for row in range(top, bottom + 1):
+		overdraw.addSpan(row, left, right)
+
+	return (right - left + 1) * (bottom - top + 1)
+
+def _rasterizeLine(
+	overdraw: OverdrawMap, clip: ClipArea, v0: tuple[int, int],
+	v1: tuple[int, int]
+) -> int:
+	(x0, y0), (x1, y1) = v0, v1
+
+	dx:     int = x1 - x0
+	dy:     int = y1 - y0
+	steps:  int = max(abs(dx), abs(dy))
+	pixels: int = 0
+
+	if abs(dx) >= 1024 or abs(dy) >= 512:
+		return 0
+
+	for i in range(steps + 1):
+		x: int = x0 + ((dx * i * 2 + steps) // (steps * 2) if steps else 0)
+		y: int = y0 + ((dy * i * 2 + steps) // (steps * 2) if steps else 0)
+
+		if clip.left <= x <= clip.right and clip.top <= y <= clip.bottom:
+			overdraw.addSpan(y, x, x)
+			pixels += 1
+
+	return pixels
+
+## GP0 command decoder
+
+@dataclass
+class Primitive:
+	index:   int
+	source:  int # Address of the packet, or offset into the stream
+	kind:    str
+	command: int
+	depth:   int   = 0 # Texture color depth, 0 if untextured
+	semi:    bool  = False
+	pixels:  int   = 0
+	cycles:  float = 0.0
+	bounds:  tuple[int, int, int, int] = ( 0, 0, 0, 0 )
+
+	def getName(self) -> str:
+		name: str = self.kind
+
+		if self.depth:
+			name += f" tex{self.depth}"
+		if self.semi:
+			name += " semi"
+
+		return name
+
+def _signExtend11(value: int) -> int:
+	value &= 0x7ff
+	return value - 0x800 if value & 0x400 else value
+
+def _getTextureDepth(texpage: int) -> int:
+	return ( 4, 8, 15, 15 )[(texpage >> 7) & 3]
+
+@dataclass
+class GPUState:
+	clip:    ClipArea = field(default_factory = ClipArea)
+	offsetX: int      = 0
+	offsetY: int      = 0
+	texpage: int      = 0
+
+class CommandDecoder:
+	"""
+	Splits a stream of GP0 words into commands, keeping track of the drawing
+	environment (drawing area, offset and texture page) and rasterizing every
+	drawing command as it goes.
+	"""
+
+	def __init__(self, overdraw: OverdrawMap):
+		self.overdraw:   OverdrawMap     = overdraw
+		self.state:      GPUState        = GPUState()
+		self.primitives: list[Primitive] = []
+
+	def _vertex(self, word: int) -> tuple[int, int]:
+		return (
+			_signExtend11(word)       + self.state.offsetX,
+			_signExtend11(word >> 16) + self.state.offsetY
+		)
+
+	def _addPrimitive(
+		self, source: int, kind: str, command: int, pixels: int,
+		vertices: list[tuple[int, int]], depth: int = 0, semi: bool = False,
+		extra: float = 0.0
+	):
+		perPixel: float = PIXEL_CYCLES
+
+		if depth:
+			perPixel += TEXTURE_CYCLES[depth]
+		if semi:
+			perPixel += SEMI_TRANS_CYCLES
+
+		setup:  str   = kind.split(" ")[0]
+		cycles: float = \
+			SETUP_CYCLES.get(setup, SETUP_CYCLES["other"]) + pixels * perPixel + extra
+
+		if vertices:
+			xs: list[int] = [ x for x, _ in vertices ]
+			ys: list[int] = [ y for _, y in vertices ]
+			bounds: tuple[int, int, int, int] = ( min(xs), min(ys), max(xs), max(ys) )
+		else:
+			bounds: tuple[int, int, int, int] = ( 0, 0, 0, 0 )
+
+		self.primitives.append(Primitive(
+			len(self.primitives), source, kind, command, depth, semi, pixels,
+			cycles, bounds
+		))
+
+	def _polygon(self, source: int, words: list[int]):
+		command:  int  = words[0] >> 24
+		gouraud:  bool = bool(command & 0x10)
+		quad:     bool = bool(command & 0x08)
+		textured: bool = bool(command & 0x04)
+		semi:     bool = bool(command & 0x02)
+
+		vertices: list[tuple[int, int]] = []
+		depth:    int                   = 0
+		offset:   int                   = 1
+
+		for i in range(4 if quad else 3):
+			if gouraud and i:
+				offset += 1
+
+			vertices.append(self._vertex(words[offset]))
+			offset += 1
+
+			if textured:
+				# The second vertex's UV word also holds the texture page.
+				if i == 1:
+					self.state.texpage = words[offset] >> 16
+					depth = _getTextureDepth(self.state.texpage)
+
+				offset += 1
+
+		pixels: int = _rasterizeTriangle(
+			self.overdraw, self.state.clip, *vertices[0:3]
+		)
+		if quad:
+			pixels += _rasterizeTriangle(
+				self.overdraw, self.state.clip, *vertices[1:4]
+			)
+
+		self._addPrimitive(
+			source, "polygon quad" if quad else "polygon tri", command,
+			pixels, vertices, depth, semi
+		)
+
+	def _line(self, source: int, words: list[int]):
+		command:  int  = words[0] >> 24
+		gouraud:  bool = bool(command & 0x10)
+		semi:     bool = bool(command & 0x02)
+
+		vertices: list[tuple[int, int]] = []
+		offset:   int                   = 1
+
+		while offset < len(words):
+			if gouraud and vertices:
+				if (words[offset] & 0xf000f000) == 0x50005000:
+					break
+
+				offset += 1
+
+			if (words[offset] & 0xf000f000) == 0x50005000 and len(vertices) >= 2:
+				break
+
+			vertices.append(self._vertex(words[offset]))
+			offset += 1
+
+		pixels: int = 0
+
+		for i in range(len(vertices) - 1):
+			pixels += _rasterizeLine(
+				self.overdraw, self.state.clip, vertices[i], vertices[i + 1]
+			)
+
+		self._addPrimitive(source, "line", command, pixels, vertices, 0, semi)
+
+	def _rectangle(self, source: int, words: list[int]):
+		command:  int  = words[0] >> 24
+		textured: bool = bool(command & 0x04)
+		semi:     bool = bool(command & 0x02)
+		size:     int  = (command >> 3) & 3
+
+		x, y = self._vertex(words[1])
+
+		if size:
+			w = h = ( 0, 1, 8, 16 )[size]
+		else:
+			sizeWord: int = words[3 if textured else 2]
+			w = sizeWord & 0x3ff
+			h = (sizeWord >> 16) & 0x1ff
+
+		pixels: int = _rasterizeRectangle(
+			self.overdraw, self.state.clip, x, y, w, h
+		)
+		depth:  int = _getTextureDepth(self.state.texpage) if textured else 0
+
+		self._addPrimitive(
+			source, "rectangle", command, pixels,
+			[ ( x, y ), ( x + w - 1, y + h - 1 ) ], depth, semi
+		)
+
+	def _fill(self, source: int, words: list[int]):
+		# Fills ignore the drawing area and offset, and work in 16-pixel wide
+		# units.
+		x: int = words[1] & 0x3f0
+		y: int = (words[1] >> 16) & 0x1ff
+		w: int = ((words[2] & 0x3ff) + 0xf) & ~0xf
+		h: int = (words[2] >> 16) & 0x1ff
+
+		pixels: int = _rasterizeRectangle(self.overdraw, ClipArea(), x, y, w, h)
+
+		self.primitives.append(Primitive(
+			len(self.primitives), source, "fill", words[0] >> 24, 0, False,
+			pixels, FILL_CYCLES_BASE + ((w // 8) + FILL_CYCLES_PER_ROW) * h,
+			( x, y, x + w - 1, y + h - 1 )
+		))
+
+	def _transfer(self, source: int, words: list[int]):
+		self.primitives.append(Primitive(
+			len(self.primitives), source, "transfer", words[0] >> 24, 0,
+			False, 0,
+			SETUP_CYCLES["transfer"] + len(words) * TRANSFER_CYCLES_PER_WORD
+		))
+
+	def _environment(self, words: list[int]):
+		command: int = words[0] >> 24
+		value:   int = words[0] & 0xffffff
+
+		match command:
+			case 0xe1:
+				self.state.texpage = value
+			case 0xe3:
+				self.state.clip.left   = value & 0x3ff
+				self.state.clip.top    = (value >> 10) & 0x1ff
+			case 0xe4:
+				self.state.clip.right  = value & 0x3ff
+				self.state.clip.bottom = (value >> 10) & 0x1ff
+			case 0xe5:
+				self.state.offsetX = _signExtend11(value)
+				self.state.offsetY = _signExtend11(value >> 11)
+
+	@staticmethod
+	def getCommandLength(words: list[int], offset: int) -> int:
+		"""
+		Returns how many words the command starting at the given offset takes
+		up, or 0 if it's incomplete.
+		"""
+
+		command: int = words[offset] >> 24
+		length:  int = 1
+
+		if 0x20 <= command <= 0x3f:
+			vertices: int = 4 if (command & 0x08) else 3
+			length = 1 + vertices * (2 if (command & 0x04) else 1)
+
+			if command & 0x10:
+				length += vertices - 1
+		elif 0x40 <= command <= 0x5f:
+			if command & 0x08:
+				# Polylines are terminated by a word in the 5xxx5xxxh format.
+				length = 2
+
+				while (offset + length) < len(words):
+					if (words[offset + length] & 0xf000f000) == 0x50005000 \
+						and length >= 3:
+						return length + 1
+
+					length += 1
+
+				return 0
+
+			length = 4 if (command & 0x10) else 3
+		elif 0x60 <= command <= 0x7f:
+			length = 2
+
+			if command & 0x04:
+				length += 1
+			if not (command & 0x18):
+				length += 1
+		elif command == 0x02:
+			length = 3
+		elif 0x80 <= command <= 0x9f:
+			length = 4
+		elif 0xa0 <= command <= 0xbf:
+			if (offset + 2) >= len(words):
+				return 0
+
+			w: int = ((words[offset + 2] & 0xffff) - 1) % 0x400 + 1
+			h: int = ((words[offset + 2] >> 16) - 1) % 0x200 + 1
+
+			length = 3 + (w * h + 1) // 2
+		elif 0xc0 <= command <= 0xdf:
+			length = 3
+
+		return length if (offset + length) <= len(words) else 0
+
+	def decode(self, words: list[int], sources: list[int]):
+		offset: int = 0
+
+		while offset < len(words):
+			length: int = self.getCommandLength(words, offset)
+
+			if not length:
+				sys.stderr.write(f"warning: truncated command at word {offset}\n")
+				break
+
+			command: list[int] = words[offset:offset + length]
+			source:  int       = sources[offset]
+			code:    int       = command[0] >> 24
+
+			if 0x20 <= code <= 0x3f:
+				self._polygon(source, command)
+			elif 0x40 <= code <= 0x5f:
+				self._line(source, command)
+			elif 0x60 <= code <= 0x7f:
+				self._rectangle(source, command)
+			elif code == 0x02:
+				self._fill(source, command)
+			elif 0x80 <= code <= 0xdf:
+				self._transfer(source, command)
+			elif 0xe0 <= code <= 0xef:
+				self._environment(command)
+
+			offset += length
+
+## Input formats
+
+def readRecording(_file: BinaryIO) -> list[list[int]]:
+	"""
+	Reads a file saved by the host build's -o option, which is a list of
+	frames each made up of a word count followed by the GP0 words.
+	"""
+
+	frames: list[list[int]] = []
+
+	while header := _file.read(4):
+		if len(header) < 4:
+			break
+
+		count, = struct.unpack("<I", header)
+		data   = _file.read(count * 4)
+
+		if len(data) < count * 4:
+			raise RuntimeError("recording is truncated")
+
+		frames.append(list(struct.unpack(f"<{count}I", data)))
+
+	return frames
+
+class MemoryImage:
+	"""
+	A set of memory dumps, each loaded at a given address. Addresses are
+	masked to 24 bits like the DMA unit does.
+	"""
+
+	def __init__(self):
+		self.regions: list[tuple[int, bytes]] = []
+
+	def add(self, address: int, data: bytes):
+		self.regions.append(( address & 0xffffff, data ))
+
+	def readWord(self, address: int) -> int:
+		address &= 0xffffff
+
+		for base, data in self.regions:
+			offset: int = address - base
+
+			if 0 <= offset <= (len(data) - 4):
+				return struct.unpack_from("<I", data, offset)[0]
+
+		raise RuntimeError(f"address {address:06x} is not in any dump")
+
+CHAIN_FILE_MAGIC: bytes         = b"PS1CHAIN"
+CHAIN_STRUCT:     struct.Struct = struct.Struct("< 2H 5I")
+
+def readChainFile(_file: BinaryIO) -> tuple[MemoryImage, int]:
+	"""
+	Loads a chain file saved by captureDump.py, returning its ordering table
+	and packets as a memory image along with the address of the last table
+	entry (which is where the chain starts).
+	"""
+
+	data: bytes = _file.read()
+
+	if not data.startswith(CHAIN_FILE_MAGIC):
+		raise RuntimeError("not a chain file")
+
+	offset: int = len(CHAIN_FILE_MAGIC)
+	_, headerSize, _, tableAddress, tableEntries, dataAddress, dataWords = \
+		CHAIN_STRUCT.unpack_from(data, offset)
+
+	offset += headerSize
+	tableEnd: int = offset + tableEntries * 4
+
+	memory: MemoryImage = MemoryImage()
+	memory.add(tableAddress, data[offset:tableEnd])
+	memory.add(dataAddress,  data[tableEnd:tableEnd + dataWords * 4])
+
+	return memory, tableAddress + (tableEntries - 1) * 4
+
+def walkChain(
+	memory: MemoryImage, start: int, maxPackets: int = 0x80000
+) -> tuple[list[int], list[int]]:
+	"""
+	Follows a linked list of GP0 packets, returning the commands they contain
+	in the order DMA would send them along with the address of the packet each
+	word came from.
+	"""
+
+	words:   list[int] = []
+	sources: list[int] = []
+	address: int       = start & 0xffffff
+
+	for _ in range(maxPackets):
+		header: int = memory.readWord(address)
+
+		for i in range(header >> 24):
+			words.append(memory.readWord(address + 4 + i * 4))
+			sources.append(address)
+
+		# Like the DMA unit, stop at any address with bit 23 set.
+		address = header & 0xffffff
+		if address & 0x800000:
+			return words, sources
+
+	raise RuntimeError("linked list does not terminate")
+
+## Heatmap output
+
+HEATMAP_COLORS: tuple[tuple[int, int, int], ...] = (
+	(   0,   0,   0 ),
+	(  24,  32, 128 ),
+	(   0, 160, 192 ),
+	(  32, 192,  32 ),
+	( 240, 224,   0 ),
+	( 240,  64,   0 ),
+	( 255, 255, 255 )
+)
+
+def _getHeatmapColor(value: int, maxValue: int) -> tuple[int, int, int]:
+	if not value:
+		return HEATMAP_COLORS[0]
+
+	position: float = min(value / maxValue, 1.0) * (len(HEATMAP_COLORS) - 2)
+	index:    int   = min(int(position), len(HEATMAP_COLORS) - 3)
+	fraction: float = position - index
+
+	low  = HEATMAP_COLORS[index + 1]
+	high = HEATMAP_COLORS[index + 2]
+
+	return tuple(
+		int(a + (b - a) * fraction) for a, b in zip(low, high)
+	)
+
+def writeHeatmap(
+	_file: BinaryIO, counts: list[list[int]], maxValue: int,
+	crop: tuple[int, int, int, int]
+):
+	x, y, w, h = crop
+
+	palette: list[bytes] = [
+		bytes(_getHeatmapColor(value, maxValue)) for value in range(maxValue + 1)
+	]
+	rows: bytearray = bytearray()
+
+	for row in counts[y:y + h]:
+		rows.append(0) # No filtering
+
+		for value in row[x:x + w]:
+			rows += palette[min(value, maxValue)]
+
+	def _chunk(name: bytes, data: bytes) -> bytes:
+		return struct.pack(">I", len(data)) + name + data \
+			+ struct.pack(">I", zlib.crc32(name + data))
+
+	_file.write(b"\x89PNG\r\n\x1a\n")
+	_file.write(_chunk(b"IHDR", struct.pack(">IIBBBBB", w, h, 8, 2, 0, 0, 0)))
+	_file.write(_chunk(b"IDAT", zlib.compress(bytes(rows), 9)))
+	_file.write(_chunk(b"IEND", b""))
+
+## Main
+
+def createParser() -> ArgumentParser:
+	parser = ArgumentParser(
+		description = \
+			"Estimates the GPU time taken by a frame's GP0 commands and "
+			"produces an overdraw heatmap.",
+		add_help    = False
+	)
+
+	group = parser.add_argument_group("Tool options")
+	group.add_argument(
+		"-h", "--help",
+		action = "help",
+		help   = "Show this help message and exit"
+	)
+
+	group = parser.add_argument_group("Input options")
+	group.add_argument(
+		"-r", "--recording",
+		type    = FileType("rb"),
+		help    = "Read commands from a recording saved by the host build",
+		metavar = "file"
+	)
+	group.add_argument(
+		"-f", "--frame",
+		type    = int,
+		default = -1,
+		help    = \
+			"Analyze the given frame of the recording (default last, negative "
+			"values count from the end)",
+		metavar = "index"
+	)
+	group.add_argument(
+		"-k", "--chain",
+		type    = FileType("rb"),
+		help    = "Read commands from a chain file saved by captureDump.py",
+		metavar = "file"
+	)
+	group.add_argument(
+		"-m", "--memory",
+		type    = str,
+		action  = "append",
+		default = [],
+		help    = \
+			"Load a memory dump at the given address, e.g. "
+			"chain.bin@0x80010000 (can be repeated)",
+		metavar = "file@address"
+	)
+	group.add_argument(
+		"-s", "--start",
+		type    = lambda value: int(value, 0),
+		help    = \
+			"Address of the first packet in the dumps, i.e. what was passed to "
+			"sendLinkedList()",
+		metavar = "address"
+	)
+
+	group = parser.add_argument_group("Analysis options")
+	group.add_argument(
+		"-v", "--video",
+		type    = str,
+		choices = ( "ntsc", "pal" ),
+		default = "ntsc",
+		help    = "Video standard to compute the frame budget for (default ntsc)"
+	)
+	group.add_argument(
+		"-n", "--top",
+		type    = int,
+		default = 20,
+		help    = "Number of primitives to list (default 20)",
+		metavar = "count"
+	)
+
+	group = parser.add_argument_group("Output options")
+	group.add_argument(
+		"-o", "--heatmap",
+		type    = FileType("wb"),
+		help    = "Save an overdraw heatmap to the given PNG file",
+		metavar = "file"
+	)
+	group.add_argument(
+		"-M", "--max-overdraw",
+		type    = int,
+		default = 0,
+		help    = \
+			"Overdraw count shown as white in the heatmap (default highest "
+			"found)",
+		metavar = "count"
+	)
+	group.add_argument(
+		"-C", "--crop",
+		type    = lambda value: tuple(int(v, 0) for v in value.split(",")),
+		default = ( 0, 0, VRAM_WIDTH, VRAM_HEIGHT ),
+		help    = "Only save part of VRAM in the heatmap (default all of it)",
+		metavar = "x,y,w,h"
+	)
+	group.add_argument(
+		"-c", "--csv",
+		type    = FileType("wt"),
+		help    = "Save the cost of every primitive to a CSV file",
+		metavar = "file"
+	)
+
+	return parser
+
+def printReport(
+	primitives: list[Primitive], counts: list[list[int]], video: str,
+	top: int, output: TextIO = sys.stdout
+):
+	totalCycles: float = sum(prim.cycles for prim in primitives)
+	totalPixels: int   = sum(prim.pixels for prim in primitives)
+	budget:      float = GPU_CLOCK[video] / FRAME_RATE[video]
+
+	drawn:   int = sum(1 for row in counts for value in row if value)
+	written: int = sum(value for row in counts for value in row)
+	highest: int = max(max(row) for row in counts)
+
+	kinds: dict[str, list[float]] = {}
+
+	for prim in primitives:
+		entry: list[float] = kinds.setdefault(prim.getName(), [ 0, 0, 0.0 ])
+		entry[0] += 1
+		entry[1] += prim.pixels
+		entry[2] += prim.cycles
+
+	output.write(
+		f"{len(primitives)} commands, {totalPixels} pixels, "
+		f"{int(totalCycles)} cycles estimated\n"
+		f"GPU busy for {totalCycles * 1000 / GPU_CLOCK[video]:.2f} ms, "
+		f"{totalCycles * 100 / budget:.1f}% of a {video.upper()} frame\n"
+		f"overdraw: {drawn} pixels covered, "
+		f"{(written / drawn) if drawn else 0:.2f} writes each on average, "
+		f"{highest} at most\n\n"
+	)
+
+	output.write(f"{'type':24} {'count':>6} {'pixels':>8} {'cycles':>9} {'share':>6}\n")
+
+	for name, ( count, pixels, cycles ) in sorted(
+		kinds.items(), key = lambda item: -item[1][2]
+	):
+		output.write(
+			f"{name:24} {int(count):6} {int(pixels):8} {int(cycles):9} "
+			f"{cycles * 100 / totalCycles:5.1f}%\n"
+		)
+
+	output.write(
+		f"\n{'#':>5} {'source':>8} {'type':24} {'bounds':>21} {'pixels':>7} "
+		f"{'cycles':>8} {'share':>6}\n"
+	)
+
+	for prim in sorted(primitives, key = lambda prim: -prim.cycles)[0:top]:
+		bounds: str = "{},{}-{},{}".format(*prim.bounds)
+
+		output.write(
+			f"{prim.index:5} {prim.source:08x} {prim.getName():24} "
+			f"{bounds:>21} {prim.pixels:7} {int(prim.cycles):8} "
+			f"{prim.cycles * 100 / totalCycles:5.1f}%\n"
+		)
+
+def main():
+	parser: ArgumentParser = createParser()
+	args:   Namespace      = parser.parse_args()
+
+	try:
+		if args.recording is not None:
+			with args.recording as _file:
+				frames: list[list[int]] = readRecording(_file)
+
+			if not frames:
+				parser.error("recording contains no frames")
+
+			try:
+				words: list[int] = frames[args.frame]
+			except IndexError:
+				parser.error(f"recording only has {len(frames)} frames")
+
+			# Without packet addresses, identify commands by their offset.
+			sources: list[int] = list(range(len(words)))
+		elif args.chain is not None:
+			with args.chain as _file:
+				memory, start = readChainFile(_file)
+
+			words, sources = walkChain(memory, start)
+		elif args.memory and args.start is not None:
+			memory: MemoryImage = MemoryImage()
+
+			for entry in args.memory:
+				path, _, address = entry.rpartition("@")
+
+				with open(path, "rb") as _file:
+					memory.add(int(address, 0), _file.read())
+
+			words, sources = walkChain(memory, args.start)
+		else:
+			parser.error(
+				"either --recording, --chain or --memory and --start must be "
+				"given"
+			)
+	except (RuntimeError, ValueError, OSError) as err:
+		parser.error(str(err))
+
+	overdraw: OverdrawMap    = OverdrawMap()
+	decoder:  CommandDecoder = CommandDecoder(overdraw)
+
+	decoder.decode(words, sources)
+
+	if not decoder.primitives:
+		parser.error("no commands found")
+
+	counts: list[list[int]] = overdraw.getCounts()
+
+	printReport(decoder.primitives, counts, args.video, args.top)
+
+	if args.heatmap is not None:
+		maxValue: int = args.max_overdraw or max(max(row) for row in counts)
+
+		with args.heatmap as _file:
+			writeHeatmap(_file, counts, max(maxValue, 1), args.crop)
+
+	if args.csv is not None:
+		with args.csv as _file:
+			_file.write("index,source,type,x0,y0,x1,y1,pixels,cycles\n")
+
+			for prim in decoder.primitives:
+				_file.write(
+					f"{prim.index},{prim.source:#x},{prim.getName()},"
+					"{},{},{},{},".format(*prim.bounds)
+					+ f"{prim.pixels},{prim.cycles:.1f}\n"
+				)
+
+if __name__ == "__main__":
+	main()
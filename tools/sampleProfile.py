@@ -0,0 +1,394 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""Sampling profiler report generator
+
+Reads the histogram sent by sendSamplerHistogram() (src/include/sampler.c) from
+a serial log, or requests it directly from the console if pyserial is
+installed, and maps the sampled addresses back to functions using the symbol
+table of the .elf file the executable was built from (i.e. the one passed to
+convertExecutable.py). If the toolchain's addr2line is available, samples are
+also attributed to source files and lines. Requires no external dependencies
+otherwise.
+"""
+
+__version__ = "0.1.0"
+__author__  = "Rhys Baker"
+
+import shutil, struct, subprocess, sys, zlib
+from argparse    import ArgumentParser, FileType, Namespace
+from bisect      import bisect_right
+from dataclasses import dataclass, field
+from typing      import BinaryIO, TextIO
+
+from captureDump import parseBlocks, requestCapture
+
+## Histogram parser
+
+# These must match capture.h and sampler.h.
+BLOCK_END:           int   = 4
+BLOCK_SAMPLES_BEGIN: int   = 7
+BLOCK_SAMPLES:       int   = 8
+VERSION:             int   = 1
+SERIAL_COMMAND:      bytes = b"S"
+
+HEADER_STRUCT: struct.Struct = struct.Struct("< 2H 5I")
+
+@dataclass
+class SampleDump:
+	bucketShift:    int
+	rate:           int
+	textStart:      int
+	textEnd:        int
+	totalSamples:   int
+	outsideSamples: int
+
+	samples:  dict[int, int] = field(default_factory = dict)
+	records:  bytearray      = field(default_factory = bytearray)
+	errors:   list[str]      = field(default_factory = list)
+	complete: bool           = False
+
+def parseDumps(data: bytes) -> list[SampleDump]:
+	dumps:   list[SampleDump]  = []
+	current: SampleDump | None = None
+
+	for block in parseBlocks(data):
+		if block.type == BLOCK_SAMPLES_BEGIN:
+			version, shift, rate, start, end, total, outside = \
+				HEADER_STRUCT.unpack_from(block.payload, 0)
+
+			if version != VERSION:
+				sys.stderr.write(
+					f"warning: skipping dump with unsupported version "
+					f"{version}\n"
+				)
+				current = None
+				continue
+
+			current = SampleDump(shift, rate, start, end, total, outside)
+			dumps.append(current)
+		elif current is None:
+			continue
+		elif block.type == BLOCK_SAMPLES:
+			current.records += block.payload
+		elif block.type == BLOCK_END:
+			crc, = struct.unpack_from("<I", block.payload, 0)
+
+			if zlib.crc32(current.records) != crc:
+				current.errors.append(
+					"checksum is wrong, some samples are missing"
+				)
+
+			for address, count in struct.iter_unpack("<2I", current.records):
+				current.samples[address] = count
+
+			current.complete = True
+			current          = None
+
+	return dumps
+
+## ELF symbol table
+
+SHT_SYMTAB:  int = 2
+STT_NOTYPE:  int = 0
+STT_FUNC:    int = 2
+
+@dataclass
+class Symbol:
+	address: int
+	size:    int
+	name:    str
+	_type:   int = STT_FUNC
+
+def readSymbols(
+	_file: BinaryIO, types: tuple[int, ...] = ( STT_FUNC, )
+) -> list[Symbol]:
+	"""
+	Returns all symbols of the given types (only functions by default) in a
+	32-bit little endian ELF file, sorted by address.
+	"""
+
+	data: bytes = _file.read()
+
+	if data[0:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+		raise RuntimeError("not a 32-bit little endian ELF file")
+
+	shOffset, = struct.unpack_from("<I", data, 0x20)
+	shEntrySize, shCount = struct.unpack_from("<2H", data, 0x2e)
+
+	sections: list[tuple[int, ...]] = [
+		struct.unpack_from("<10I", data, shOffset + i * shEntrySize)
+		for i in range(shCount)
+	]
+	symbols: list[Symbol] = []
+
+	for _, _type, _, _, offset, size, link, _, _, entrySize in sections:
+		if _type != SHT_SYMTAB:
+			continue
+
+		strOffset: int = sections[link][4]
+
+		for i in range(size // entrySize):
+			nameOffset, value, symSize, info, _, _ = \
+				struct.unpack_from("<3I 2B H", data, offset + i * entrySize)
+
+			if (info & 15) not in types or not value:
+				continue
+
+			end:  int = data.index(b"\0", strOffset + nameOffset)
+			name: str = data[strOffset + nameOffset:end].decode("ascii")
+
+			symbols.append(Symbol(value, symSize, name, info & 15))
+
+	symbols.sort(key = lambda symbol: symbol.address)
+	return symbols
+
+class SymbolMap:
+	def __init__(self, symbols: list[Symbol]):
+		self.symbols:   list[Symbol] = symbols
+		self.addresses: list[int]    = [ symbol.address for symbol in symbols ]
+
+	def lookup(self, address: int) -> str:
+		index: int = bisect_right(self.addresses, address) - 1
+
+		if index < 0:
+			return f"<{address:08x}>"
+
+		symbol: Symbol = self.symbols[index]
+
+		# Symbols without a size (e.g. from assembly files) are assumed to
+		# extend up to the next one.
+		if symbol.size and address >= (symbol.address + symbol.size):
+			return f"<{address:08x}>"
+
+		return symbol.name
+
+## Line lookup
+
+ADDR2LINE_NAMES: tuple[str, ...] = (
+	"mipsel-none-elf-addr2line",
+	"mipsel-unknown-elf-addr2line",
+	"mipsel-linux-gnu-addr2line"
+)
+
+def lookupLines(
+	addr2line: str, elfPath: str, addresses: list[int]
+) -> dict[int, str]:
+	"""
+	Runs addr2line once for all addresses, returning the "file:line" string
+	for each of them.
+	"""
+
+	result = subprocess.run(
+		( addr2line, "-e", elfPath ),
+		input          = "".join(f"{address:08x}\n" for address in addresses),
+		capture_output = True,
+		text           = True,
+		check          = True
+	)
+	lines: list[str] = result.stdout.splitlines()
+
+	if len(lines) != len(addresses):
+		raise RuntimeError("unexpected output from addr2line")
+
+	return {
+		address: line.split(" ")[0] for address, line in zip(addresses, lines)
+	}
+
+## Report
+
+@dataclass
+class Entry:
+	name:    str
+	samples: int = 0
+
+def _accumulate(
+	samples: dict[int, int], keyFunc
+) -> list[Entry]:
+	entries: dict[str, Entry] = {}
+
+	for address, count in samples.items():
+		name: str = keyFunc(address)
+		entries.setdefault(name, Entry(name)).samples += count
+
+	return sorted(entries.values(), key = lambda entry: -entry.samples)
+
+def printTable(
+	title: str, entries: list[Entry], total: int, count: int,
+	output: TextIO = sys.stdout
+):
+	output.write(f"\n{'samples':>8} {'share':>6}  {title}\n")
+
+	for entry in entries[0:count]:
+		output.write(
+			f"{entry.samples:8} {entry.samples * 100 / total:5.1f}%  "
+			f"{entry.name}\n"
+		)
+
+## Main
+
+def createParser() -> ArgumentParser:
+	parser = ArgumentParser(
+		description = \
+			"Maps sampling profiler results back to functions and source "
+			"lines.",
+		add_help    = False
+	)
+
+	group = parser.add_argument_group("Tool options")
+	group.add_argument(
+		"-h", "--help",
+		action = "help",
+		help   = "Show this help message and exit"
+	)
+
+	group = parser.add_argument_group("Input options")
+	group.add_argument(
+		"-l", "--log",
+		type    = FileType("rb"),
+		help    = "Read the results from a saved serial log",
+		metavar = "file"
+	)
+	group.add_argument(
+		"-p", "--port",
+		type    = str,
+		help    = \
+			"Request the results over the given serial port (requires "
+			"pyserial)",
+		metavar = "port"
+	)
+	group.add_argument(
+		"-b", "--baud-rate",
+		type    = int,
+		default = 115200,
+		help    = "Serial port baud rate (default 115200)",
+		metavar = "rate"
+	)
+	group.add_argument(
+		"-t", "--timeout",
+		type    = float,
+		default = 10.0,
+		help    = "Give up if no data arrives for this many seconds (default 10)",
+		metavar = "seconds"
+	)
+
+	group = parser.add_argument_group("Report options")
+	group.add_argument(
+		"-n", "--top",
+		type    = int,
+		default = 25,
+		help    = "Number of functions and lines to list (default 25)",
+		metavar = "count"
+	)
+	group.add_argument(
+		"-a", "--addr2line",
+		type    = str,
+		help    = \
+			"Path to the toolchain's addr2line (default search PATH, pass an "
+			"empty string to skip line lookups)",
+		metavar = "path"
+	)
+	group.add_argument(
+		"-c", "--csv",
+		type    = FileType("wt"),
+		help    = \
+			"Save every sampled address along with its function and line to a "
+			"CSV file",
+		metavar = "file"
+	)
+
+	group = parser.add_argument_group("File paths")
+	group.add_argument(
+		"elf",
+		type = FileType("rb"),
+		help = "Executable the results were collected from, in ELF format"
+	)
+
+	return parser
+
+def main():
+	parser: ArgumentParser = createParser()
+	args:   Namespace      = parser.parse_args()
+
+	try:
+		if args.port is not None:
+			data: bytes = requestCapture(
+				args.port, args.baud_rate, args.timeout, SERIAL_COMMAND
+			)
+		elif args.log is not None:
+			with args.log as _file:
+				data: bytes = _file.read()
+		else:
+			parser.error("either --log or --port must be given")
+
+		with args.elf as _file:
+			symbols: SymbolMap = SymbolMap(readSymbols(_file))
+	except (RuntimeError, OSError) as err:
+		parser.error(str(err))
+
+	dumps: list[SampleDump] = [
+		dump for dump in parseDumps(data) if dump.complete
+	]
+
+	if not dumps:
+		parser.error("no complete profiler results found")
+
+	dump: SampleDump = dumps[-1]
+	total: int       = dump.totalSamples
+
+	for error in dump.errors:
+		sys.stderr.write(f"warning: {error}\n")
+	if not total:
+		parser.error("no samples were taken")
+
+	print(
+		f"{total} samples at {dump.rate} Hz ({total / dump.rate:.1f} s), "
+		f"{dump.outsideSamples * 100 / total:.1f}% outside "
+		f"{dump.textStart:08x}-{dump.textEnd:08x}"
+	)
+
+	functions: list[Entry] = _accumulate(dump.samples, symbols.lookup)
+	printTable("function", functions, total, args.top)
+
+	# Look up source lines, unless told not to or addr2line can't be found.
+	addr2line: str | None = args.addr2line
+
+	if addr2line is None:
+		addr2line = next(
+			filter(None, map(shutil.which, ADDR2LINE_NAMES)), None
+		)
+
+	lines: dict[int, str] = {}
+
+	if addr2line:
+		try:
+			lines = lookupLines(addr2line, args.elf.name, list(dump.samples))
+		except (subprocess.CalledProcessError, RuntimeError, OSError) as err:
+			sys.stderr.write(f"warning: line lookup failed: {err}\n")
+	else:
+		sys.stderr.write("note: addr2line not found, skipping line lookups\n")
+
+	if lines:
+		files: list[Entry] = _accumulate(
+			dump.samples, lambda address: lines[address].rsplit(":", 1)[0]
+		)
+		printTable("file", files, total, args.top)
+
+		sourceLines: list[Entry] = _accumulate(
+			dump.samples,
+			lambda address: f"{lines[address]} ({symbols.lookup(address)})"
+		)
+		printTable("line", sourceLines, total, args.top)
+
+	if args.csv is not None:
+		with args.csv as _file:
+			_file.write("address,samples,function,line\n")
+
+			for address, count in sorted(dump.samples.items()):
+				_file.write(
+					f"{address:#010x},{count},{symbols.lookup(address)},"
+					f"{lines.get(address, '')}\n"
+				)
+
+if __name__ == "__main__":
+	main()